@@ -10,6 +10,13 @@
  // Includes
  //-------------------------------------------------------------------
 #include "Algorithm.h"
+#include "Arena.h"
+#include "ModelFile.h"
+#include "ResultSink.h"
+#include "ThreadPool.h"
+
+#include <stdlib.h>
+#include <utility>
 
 
 //-------------------------------------------------------------------
@@ -21,9 +28,10 @@
  * @brief	The constructor
  * @param	dataset - The data set passed in for training
  * */
-Algorithm::Algorithm(vector<DataStruct>* dataset)
+Algorithm::Algorithm(Dataset* dataset)
 {
 	this->dataset = dataset;
+	this->datasetSplit = shared_ptr<Dataset[]>(new Dataset[5]);
 }
 
 
@@ -43,24 +51,27 @@ Algorithm::~Algorithm()
  * @param	index - Class index
  * @return	none
  * */
-void Algorithm::showClass(int index)
+void Algorithm::showClass(int index) const
 {
-	if (index == IRIS_SETOSA)
-	{
-		cout << "Iris-setosa" << endl;
-	}
-	else if (index == IRIS_VERSICOLOR)
-	{
-		cout << "Iris-versicolor" << endl;
-	}
-	else {
-		cout << "Iris-virginica" << endl;
-	}
+	cout << dataset->className(index) << endl;
 }
 
 
 /********************************************************************
- * @name	~Algorithm
+ * @name	printDone
+ * @brief	Report a finished step. The line is written in one piece
+ *			so folds running in parallel do not interleave.
+ * @param	step - Name of the step
+ * @return	none
+ * */
+void Algorithm::printDone(const string& step)
+{
+	cout << ("Done: " + step + ".\n") << flush;
+}
+
+
+/********************************************************************
+ * @name	ifShowProcess
  * @brief	Set whether to show the execution process
  * @param	b - Whether to show the execution process
  * @return	none
@@ -85,38 +96,61 @@ vector<TestResult>* Algorithm::getTestResult()
 
 /********************************************************************
  * @name	preprocessing
- * @brief	Used to divide the data set into five sections
+ * @brief	Used to divide the data set into five sections. The sample
+ *			order is shuffled and cut into five nearly equal parts;
+ *			the data set itself is left untouched.
  * @param	none
  * @return	none
  * */
 void Algorithm::preprocessing()
 {
-	int dataSize = this->dataset->size();
-	int spiltIndex = dataSize / 5;
-	// The dataset was randomly divided into 5 parts
-	while (true)
+	// Read through a const reference, so a data set viewing a mapped
+	// file is not copied out of it
+	const Dataset& source = *this->dataset;
+	size_t dataSize = source.size();
+	// Fisher-Yates shuffle of the sample order
+	vector<size_t> order(dataSize);
+	for (size_t i = 0; i < dataSize; i++)
 	{
-		int remainingSize = this->dataset->size();
-		if (remainingSize == 0)
+		order[i] = i;
+	}
+	for (size_t i = dataSize; i > 1; i--)
+	{
+		// Widen before scaling so the product cannot overflow when RAND_MAX is 2^31-1
+		size_t index = (size_t)((long long)rand() * (long long)i / ((long long)RAND_MAX + 1));
+		swap(order[i - 1], order[index]);
+	}
+	// The dataset was randomly divided into 5 parts. A fresh split, so
+	// earlier test results keep the rows they point into.
+	this->datasetSplit = shared_ptr<Dataset[]>(new Dataset[5]);
+	for (int i = 0; i < 5; i++)
+	{
+		size_t first = dataSize * i / 5;
+		size_t last = dataSize * (i + 1) / 5;
+		Dataset& split = this->datasetSplit[i];
+		split.copyClasses(source);
+		split.reserve(last - first);
+		for (size_t j = first; j < last; j++)
 		{
-			break;
+			split.append(source.row(order[j]), source.label(order[j]));
 		}
-		int index = rand() * remainingSize / RAND_MAX;
-		DataStruct data = this->dataset->at(index);
-		this->datasetSplit[(remainingSize - 1) / spiltIndex].push_back(data);
-		this->dataset->erase(this->dataset->begin() + index);
 	}
 	// Output result
 	if (showProcess)
 	{
-		for (DataStruct data : datasetSplit[0])
+		const Dataset& split = datasetSplit[0];
+		for (size_t i = 0; i < split.size(); i++)
 		{
-			cout << "Data: " << data.data[0] << " " << data.data[1] << " " << data.data[2] << " " << data.data[3];
+			cout << "Data:";
+			for (int f = 0; f < split.dimension(); f++)
+			{
+				cout << " " << split.row(i)[f];
+			}
 			cout << ", Category: ";
-			showClass(data.classIndex);
+			showClass(split.label(i));
 		}
 	}
-	cout << "Done: Preprocessing." << endl;
+	printDone("Preprocessing");
 }
 
 
@@ -128,33 +162,170 @@ void Algorithm::preprocessing()
  * */
 void Algorithm::test()
 {
-	// Test all data
+	// Collect all data except the training set
+	size_t count = 0;
 	for (int i = 0; i < 5; i++)
 	{
-		if (i != currentTrainDataset) {
-			for (int j = 0; j < datasetSplit[i].size(); j++)
+		if (i != currentTrainDataset)
+		{
+			count += datasetSplit[i].size();
+		}
+	}
+	keepSplit();
+	size_t base = testResults.size();
+	testResults.resize(base + count);
+	TestResult* results = testResults.data() + base;
+	size_t next = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		if (i != currentTrainDataset)
+		{
+			const Dataset& split = datasetSplit[i];
+			for (size_t j = 0; j < split.size(); j++)
 			{
-				DataStruct testData = datasetSplit[i].at(j);
-				TestResult result;
-				result.predictIndex = testSingle(testData);
-				result.actualIndex = testData.classIndex;
-				result.data[0] = testData.data[0];
-				result.data[1] = testData.data[1];
-				result.data[2] = testData.data[2];
-				result.data[3] = testData.data[3];
-				testResults.push_back(result);
-				if (showProcess)
-				{
-					cout << "predict: ";
-					showClass(result.predictIndex);
-					cout << "actual: ";
-					showClass(result.actualIndex);
-					cout << "____________________________________ " << endl;
-				}
+				results[next].data = split.row(j);
+				results[next].actualIndex = split.label(j);
+				next++;
 			}
 		}
 	}
-	cout << "Done: Test." << endl;
+	// Every worker fills its own slice of the results
+	forEachRange(count, [this, results](size_t first, size_t last)
+		{
+			testRange(results, first, last);
+		});
+	if (resultSink != nullptr)
+	{
+		resultSink->push(results, count);
+	}
+	if (showProcess)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			cout << "predict: ";
+			showClass(results[i].predictIndex);
+			cout << "actual: ";
+			showClass(results[i].actualIndex);
+			cout << "____________________________________ " << endl;
+		}
+	}
+	printDone("Test");
+}
+
+
+/********************************************************************
+ * @name	keepSplit
+ * @brief	Keep the current split alive as long as the test results,
+ *			which point into its rows
+ * @param	none
+ * @return	none
+ * */
+void Algorithm::keepSplit()
+{
+	if (resultSplits.empty() || resultSplits.back() != datasetSplit)
+	{
+		resultSplits.push_back(datasetSplit);
+	}
+}
+
+
+/********************************************************************
+ * @name	testRange
+ * @brief	Classify results[first, last), whose data is already set.
+ *			Only reads the trained model, so disjoint ranges can run
+ *			on different threads.
+ * @param	results - Results of all samples
+ * @param	first - First sample of the range
+ * @param	last - One past the last sample of the range
+ * @return	none
+ * */
+void Algorithm::testRange(TestResult* results, size_t first, size_t last) const
+{
+	for (size_t j = first; j < last; j++)
+	{
+		results[j].predictIndex = testSingle(results[j].data);
+	}
+}
+
+
+/********************************************************************
+ * @name	predict
+ * @brief	Classify a batch of samples with the trained model, on as
+ *			many threads as test()
+ * @param	batch - Samples to classify, with the dimension of the data
+ *			set
+ * @param	predictions - Receives batch.size() predicted classes
+ * @return	none
+ * */
+void Algorithm::predict(const Dataset& batch, int* predictions) const
+{
+	// Captured as two words, so the std::function does not allocate
+	pair<const Dataset*, int*> target(&batch, predictions);
+	forEachRange(batch.size(), [this, &target](size_t first, size_t last)
+		{
+			for (size_t j = first; j < last; j++)
+			{
+				target.second[j] = testSingle(target.first->row(j));
+			}
+		});
+}
+
+
+/********************************************************************
+ * @name	forEachRange
+ * @brief	Split [0, count) into one contiguous range per test thread
+ *			and run work on every range. Each range is a batch for the
+ *			scratch arena of its thread, which is rewound when the
+ *			range ends.
+ * @param	count - Number of items
+ * @param	work - Called with the first and one past the last item of
+ *			each range
+ * @return	none
+ * */
+void Algorithm::forEachRange(size_t count, const function<void(size_t, size_t)>& work) const
+{
+	int threads = testPool != nullptr ? testPool->size() : 1;
+	if (threads <= 1 || count < 2)
+	{
+		ArenaScope batch;
+		work(0, count);
+		return;
+	}
+	size_t chunk = (count + threads - 1) / threads;
+	auto range = [&work, chunk, count](size_t first)
+		{
+			ArenaScope batch;
+			work(first, first + chunk < count ? first + chunk : count);
+		};
+	// Clones share the pool, so only the ranges of this call are waited
+	// for
+	TaskGroup group;
+	for (size_t first = 0; first < count; first += chunk)
+	{
+		// Two words, stored in the task without allocating
+		testPool->submit([&range, first]()
+			{
+				range(first);
+			}, group);
+	}
+	testPool->wait(group);
+}
+
+
+/********************************************************************
+ * @name	trainAll
+ * @brief	Train on the whole data set instead of one section, for
+ *			classifying new data rather than cross-validating
+ * @param	none
+ * @return	none
+ * */
+void Algorithm::trainAll()
+{
+	// A fresh split, so models cloned from this one keep their sections
+	this->datasetSplit = shared_ptr<Dataset[]>(new Dataset[5]);
+	this->datasetSplit[0] = *this->dataset;
+	this->currentTrainDataset = 0;
+	train();
 }
 
 
@@ -168,3 +339,123 @@ void Algorithm::setTrainDataset(int index)
 {
 	this->currentTrainDataset = index;
 }
+
+
+
+/********************************************************************
+ * @name	crossValidate
+ * @brief	Train and test all five folds concurrently. Every fold gets
+ *			its own model from clone(), sharing only the read-only
+ *			split and the test pool, where each test() waits for its
+ *			own ranges. The results are appended in fold order, so
+ *			they match the sequential setTrainDataset / train / test
+ *			loop.
+ * @param	threads - Number of worker threads, 0 for one per core
+ * @return	none
+ * */
+void Algorithm::crossValidate(int threads)
+{
+	unique_ptr<Algorithm> folds[5];
+	for (int i = 0; i < 5; i++)
+	{
+		folds[i].reset(clone());
+		folds[i]->testResults.clear();
+		folds[i]->resultSplits.clear();
+		folds[i]->resultSink = nullptr;
+		folds[i]->setTrainDataset(i);
+	}
+	if (threads <= 0)
+	{
+		threads = ThreadPool::defaultThreads();
+	}
+	{
+		ThreadPool pool(threads < 5 ? threads : 5);
+		for (int i = 0; i < 5; i++)
+		{
+			Algorithm* fold = folds[i].get();
+			pool.submit([fold]()
+				{
+					fold->train();
+					fold->test();
+				});
+		}
+		pool.wait();
+	}
+	// Merge in fold order
+	keepSplit();
+	for (int i = 0; i < 5; i++)
+	{
+		testResults.insert(testResults.end(), folds[i]->testResults.begin(), folds[i]->testResults.end());
+		if (resultSink != nullptr)
+		{
+			resultSink->push(folds[i]->testResults.data(), folds[i]->testResults.size());
+		}
+	}
+}
+
+
+
+/********************************************************************
+ * @name	setTestThreads
+ * @brief	Set how many threads test() and predict() classify with.
+ *			The samples are split into contiguous ranges, one per
+ *			thread, and the results keep the sequential order. The
+ *			threads are started here and serve every later batch.
+ * @param	threads - Number of threads, 0 for one per core
+ * @return	none
+ * */
+void Algorithm::setTestThreads(int threads)
+{
+	if (threads <= 0)
+	{
+		threads = ThreadPool::defaultThreads();
+	}
+	this->testPool = threads > 1 ? make_shared<ThreadPool>(threads) : nullptr;
+}
+
+
+/********************************************************************
+ * @name	setResultSink
+ * @brief	Send the results of test() and crossValidate() to a sink as
+ *			well. The sink only copies them, the writing happens on
+ *			its own thread.
+ * @param	sink - Result sink owned by the caller, nullptr for none
+ * @return	none
+ * */
+void Algorithm::setResultSink(ResultSink* sink)
+{
+	this->resultSink = sink;
+}
+
+
+/********************************************************************
+ * @name	save
+ * @brief	Store the trained model in a model file, with the class
+ *			names of the data set or of the file it was loaded from.
+ *			loadModel() serves it again without training.
+ * @param	filename - Name and path of the file
+ * @return	Whether the file was written
+ * */
+bool Algorithm::save(const string& filename) const
+{
+	ModelWriter writer;
+	if (!saveModel(writer))
+	{
+		cout << "The model is not trained!\n";
+		return false;
+	}
+	if (dataset != nullptr)
+	{
+		writer.addClasses(*dataset);
+	}
+	else if (modelFile != nullptr)
+	{
+		size_t bytes = 0;
+		const char* names = modelFile->section(MODEL_SECTION_CLASSES, &bytes);
+		if (names != nullptr)
+		{
+			writer.add(MODEL_SECTION_CLASSES, names, bytes);
+		}
+	}
+	return writer.write(filename);
+}
@@ -15,7 +15,12 @@
 //-------------------------------------------------------------------
 // Includes
 //-------------------------------------------------------------------
+#include "Dataset.h"
+
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 
@@ -29,44 +34,31 @@ using namespace std;
 // Constants and Typedefine
 //-------------------------------------------------------------------
 
-// Iris species 1
-#define IRIS_SETOSA 1
-// Iris species 2
-#define IRIS_VERSICOLOR 2
-// Iris species 3
-#define IRIS_VIRGINICA 3
-// Iris unknown species
-#define IRIS_UNKNOWN 0
-
 // circumference
 const double PI = 3.1415926536;
 
-/********************************************************************
- * @name	DataStruct
- * @brief	Data set structure
- * */
-typedef struct
-{
-	// parameter
-	double data[4];
-	// species
-	int classIndex;
-}DataStruct;
-
 /********************************************************************
  * @name	TestResult
  * @brief	Test result structure
  * */
 typedef struct
 {
-	// parameter
-	float data[4];
+	// Features of the sample, dimension() values inside the split,
+	// valid as long as the algorithm that produced the result
+	const double* data;
 	// predict result
 	int predictIndex;
 	// actual result
 	int actualIndex;
 }TestResult;
 
+// Receives test results, see ResultSink.h
+class ResultSink;
+// Saved models, see ModelFile.h
+class ModelFile;
+class ModelWriter;
+class ThreadPool;
+
 
 //-------------------------------------------------------------------
 // Class Declaration
@@ -85,34 +77,58 @@ class Algorithm
 //-------------------------------------------------------------------
 protected:
 	// Data set variable
-	vector<DataStruct>* dataset;
-	// A data set divided into five pieces
-	vector<DataStruct> datasetSplit[5];
+	Dataset* dataset;
+	// A data set divided into five pieces, shared with the fold models
+	shared_ptr<Dataset[]> datasetSplit;
 	// The data set currently used as a training set
 	int currentTrainDataset = 0;
 	// The test results
 	vector<TestResult> testResults;
+	// Splits the test results point into, kept after preprocessing()
+	// or trainAll() replace datasetSplit
+	vector<shared_ptr<Dataset[]>> resultSplits;
 	// Whether to show the execution process
 	bool showProcess = false;
+	// Workers test() and predict() classify with, nullptr to classify
+	// on the calling thread. Kept between batches, so the workers and
+	// their scratch arenas are reused; shared with the clones.
+	shared_ptr<ThreadPool> testPool;
+	// Receives the results of test() and crossValidate(), not owned
+	ResultSink* resultSink = nullptr;
+	// Model file the model was loaded from, shared with its clones
+	shared_ptr<ModelFile> modelFile;
 
 //-------------------------------------------------------------------
 // Member Function
 //-------------------------------------------------------------------
 private:
-	void showClass(int index);
+	void showClass(int index) const;
+	void keepSplit();
+	void testRange(TestResult* results, size_t first, size_t last) const;
+	void forEachRange(size_t count, const function<void(size_t, size_t)>& work) const;
 
 protected:
-	virtual int testSingle(DataStruct testData) = 0;
+	void printDone(const string& step);
+	virtual int testSingle(const double* x) const = 0;
+	virtual bool saveModel(ModelWriter& writer) const = 0;
 
 public:
-	Algorithm(vector<DataStruct>* dataset);
-	~Algorithm();
+	Algorithm(Dataset* dataset);
+	virtual ~Algorithm();
+	virtual Algorithm* clone() const = 0;
 	void ifShowProcess(bool b);
 	vector<TestResult>* getTestResult();
 	void preprocessing(void);
 	void setTrainDataset(int index);
+	void trainAll(void);
+	void setTestThreads(int threads);
+	void setResultSink(ResultSink* sink);
 	virtual void train(void) = 0;
 	void test(void);
+	void predict(const Dataset& batch, int* predictions) const;
+	void crossValidate(int threads = 0);
+	bool save(const string& filename) const;
+	virtual bool load(const shared_ptr<ModelFile>& file) = 0;
 };
 
 #endif
@@ -0,0 +1,86 @@
+/********************************************************************
+ * @File name:		AlignedAllocator.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-14
+ * @Description:	Declare an allocator for over-aligned buffers
+ ********************************************************************/
+
+#pragma once
+
+#ifndef ALIGNEDALLOCATOR_H
+#define ALIGNEDALLOCATOR_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include <cstddef>
+#include <new>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Alignment of feature buffers, one cache line and one AVX-512 register
+const size_t FEATURE_ALIGNMENT = 64;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	AlignedAllocator
+ * @brief	Standard allocator returning memory aligned to Align bytes,
+ *			so vectors of features can be loaded with aligned SIMD
+ *			instructions.
+ * */
+template<typename T, size_t Align = FEATURE_ALIGNMENT>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Align> other;
+	};
+
+	AlignedAllocator() noexcept {}
+
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Align>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+	}
+
+	void deallocate(T* p, size_t) noexcept
+	{
+		::operator delete(p, std::align_val_t(Align));
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Align>&) const noexcept
+	{
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(const AlignedAllocator<U, Align>&) const noexcept
+	{
+		return false;
+	}
+};
+
+// Vector of doubles aligned for SIMD loads
+typedef std::vector<double, AlignedAllocator<double>> AlignedVector;
+// Vector of floats aligned for SIMD loads
+typedef std::vector<float, AlignedAllocator<float>> AlignedFloatVector;
+
+#endif
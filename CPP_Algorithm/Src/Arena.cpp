@@ -0,0 +1,196 @@
+/********************************************************************
+ * @File name:		Arena.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-8
+ * @Description:	Per-thread arena for scratch memory
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Arena.h"
+
+#include <new>
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	Arena
+ * @brief	The constructor. The first block is allocated by the first
+ *			allocation.
+ * */
+Arena::Arena()
+{
+}
+
+
+/********************************************************************
+ * @name	~Arena
+ * @brief	The destructor. Frees every block.
+ * */
+Arena::~Arena()
+{
+	release();
+}
+
+
+/********************************************************************
+ * @name	allocateBytes
+ * @brief	Take bytes from the current block, moving on to the next
+ *			kept block or a new one twice the size of the last when
+ *			they do not fit
+ * @param	bytes - Number of bytes
+ * @return	First byte, FEATURE_ALIGNMENT aligned
+ * */
+char* Arena::allocateBytes(size_t bytes)
+{
+	// Rounded up, so every allocation starts aligned
+	bytes = (bytes + FEATURE_ALIGNMENT - 1) / FEATURE_ALIGNMENT * FEATURE_ALIGNMENT;
+	while (current < blocks.size())
+	{
+		if (blocks[current].size - used >= bytes)
+		{
+			char* data = blocks[current].data + used;
+			used += bytes;
+			return data;
+		}
+		if (current + 1 == blocks.size())
+		{
+			break;
+		}
+		current++;
+		used = 0;
+	}
+	size_t size = blocks.empty() ? ARENA_BLOCK_BYTES : blocks.back().size * 2;
+	while (size < bytes)
+	{
+		size *= 2;
+	}
+	ArenaBlock block;
+	block.data = (char*)::operator new(size, align_val_t(FEATURE_ALIGNMENT));
+	block.size = size;
+	blocks.push_back(block);
+	current = blocks.size() - 1;
+	used = bytes;
+	return block.data;
+}
+
+
+/********************************************************************
+ * @name	rewind
+ * @brief	Release everything allocated after a mark. The arena is
+ *			reset when the mark is its start.
+ * @param	block - Block being filled at the mark
+ * @param	offset - Bytes used in that block at the mark
+ * @return	none
+ * */
+void Arena::rewind(size_t block, size_t offset)
+{
+	if (block == 0 && offset == 0)
+	{
+		reset();
+		return;
+	}
+	current = block;
+	used = offset;
+}
+
+
+/********************************************************************
+ * @name	reset
+ * @brief	Release every allocation. When the last working set needed
+ *			more than one block, the blocks are replaced by one of
+ *			their total size, so the same working set fits without
+ *			allocating. Must not be called while an ArenaScope of the
+ *			arena is open.
+ * @param	none
+ * @return	none
+ * */
+void Arena::reset()
+{
+	current = 0;
+	used = 0;
+	if (blocks.size() <= 1)
+	{
+		return;
+	}
+	size_t size = capacity();
+	release();
+	ArenaBlock block;
+	block.data = (char*)::operator new(size, align_val_t(FEATURE_ALIGNMENT));
+	block.size = size;
+	blocks.push_back(block);
+}
+
+
+/********************************************************************
+ * @name	release
+ * @brief	Free every block
+ * @param	none
+ * @return	none
+ * */
+void Arena::release()
+{
+	for (ArenaBlock& block : blocks)
+	{
+		::operator delete(block.data, align_val_t(FEATURE_ALIGNMENT));
+	}
+	blocks.clear();
+	current = 0;
+	used = 0;
+}
+
+
+/********************************************************************
+ * @name	capacity
+ * @brief	Bytes held by the arena
+ * @param	none
+ * @return	Total size of the blocks
+ * */
+size_t Arena::capacity() const
+{
+	size_t size = 0;
+	for (const ArenaBlock& block : blocks)
+	{
+		size += block.size;
+	}
+	return size;
+}
+
+
+/********************************************************************
+ * @name	local
+ * @brief	Arena of the calling thread, created by the first call on
+ *			the thread and freed when the thread ends
+ * @param	none
+ * @return	The arena
+ * */
+Arena& Arena::local()
+{
+	static thread_local Arena arena;
+	return arena;
+}
+
+
+/********************************************************************
+ * @name	ArenaScope
+ * @brief	The constructor. Marks the arena.
+ * @param	arena - Arena to rewind, the thread's own by default
+ * */
+ArenaScope::ArenaScope(Arena& arena) : arena(arena), block(arena.current), offset(arena.used)
+{
+}
+
+
+/********************************************************************
+ * @name	~ArenaScope
+ * @brief	The destructor. Rewinds the arena to the mark.
+ * */
+ArenaScope::~ArenaScope()
+{
+	arena.rewind(block, offset);
+}
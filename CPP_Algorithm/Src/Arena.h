@@ -0,0 +1,170 @@
+/********************************************************************
+ * @File name:		Arena.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-8
+ * @Description:	Declare the per-thread arena for scratch memory
+ ********************************************************************/
+
+#pragma once
+
+#ifndef ARENA_H
+#define ARENA_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "AlignedAllocator.h"
+
+#include <cstddef>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Size of the first block of an arena
+const size_t ARENA_BLOCK_BYTES = 64 * 1024;
+
+/********************************************************************
+ * @name	ArenaBlock
+ * @brief	A block of memory an arena hands out
+ * */
+typedef struct
+{
+	// First byte, FEATURE_ALIGNMENT aligned
+	char* data;
+	// Length in bytes
+	size_t size;
+}ArenaBlock;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	Arena
+ * @brief	Bump allocator for scratch memory. An allocation only
+ *			advances a pointer; everything is released at once by
+ *			rewinding, usually through an ArenaScope. Blocks are kept
+ *			when the arena is rewound and merged into one when it
+ *			becomes empty, so once the largest working set has been
+ *			seen the arena never calls the global allocator again.
+ *			Every thread has its own arena, see local().
+ * */
+class Arena
+{
+	friend class ArenaScope;
+
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Blocks in the order they are filled
+	vector<ArenaBlock> blocks;
+	// Block being filled
+	size_t current = 0;
+	// Bytes used in the current block
+	size_t used = 0;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	char* allocateBytes(size_t bytes);
+	void rewind(size_t block, size_t offset);
+	void release();
+
+public:
+	Arena();
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	void reset();
+	size_t capacity() const;
+	static Arena& local();
+
+	/****************************************************************
+	 * @name	allocate
+	 * @brief	Uninitialised scratch for count values, aligned to
+	 *			FEATURE_ALIGNMENT. Only for types without a destructor;
+	 *			the memory is valid until the arena is rewound past it.
+	 * @param	count - Number of values
+	 * @return	First value
+	 * */
+	template<typename T>
+	T* allocate(size_t count)
+	{
+		return (T*)allocateBytes(count * sizeof(T));
+	}
+};
+
+/********************************************************************
+ * @name	ArenaScope
+ * @brief	Marks an arena on construction and rewinds it to the mark
+ *			on destruction, releasing everything allocated through
+ *			the scope or nested scopes in between
+ * */
+class ArenaScope
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// The arena
+	Arena& arena;
+	// Block being filled at the mark
+	size_t block;
+	// Bytes used in that block at the mark
+	size_t offset;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	ArenaScope(Arena& arena = Arena::local());
+	~ArenaScope();
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+	/****************************************************************
+	 * @name	allocate
+	 * @brief	Uninitialised scratch released with the scope
+	 * @param	count - Number of values
+	 * @return	First value
+	 * */
+	template<typename T>
+	T* allocate(size_t count)
+	{
+		return arena.allocate<T>(count);
+	}
+
+	/****************************************************************
+	 * @name	allocate
+	 * @brief	Scratch released with the scope, every value set
+	 * @param	count - Number of values
+	 * @param	value - Initial value
+	 * @return	First value
+	 * */
+	template<typename T>
+	T* allocate(size_t count, const T& value)
+	{
+		T* values = arena.allocate<T>(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			values[i] = value;
+		}
+		return values;
+	}
+};
+
+#endif
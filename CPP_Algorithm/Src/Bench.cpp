@@ -0,0 +1,283 @@
+/********************************************************************
+ * @File name:		Bench.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-10
+ * @Description:	Benchmark program. Times preprocessing, training and
+ *					testing of each algorithm separately and reports
+ *					min / median / p99 over several repetitions.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "FileReader.h"
+#include "ParzenWindow.h"
+#include "ModifiedQDF.h"
+#include "ParzenKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+#ifndef BENCH_DEFAULT_DATASET
+#define BENCH_DEFAULT_DATASET "Dataset/iris.data"
+#endif
+
+// Monotonic clock used for every measurement
+typedef chrono::steady_clock BenchClock;
+
+/********************************************************************
+ * @name	PhaseTimes
+ * @brief	Samples (in microseconds) collected for one algorithm
+ * */
+typedef struct
+{
+	// Preprocessing, one sample per repetition
+	vector<double> preprocessing;
+	// Training, one sample per fold and repetition
+	vector<double> train;
+	// Testing, one sample per fold and repetition
+	vector<double> test;
+	// All five folds through crossValidate, one sample per repetition
+	vector<double> crossValidate;
+	// Number of samples classified in one test phase
+	size_t testSize;
+	// Number of samples classified by crossValidate
+	size_t crossValidateSize;
+	// Folds trained, and those whose queries went through the index of
+	// the Parzen backend rather than the exact sums
+	size_t folds;
+	size_t indexedFolds;
+}PhaseTimes;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+Algorithm* createAlgorithm(int type, Dataset* dataset);
+PhaseTimes runBenchmark(int type, Dataset* dataset, int repeats, int testThreads);
+double elapsedMicros(BenchClock::time_point start);
+double percentile(const vector<double>& sorted, double p);
+void report(const string& name, const string& phase, vector<double> samples, size_t items);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	main
+ * @brief	Benchmark entry. Usage: bench [dataset] [repeats] [test threads]
+ * @param	argc - Number of arguments
+ * @param	argv - Arguments
+ * @return	Exit code
+ * */
+int main(int argc, char* argv[])
+{
+	string filename = argc > 1 ? argv[1] : BENCH_DEFAULT_DATASET;
+	int repeats = argc > 2 ? atoi(argv[2]) : 20;
+	if (repeats < 1)
+	{
+		repeats = 1;
+	}
+	int testThreads = argc > 3 ? atoi(argv[3]) : 1;
+
+	Dataset* dataset = readAsDataList(filename, 0);
+	if (dataset == nullptr || dataset->empty())
+	{
+		cout << "Unable to load dataset: " << filename << endl;
+		return 1;
+	}
+	cout << "Dataset: " << filename << " (" << dataset->size() << " samples, "
+		<< dataset->dimension() << " features, " << dataset->classNumber() << " classes), "
+		<< repeats << " repetitions, " << testThreads << " test threads, Parzen kernel: "
+		<< gaussKernelName() << endl;
+	cout << left << setw(14) << "algorithm" << setw(16) << "phase"
+		<< right << setw(12) << "min(us)" << setw(12) << "median(us)" << setw(12) << "p99(us)"
+		<< setw(16) << "samples/s" << endl;
+
+	const char* names[8] = { "ParzenWindow", "MQDF", "MQDF(k=2)", "Parzen(kd)", "Parzen(ifgt)", "Parzen(f32)",
+		"Parzen(early)", "Parzen(rff)" };
+	for (int type = 1; type <= 8; type++)
+	{
+		PhaseTimes times = runBenchmark(type, dataset, repeats, testThreads);
+		report(names[type - 1], "preprocessing", times.preprocessing, dataset->size());
+		report(names[type - 1], "train", times.train, 0);
+		report(names[type - 1], "test", times.test, times.testSize);
+		report(names[type - 1], "cross-validate", times.crossValidate, times.crossValidateSize);
+		if ((type == 4 || type == 5 || type == 8) && times.indexedFolds < times.folds)
+		{
+			// The backend found the exact sums cheaper, or out of reach
+			cout << left << setw(14) << names[type - 1] << "index used in " << times.indexedFolds << " of "
+				<< times.folds << " folds, the exact sums served the rest" << endl;
+		}
+	}
+	delete dataset;
+	return 0;
+}
+
+
+/********************************************************************
+ * @name	createAlgorithm
+ * @brief	Create the algorithm under test
+ * @param	type - 1 for Parzen Window, 2 for MQDF, 3 for MQDF with two
+ *			principal axes, 4 for Parzen Window over a KD-tree, 5 for
+ *			Parzen Window through the IFGT, 6 for Parzen Window with
+ *			float32 distances, 7 for Parzen Window with early exit,
+ *			8 for Parzen Window through random Fourier features
+ * @param	dataset - Data set owned by the caller
+ * @return	Pointer of the algorithm
+ * */
+Algorithm* createAlgorithm(int type, Dataset* dataset)
+{
+	if (type == 1 || type >= 4)
+	{
+		ParzenWindow* parzen = new ParzenWindow(dataset);
+		parzen->setPrecision(type == 6 ? PARZEN_FLOAT : PARZEN_DOUBLE);
+		parzen->setEarlyExit(type == 7);
+		parzen->setBackend(type == 4 ? PARZEN_KDTREE : (type == 5 ? PARZEN_IFGT
+			: (type == 8 ? PARZEN_RFF : PARZEN_EXACT)));
+		parzen->setIndexError(0, 1e-6);
+		// The expansions reach 1e-3 cheaper than the exact sums from
+		// about 10000 samples of two features, see setIFGTAccuracy()
+		parzen->setIFGTAccuracy(1e-3);
+		return parzen;
+	}
+	ModifiedQDF* mqdf = new ModifiedQDF(dataset);
+	if (type == 3)
+	{
+		mqdf->setTruncation(2, 0);
+	}
+	return mqdf;
+}
+
+
+/********************************************************************
+ * @name	runBenchmark
+ * @brief	Run the five-fold process repeatedly and time each phase,
+ *			then the same folds again through crossValidate
+ * @param	type - Algorithm, see createAlgorithm
+ * @param	dataset - Data set, left unchanged
+ * @param	repeats - Number of repetitions
+ * @param	testThreads - Threads used by test(), 0 for one per core
+ * @return	Collected samples
+ * */
+PhaseTimes runBenchmark(int type, Dataset* dataset, int repeats, int testThreads)
+{
+	PhaseTimes times;
+	times.testSize = 0;
+	times.crossValidateSize = 0;
+	times.folds = 0;
+	times.indexedFolds = 0;
+	// The algorithms report progress on cout, keep it out of the timings
+	ostringstream sink;
+	streambuf* console = cout.rdbuf(sink.rdbuf());
+	srand(0);
+	for (int r = 0; r < repeats; r++)
+	{
+		Algorithm* algorithm = createAlgorithm(type, dataset);
+		algorithm->setTestThreads(testThreads);
+
+		BenchClock::time_point start = BenchClock::now();
+		algorithm->preprocessing();
+		times.preprocessing.push_back(elapsedMicros(start));
+
+		for (int i = 0; i < 5; i++)
+		{
+			algorithm->setTrainDataset(i);
+			start = BenchClock::now();
+			algorithm->train();
+			times.train.push_back(elapsedMicros(start));
+			ParzenWindow* parzen = dynamic_cast<ParzenWindow*>(algorithm);
+			times.folds++;
+			times.indexedFolds += parzen != nullptr && parzen->usesIndex() ? 1 : 0;
+
+			size_t before = algorithm->getTestResult()->size();
+			start = BenchClock::now();
+			algorithm->test();
+			times.test.push_back(elapsedMicros(start));
+			times.testSize = algorithm->getTestResult()->size() - before;
+		}
+
+		size_t before = algorithm->getTestResult()->size();
+		start = BenchClock::now();
+		algorithm->crossValidate();
+		times.crossValidate.push_back(elapsedMicros(start));
+		times.crossValidateSize = algorithm->getTestResult()->size() - before;
+		delete algorithm;
+		sink.str("");
+	}
+	cout.rdbuf(console);
+	return times;
+}
+
+
+/********************************************************************
+ * @name	elapsedMicros
+ * @brief	Microseconds since a time point
+ * @param	start - Start time
+ * @return	Elapsed time in microseconds
+ * */
+double elapsedMicros(BenchClock::time_point start)
+{
+	return chrono::duration<double, micro>(BenchClock::now() - start).count();
+}
+
+
+/********************************************************************
+ * @name	percentile
+ * @brief	Nearest-rank percentile of sorted samples
+ * @param	sorted - Samples in ascending order
+ * @param	p - Percentile in [0, 1]
+ * @return	The percentile value
+ * */
+double percentile(const vector<double>& sorted, double p)
+{
+	size_t rank = (size_t)ceil(p * sorted.size());
+	if (rank > 0)
+	{
+		rank--;
+	}
+	return sorted[min(rank, sorted.size() - 1)];
+}
+
+
+/********************************************************************
+ * @name	report
+ * @brief	Print min / median / p99 of one phase
+ * @param	name - Algorithm name
+ * @param	phase - Phase name
+ * @param	samples - Samples in microseconds
+ * @param	items - Items processed per sample, 0 to omit throughput
+ * @return	none
+ * */
+void report(const string& name, const string& phase, vector<double> samples, size_t items)
+{
+	sort(samples.begin(), samples.end());
+	double median = percentile(samples, 0.5);
+	cout << left << setw(14) << name << setw(16) << phase << right << fixed << setprecision(1)
+		<< setw(12) << samples.front() << setw(12) << median << setw(12) << percentile(samples, 0.99);
+	if (items > 0 && median > 0)
+	{
+		cout << setw(16) << setprecision(0) << items / (median * 1e-6);
+	}
+	cout << endl;
+}
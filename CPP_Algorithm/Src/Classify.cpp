@@ -0,0 +1,181 @@
+/********************************************************************
+ * @File name:		Classify.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-30
+ * @Description:	Streaming classifier. Trains a model on a data set,
+ *					or maps a saved one, then classifies records from a
+ *					file or stdin chunk by chunk and writes one
+ *					prediction per line, so inputs of any length run in
+ *					bounded memory.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "FileReader.h"
+#include "ModelFile.h"
+#include "ModifiedQDF.h"
+#include "ParzenWindow.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Records classified together by default
+#define CLASSIFY_BATCH 4096
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	main
+ * @brief	Classifier entry. Usage:
+ *			classify train.csv algorithm [input|-] [batch] [threads] [save]
+ *			classify model [input|-] [batch] [threads]
+ *			where algorithm is 1 for Parzen Window and 2 for MQDF.
+ *			The first form trains the model and, with save, stores
+ *			it in a model file; the second serves a stored model
+ *			without training. Predictions go to stdout, progress and
+ *			the accuracy over labelled records to stderr.
+ * @param	argc - Number of arguments
+ * @param	argv - Arguments
+ * @return	Exit code
+ * */
+int main(int argc, char* argv[])
+{
+	bool saved = argc > 1 && ModelFile::isModelFile(argv[1]);
+	if (argc < (saved ? 2 : 3))
+	{
+		cerr << "Usage: classify train.csv algorithm [input|-] [batch] [threads] [save]" << endl;
+		cerr << "       classify model [input|-] [batch] [threads]" << endl;
+		return 1;
+	}
+	// A saved model takes the place of the data set and the algorithm
+	char** options = saved ? argv + 1 : argv + 2;
+	int optionNumber = saved ? argc - 1 : argc - 2;
+	string inputName = optionNumber > 1 ? options[1] : "-";
+	long batchRows = optionNumber > 2 ? atol(options[2]) : CLASSIFY_BATCH;
+	if (batchRows < 1)
+	{
+		batchRows = CLASSIFY_BATCH;
+	}
+	int threads = optionNumber > 3 ? atoi(options[3]) : 1;
+
+	// Progress messages of the model would mix with the predictions
+	streambuf* console = cout.rdbuf(cerr.rdbuf());
+	Dataset* dataset;
+	Algorithm* algorithm;
+	if (saved)
+	{
+		dataset = new Dataset();
+		algorithm = loadModel(argv[1], dataset);
+		if (algorithm == nullptr)
+		{
+			cout.rdbuf(console);
+			cerr << "Unable to load model: " << argv[1] << endl;
+			delete dataset;
+			return 1;
+		}
+	}
+	else
+	{
+		dataset = readAsDataList(argv[1], 0);
+		if (dataset == nullptr || dataset->empty())
+		{
+			cout.rdbuf(console);
+			cerr << "Unable to load dataset: " << argv[1] << endl;
+			delete dataset;
+			return 1;
+		}
+		if (atoi(argv[2]) == 1)
+		{
+			algorithm = new ParzenWindow(dataset);
+		}
+		else
+		{
+			algorithm = new ModifiedQDF(dataset);
+		}
+		algorithm->trainAll();
+		if (optionNumber > 4 && !algorithm->save(options[4]))
+		{
+			cout.rdbuf(console);
+			cerr << "Unable to save model: " << options[4] << endl;
+			delete algorithm;
+			delete dataset;
+			return 1;
+		}
+	}
+	algorithm->setTestThreads(threads);
+	cout.rdbuf(console);
+
+	ifstream file;
+	istream* input = &cin;
+	if (inputName != "-")
+	{
+		file.open(inputName, ios::in | ios::binary);
+		if (!file.is_open())
+		{
+			cerr << "File opening failure!" << endl;
+			delete algorithm;
+			delete dataset;
+			return 1;
+		}
+		input = &file;
+	}
+
+	// Only one batch of records and predictions is held at a time
+	RecordReader reader(*input, *dataset);
+	Dataset batch(dataset->dimension());
+	vector<int> predictions(batchRows);
+	size_t total = 0;
+	size_t labelled = 0;
+	size_t correct = 0;
+	string out;
+	while (reader.next(batch, batchRows) > 0)
+	{
+		algorithm->predict(batch, predictions.data());
+		out.clear();
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			out += dataset->className(predictions[i]);
+			out += '\n';
+			if (batch.label(i) != CLASS_UNKNOWN)
+			{
+				labelled++;
+				correct += batch.label(i) == predictions[i];
+			}
+		}
+		cout << out << flush;
+		total += batch.size();
+	}
+	cerr << "Classified " << total << " records";
+	if (labelled > 0)
+	{
+		cerr << ", accuracy over " << labelled << " labelled: " << 100.0 * correct / labelled << "%";
+	}
+	if (reader.skippedLines() > 0)
+	{
+		cerr << ", skipped " << reader.skippedLines() << " malformed lines";
+	}
+	cerr << endl;
+	delete algorithm;
+	delete dataset;
+	return 0;
+}
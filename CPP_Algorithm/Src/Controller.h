@@ -19,5 +19,7 @@ const char* SERVER_PORT = "3306";
 const char* UID = "root";
 const char* PWD = "20000401";
 const char* DATABASE = "int304_training_result";
+// Test results without MySQL: .csv, .db / .sqlite or binary records
+const char* RESULT_FILE = "Dataset/result.csv";
 
 #endif
@@ -0,0 +1,62 @@
+/********************************************************************
+ * @File name:		Convert.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-28
+ * @Description:	Converts a CSV data set into a binary columnar data
+ *					set file, which later runs load without parsing.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "DatasetFile.h"
+#include "FileReader.h"
+
+#include <iostream>
+#include <string>
+
+#include <stdlib.h>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	main
+ * @brief	Converter entry. Usage: convert input.csv output [threads]
+ * @param	argc - Number of arguments
+ * @param	argv - Arguments
+ * @return	Exit code
+ * */
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cout << "Usage: convert input.csv output [threads]" << endl;
+		return 1;
+	}
+	int threads = argc > 3 ? atoi(argv[3]) : 0;
+	Dataset* dataset = readAsDataList(argv[1], threads);
+	if (dataset == nullptr || dataset->empty())
+	{
+		cout << "Unable to load dataset: " << argv[1] << endl;
+		delete dataset;
+		return 1;
+	}
+	bool written = DatasetFile::write(*dataset, argv[2]);
+	if (written)
+	{
+		cout << "Wrote " << dataset->size() << " samples, " << dataset->dimension() << " features, "
+			<< dataset->classNumber() << " classes to " << argv[2] << endl;
+	}
+	delete dataset;
+	return written ? 0 : 1;
+}
@@ -0,0 +1,331 @@
+/********************************************************************
+ * @File name:		Dataset.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-24
+ * @Description:	Feature store shared by all algorithms
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Dataset.h"
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	Dataset
+ * @brief	The constructor. Creates an empty data set.
+ * @param	dimension - Number of features per sample
+ * */
+Dataset::Dataset(int dimension)
+{
+	this->features = dimension;
+}
+
+
+/********************************************************************
+ * @name	dimension
+ * @brief	Number of features per sample
+ * @param	none
+ * @return	D
+ * */
+int Dataset::dimension() const
+{
+	return features;
+}
+
+
+/********************************************************************
+ * @name	size
+ * @brief	Number of samples
+ * @param	none
+ * @return	N
+ * */
+size_t Dataset::size() const
+{
+	return number;
+}
+
+
+/********************************************************************
+ * @name	empty
+ * @brief	Whether there is no sample
+ * @param	none
+ * @return	True if N is 0
+ * */
+bool Dataset::empty() const
+{
+	return number == 0;
+}
+
+
+/********************************************************************
+ * @name	classNumber
+ * @brief	Number of known classes
+ * @param	none
+ * @return	K
+ * */
+int Dataset::classNumber() const
+{
+	return (int)classNames.size();
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Row-major feature buffer
+ * @param	none
+ * @return	Pointer to the first feature of the first sample
+ * */
+const double* Dataset::data() const
+{
+	return mapping != nullptr ? mappedValues : values.data();
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Row-major feature buffer
+ * @param	none
+ * @return	Pointer to the first feature of the first sample
+ * */
+double* Dataset::data()
+{
+	detach();
+	return values.data();
+}
+
+
+/********************************************************************
+ * @name	row
+ * @brief	Features of one sample
+ * @param	index - Sample index
+ * @return	Pointer to dimension() values
+ * */
+const double* Dataset::row(size_t index) const
+{
+	return data() + index * features;
+}
+
+
+/********************************************************************
+ * @name	row
+ * @brief	Features of one sample
+ * @param	index - Sample index
+ * @return	Pointer to dimension() values
+ * */
+double* Dataset::row(size_t index)
+{
+	detach();
+	return values.data() + index * features;
+}
+
+
+/********************************************************************
+ * @name	labelData
+ * @brief	Label array
+ * @param	none
+ * @return	Pointer to size() labels
+ * */
+const int* Dataset::labelData() const
+{
+	return mapping != nullptr ? mappedLabels : labels.data();
+}
+
+
+/********************************************************************
+ * @name	labelData
+ * @brief	Label array
+ * @param	none
+ * @return	Pointer to size() labels
+ * */
+int* Dataset::labelData()
+{
+	detach();
+	return labels.data();
+}
+
+
+/********************************************************************
+ * @name	label
+ * @brief	Class of one sample
+ * @param	index - Sample index
+ * @return	CLASS_UNKNOWN or 1 to classNumber()
+ * */
+int Dataset::label(size_t index) const
+{
+	return labelData()[index];
+}
+
+
+/********************************************************************
+ * @name	reserve
+ * @brief	Reserve room for a number of samples
+ * @param	number - Number of samples
+ * @return	none
+ * */
+void Dataset::reserve(size_t number)
+{
+	detach();
+	values.reserve(number * features);
+	labels.reserve(number);
+}
+
+
+/********************************************************************
+ * @name	resize
+ * @brief	Change the number of samples. New samples are zero and of
+ *			unknown class, so loaders can fill the buffers in place.
+ * @param	number - Number of samples
+ * @return	none
+ * */
+void Dataset::resize(size_t number)
+{
+	detach();
+	values.resize(number * features, 0.0);
+	labels.resize(number, CLASS_UNKNOWN);
+	this->number = number;
+}
+
+
+/********************************************************************
+ * @name	clear
+ * @brief	Remove every sample, the classes are kept
+ * @param	none
+ * @return	none
+ * */
+void Dataset::clear()
+{
+	mapping = nullptr;
+	mappedValues = nullptr;
+	mappedLabels = nullptr;
+	values.clear();
+	labels.clear();
+	number = 0;
+}
+
+
+/********************************************************************
+ * @name	append
+ * @brief	Add one sample
+ * @param	x - dimension() features
+ * @param	label - Class of the sample
+ * @return	none
+ * */
+void Dataset::append(const double* x, int label)
+{
+	detach();
+	values.insert(values.end(), x, x + features);
+	labels.push_back(label);
+	number++;
+}
+
+
+/********************************************************************
+ * @name	addClass
+ * @brief	Class of a name, registering the name if it is new
+ * @param	name - Class name
+ * @return	Label of the class
+ * */
+int Dataset::addClass(const string& name)
+{
+	unordered_map<string, int>::const_iterator found = classIndex.find(name);
+	if (found != classIndex.end())
+	{
+		return found->second;
+	}
+	classNames.push_back(name);
+	int label = (int)classNames.size();
+	classIndex[name] = label;
+	return label;
+}
+
+
+/********************************************************************
+ * @name	findClass
+ * @brief	Class of a name
+ * @param	name - Class name
+ * @return	Label of the class, CLASS_UNKNOWN if not registered
+ * */
+int Dataset::findClass(const string& name) const
+{
+	unordered_map<string, int>::const_iterator found = classIndex.find(name);
+	return found == classIndex.end() ? CLASS_UNKNOWN : found->second;
+}
+
+
+/********************************************************************
+ * @name	className
+ * @brief	Name of a class
+ * @param	label - Label of the class
+ * @return	Class name, "unknown" for CLASS_UNKNOWN
+ * */
+string Dataset::className(int label) const
+{
+	if (label < 1 || label > (int)classNames.size())
+	{
+		return "unknown";
+	}
+	return classNames[label - 1];
+}
+
+
+/********************************************************************
+ * @name	copyClasses
+ * @brief	Use the same dimension and class names as another set
+ * @param	other - Data set to copy from
+ * @return	none
+ * */
+void Dataset::copyClasses(const Dataset& other)
+{
+	features = other.features;
+	classNames = other.classNames;
+	classIndex = other.classIndex;
+}
+
+
+/********************************************************************
+ * @name	view
+ * @brief	Read the samples in place from a mapped file instead of
+ *			owning them. The rows must be FEATURE_ALIGNMENT aligned.
+ * @param	mapping - Mapped file, kept open while the data set views it
+ * @param	rows - Row-major number x dimension() features in the file
+ * @param	labels - number labels in the file
+ * @param	number - Number of samples
+ * @return	none
+ * */
+void Dataset::view(const shared_ptr<const MappedFile>& mapping, const double* rows, const int* labels,
+	size_t number)
+{
+	this->values.clear();
+	this->labels.clear();
+	this->mapping = mapping;
+	this->mappedValues = rows;
+	this->mappedLabels = labels;
+	this->number = number;
+}
+
+
+/********************************************************************
+ * @name	detach
+ * @brief	Copy the samples out of the mapped file before the data
+ *			set is modified; nothing to do when it owns them already
+ * @param	none
+ * @return	none
+ * */
+void Dataset::detach()
+{
+	if (mapping == nullptr)
+	{
+		return;
+	}
+	values.assign(mappedValues, mappedValues + number * features);
+	labels.assign(mappedLabels, mappedLabels + number);
+	mapping = nullptr;
+	mappedValues = nullptr;
+	mappedLabels = nullptr;
+}
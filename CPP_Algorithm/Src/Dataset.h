@@ -0,0 +1,112 @@
+/********************************************************************
+ * @File name:		Dataset.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-24
+ * @Description:	Declare the feature store shared by all algorithms
+ ********************************************************************/
+
+#pragma once
+
+#ifndef DATASET_H
+#define DATASET_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "AlignedAllocator.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Label of a sample whose class is unknown. Known classes are numbered
+// from 1 to classNumber().
+#define CLASS_UNKNOWN 0
+
+class MappedFile;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	Dataset
+ * @brief	N samples of D features in one 64-byte aligned row-major
+ *			buffer, with the labels in a separate array. D and the
+ *			class names are chosen at run time, usually by the file
+ *			reader. A data set loaded from a binary data set file
+ *			views the rows and labels inside the mapped file and
+ *			copies them only when it is first modified.
+ * */
+class Dataset
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Number of features per sample
+	int features = 0;
+	// Number of samples
+	size_t number = 0;
+	// Row-major number x features values
+	AlignedVector values;
+	// Class of each sample, CLASS_UNKNOWN or 1 to classNumber()
+	vector<int> labels;
+	// Name of each class, classNames[i] is class i + 1
+	vector<string> classNames;
+	// Class of each name
+	unordered_map<string, int> classIndex;
+	// Mapped file the samples are read from, null once they are in
+	// values and labels
+	shared_ptr<const MappedFile> mapping;
+	// Row-major features and labels inside the mapping
+	const double* mappedValues = nullptr;
+	const int* mappedLabels = nullptr;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void detach();
+
+public:
+	Dataset(int dimension = 0);
+	int dimension() const;
+	size_t size() const;
+	bool empty() const;
+	int classNumber() const;
+	const double* data() const;
+	double* data();
+	const double* row(size_t index) const;
+	double* row(size_t index);
+	const int* labelData() const;
+	int* labelData();
+	int label(size_t index) const;
+	void reserve(size_t number);
+	void resize(size_t number);
+	void clear();
+	void append(const double* x, int label);
+	int addClass(const string& name);
+	int findClass(const string& name) const;
+	string className(int label) const;
+	void copyClasses(const Dataset& other);
+	void view(const shared_ptr<const MappedFile>& mapping, const double* rows, const int* labels,
+		size_t number);
+};
+
+#endif
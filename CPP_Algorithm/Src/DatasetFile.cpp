@@ -0,0 +1,362 @@
+/********************************************************************
+ * @File name:		DatasetFile.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-28
+ * @Description:	Binary columnar data set file
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "DatasetFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+bool littleEndianHost();
+uint64_t alignOffset(uint64_t offset);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	DatasetFile
+ * @brief	The constructor. Nothing is mapped until open().
+ * */
+DatasetFile::DatasetFile()
+{
+	memset(&header, 0, sizeof(header));
+}
+
+
+/********************************************************************
+ * @name	open
+ * @brief	Map a data set file and check that its header and
+ *			sections fit in the file
+ * @param	filename - Name and path of the file
+ * @return	Whether the file is a valid data set file
+ * */
+bool DatasetFile::open(const string& filename)
+{
+	close();
+	file = make_shared<MappedFile>();
+	if (!file->open(filename))
+	{
+		cout << "File opening failure!\n";
+		return false;
+	}
+	const char* data = file->data();
+	uint64_t size = file->size();
+	if (!isDatasetFile(data, size) || !littleEndianHost())
+	{
+		cout << "Not a data set file: " << filename << "\n";
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	bool valid = header.version == DATASET_FILE_VERSION && header.dtype == DATASET_DTYPE_FLOAT64;
+	// Label dictionary
+	uint64_t offset = header.dictionaryOffset;
+	for (uint32_t k = 0; valid && k < header.classNumber; k++)
+	{
+		uint32_t length;
+		if (offset > size || size - offset < sizeof(length))
+		{
+			valid = false;
+			break;
+		}
+		memcpy(&length, data + offset, sizeof(length));
+		offset += sizeof(length);
+		if (size - offset < length)
+		{
+			valid = false;
+			break;
+		}
+		classNames.push_back(string(data + offset, length));
+		offset += length;
+	}
+	// Feature and label columns
+	const uint64_t element = sizeof(double);
+	valid = valid && header.columnOffset % FEATURE_ALIGNMENT == 0 && header.columnOffset <= size
+		&& header.columnStride >= header.number && header.columnStride % (FEATURE_ALIGNMENT / element) == 0
+		&& (header.dimension == 0
+			|| header.columnStride <= (size - header.columnOffset) / element / header.dimension)
+		&& header.labelOffset % sizeof(int32_t) == 0 && header.labelOffset <= size
+		&& header.number <= (size - header.labelOffset) / sizeof(int32_t);
+	// Rows, checked per row so the size cannot overflow
+	rowOffset = alignOffset(header.labelOffset + header.number * sizeof(int32_t));
+	valid = valid && rowOffset <= size
+		&& (header.dimension == 0
+			|| header.number <= (size - rowOffset) / element / header.dimension);
+	if (valid)
+	{
+		const int32_t* label = labels();
+		for (uint64_t i = 0; i < header.number; i++)
+		{
+			if (label[i] < CLASS_UNKNOWN || label[i] > (int32_t)header.classNumber)
+			{
+				valid = false;
+				break;
+			}
+		}
+	}
+	if (!valid)
+	{
+		cout << "Corrupted data set file: " << filename << "\n";
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	close
+ * @brief	Unmap the file
+ * @param	none
+ * @return	none
+ * */
+void DatasetFile::close()
+{
+	// Data sets viewing the mapping keep it open
+	file = nullptr;
+	memset(&header, 0, sizeof(header));
+	rowOffset = 0;
+	classNames.clear();
+}
+
+
+/********************************************************************
+ * @name	size
+ * @brief	Number of samples
+ * @param	none
+ * @return	N
+ * */
+size_t DatasetFile::size() const
+{
+	return (size_t)header.number;
+}
+
+
+/********************************************************************
+ * @name	dimension
+ * @brief	Number of features per sample
+ * @param	none
+ * @return	D
+ * */
+int DatasetFile::dimension() const
+{
+	return (int)header.dimension;
+}
+
+
+/********************************************************************
+ * @name	classNumber
+ * @brief	Number of classes
+ * @param	none
+ * @return	K
+ * */
+int DatasetFile::classNumber() const
+{
+	return (int)header.classNumber;
+}
+
+
+/********************************************************************
+ * @name	className
+ * @brief	Name of a class
+ * @param	label - Label of the class
+ * @return	Class name, "unknown" for CLASS_UNKNOWN
+ * */
+string DatasetFile::className(int label) const
+{
+	if (label < 1 || label > (int)classNames.size())
+	{
+		return "unknown";
+	}
+	return classNames[label - 1];
+}
+
+
+/********************************************************************
+ * @name	column
+ * @brief	One feature of every sample, inside the mapping
+ * @param	feature - Feature index
+ * @return	Pointer to size() values, aligned to FEATURE_ALIGNMENT
+ * */
+const double* DatasetFile::column(int feature) const
+{
+	return (const double*)(file->data() + header.columnOffset) + feature * header.columnStride;
+}
+
+
+/********************************************************************
+ * @name	labels
+ * @brief	Class of every sample, inside the mapping
+ * @param	none
+ * @return	Pointer to size() labels
+ * */
+const int32_t* DatasetFile::labels() const
+{
+	return (const int32_t*)(file->data() + header.labelOffset);
+}
+
+
+/********************************************************************
+ * @name	rows
+ * @brief	Features of every sample row by row, inside the mapping
+ * @param	none
+ * @return	Pointer to size() x dimension() values, aligned to
+ *			FEATURE_ALIGNMENT
+ * */
+const double* DatasetFile::rows() const
+{
+	return (const double*)(file->data() + rowOffset);
+}
+
+
+/********************************************************************
+ * @name	toDataset
+ * @brief	A data set that views the rows and labels inside the
+ *			mapping, so loading copies nothing. The mapping stays
+ *			open while the data set lives, also after close().
+ * @param	none
+ * @return	Pointer of the dataset
+ * */
+Dataset* DatasetFile::toDataset() const
+{
+	Dataset* dataset = new Dataset(dimension());
+	for (const string& name : classNames)
+	{
+		dataset->addClass(name);
+	}
+	static_assert(sizeof(int) == sizeof(int32_t), "Labels are stored as int32");
+	dataset->view(file, rows(), (const int*)labels(), size());
+	return dataset;
+}
+
+
+/********************************************************************
+ * @name	isDatasetFile
+ * @brief	Whether a buffer starts with the data set file magic
+ * @param	data - First bytes of a file
+ * @param	size - Number of bytes
+ * @return	True for a data set file
+ * */
+bool DatasetFile::isDatasetFile(const char* data, size_t size)
+{
+	return size >= sizeof(DatasetFileHeader) && memcmp(data, DATASET_FILE_MAGIC, 8) == 0;
+}
+
+
+/********************************************************************
+ * @name	write
+ * @brief	Store a data set as a binary columnar file
+ * @param	dataset - Data set to store
+ * @param	filename - Name and path of the file
+ * @return	Whether the file was written
+ * */
+bool DatasetFile::write(const Dataset& dataset, const string& filename)
+{
+	if (!littleEndianHost())
+	{
+		cout << "Data set files can only be written on little-endian hosts!\n";
+		return false;
+	}
+	const size_t lane = FEATURE_ALIGNMENT / sizeof(double);
+	size_t n = dataset.size();
+	int d = dataset.dimension();
+	DatasetFileHeader head;
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, DATASET_FILE_MAGIC, 8);
+	head.version = DATASET_FILE_VERSION;
+	head.dtype = DATASET_DTYPE_FLOAT64;
+	head.number = n;
+	head.dimension = d;
+	head.classNumber = dataset.classNumber();
+	head.dictionaryOffset = sizeof(head);
+	uint64_t dictionarySize = 0;
+	for (int k = 1; k <= dataset.classNumber(); k++)
+	{
+		dictionarySize += sizeof(uint32_t) + dataset.className(k).size();
+	}
+	head.columnOffset = alignOffset(head.dictionaryOffset + dictionarySize);
+	head.columnStride = (n + lane - 1) / lane * lane;
+	head.labelOffset = head.columnOffset + d * head.columnStride * sizeof(double);
+
+	ofstream out(filename, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cout << "File opening failure!\n";
+		return false;
+	}
+	out.write((const char*)&head, sizeof(head));
+	for (int k = 1; k <= dataset.classNumber(); k++)
+	{
+		string name = dataset.className(k);
+		uint32_t length = (uint32_t)name.size();
+		out.write((const char*)&length, sizeof(length));
+		out.write(name.data(), length);
+	}
+	vector<char> padding(head.columnOffset - head.dictionaryOffset - dictionarySize, 0);
+	out.write(padding.data(), padding.size());
+	// Gather one feature column at a time, the padding stays zero
+	vector<double> values(head.columnStride, 0.0);
+	const double* rows = dataset.data();
+	for (int f = 0; f < d; f++)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			values[i] = rows[i * d + f];
+		}
+		out.write((const char*)values.data(), values.size() * sizeof(double));
+	}
+	out.write((const char*)dataset.labelData(), n * sizeof(int32_t));
+	uint64_t rowStart = alignOffset(head.labelOffset + n * sizeof(int32_t));
+	padding.assign(rowStart - head.labelOffset - n * sizeof(int32_t), 0);
+	out.write(padding.data(), padding.size());
+	out.write((const char*)rows, n * d * sizeof(double));
+	out.close();
+	if (!out)
+	{
+		cout << "Unable to write the data set file!\n";
+		return false;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	littleEndianHost
+ * @brief	Whether the host stores integers little endian, as the
+ *			file does
+ * @param	none
+ * @return	True on little-endian hosts
+ * */
+bool littleEndianHost()
+{
+	const uint16_t probe = 1;
+	unsigned char first;
+	memcpy(&first, &probe, 1);
+	return first == 1;
+}
+
+
+/********************************************************************
+ * @name	alignOffset
+ * @brief	Round a file offset up to FEATURE_ALIGNMENT
+ * @param	offset - Byte offset
+ * @return	The aligned offset
+ * */
+uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + FEATURE_ALIGNMENT - 1) / FEATURE_ALIGNMENT * FEATURE_ALIGNMENT;
+}
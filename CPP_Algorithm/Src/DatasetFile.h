@@ -0,0 +1,127 @@
+/********************************************************************
+ * @File name:		DatasetFile.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-28
+ * @Description:	Declare the binary columnar data set file
+ ********************************************************************/
+
+#pragma once
+
+#ifndef DATASETFILE_H
+#define DATASETFILE_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Dataset.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// First bytes of every data set file
+#define DATASET_FILE_MAGIC "PZDSET\r\n"
+// Current layout version
+#define DATASET_FILE_VERSION 2
+// Element type of the feature columns: IEEE 754 double
+#define DATASET_DTYPE_FLOAT64 1
+
+/********************************************************************
+ * @name	DatasetFileHeader
+ * @brief	First 64 bytes of a data set file. All values are little
+ *			endian. The file continues with the label dictionary,
+ *			classNumber entries of a uint32 length and the name bytes,
+ *			then dimension feature columns of columnStride elements,
+ *			each starting on a 64-byte boundary, then the label column
+ *			of number int32 values (0 for an unknown class), then the
+ *			same features row by row, number x dimension values from
+ *			the next 64-byte boundary, which a loaded Dataset views
+ *			in place.
+ * */
+typedef struct
+{
+	// DATASET_FILE_MAGIC
+	char magic[8];
+	// DATASET_FILE_VERSION
+	uint32_t version;
+	// Element type of the feature columns
+	uint32_t dtype;
+	// Number of samples N
+	uint64_t number;
+	// Number of features D
+	uint32_t dimension;
+	// Number of classes K
+	uint32_t classNumber;
+	// Byte offset of the label dictionary
+	uint64_t dictionaryOffset;
+	// Byte offset of the first feature column
+	uint64_t columnOffset;
+	// Distance between two feature columns, in elements
+	uint64_t columnStride;
+	// Byte offset of the label column
+	uint64_t labelOffset;
+}DatasetFileHeader;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	DatasetFile
+ * @brief	Binary columnar data set. open() maps the file and checks
+ *			the header; the feature and label columns and the rows
+ *			are then read straight from the mapping without copying
+ *			or parsing. write() produces the file from a loaded data
+ *			set.
+ * */
+class DatasetFile
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// The mapped file, shared with the data sets that view it
+	shared_ptr<MappedFile> file;
+	// Header of the mapped file
+	DatasetFileHeader header;
+	// Byte offset of the rows, after the label column
+	uint64_t rowOffset = 0;
+	// Class names of the dictionary
+	vector<string> classNames;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	DatasetFile();
+	bool open(const string& filename);
+	void close();
+	size_t size() const;
+	int dimension() const;
+	int classNumber() const;
+	string className(int label) const;
+	const double* column(int feature) const;
+	const int32_t* labels() const;
+	const double* rows() const;
+	Dataset* toDataset() const;
+	static bool isDatasetFile(const char* data, size_t size);
+	static bool write(const Dataset& dataset, const string& filename);
+};
+
+#endif
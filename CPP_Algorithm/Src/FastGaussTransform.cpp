@@ -0,0 +1,800 @@
+/********************************************************************
+ * @File name:		FastGaussTransform.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-18
+ * @Description:	Improved Fast Gauss Transform
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "FastGaussTransform.h"
+#include "Arena.h"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <math.h>
+#include <stdexcept>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Cluster radius planned for sources inserted into an empty
+// transform, in units of the bandwidth
+const double IFGT_TARGET_RADIUS = 0.5;
+// Upper limit of the number of clusters
+const size_t IFGT_MAX_CLUSTERS = 1024;
+// Upper limit of the truncation order
+const int IFGT_MAX_ORDER = 30;
+// Upper limit of the number of expansion terms
+const double IFGT_MAX_TERMS = 100000;
+// Upper limit of the number of coefficients, clusters x classes x
+// terms, 64 MB
+const double IFGT_MAX_COEFFICIENTS = 8e6;
+// Sources the number of clusters within the cut-off of a query is
+// estimated from
+const size_t IFGT_COST_PROBES = 32;
+// Cost of a query in nanoseconds on a current x86 core, measured: per
+// center plus per feature of its distance, per cluster within the
+// cut-off plus per term and class of its expansion, and per source
+// plus per source and feature of the exact SIMD sums
+const double IFGT_CENTER_COST = 3.0;
+const double IFGT_FEATURE_COST = 0.5;
+const double IFGT_EXPANSION_COST = 20.0;
+const double IFGT_TERM_COST = 1.0;
+const double IFGT_DIRECT_COST = 1.0;
+const double IFGT_DIRECT_FEATURE_COST = 0.2;
+
+// Sections of a saved transform, after the first section id
+enum
+{
+	IFGT_SECTION_PARAMETERS,
+	IFGT_SECTION_CENTERS,
+	IFGT_SECTION_COEFFICIENTS,
+	IFGT_SECTION_CLUSTER_COUNT
+};
+
+/********************************************************************
+ * @name	GaussTransformParameters
+ * @brief	Scalars of a saved transform
+ * */
+typedef struct
+{
+	// Truncation order and number of expansion terms
+	int32_t p;
+	int32_t terms;
+	// Number of clusters
+	uint64_t clusters;
+	double bandwidth;
+	double cutoffRadius;
+	double clusterRadius;
+	double epsilon;
+	double bound;
+}GaussTransformParameters;
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	FastGaussTransform
+ * @brief	The constructor. Creates an empty transform.
+ * */
+FastGaussTransform::FastGaussTransform()
+{
+}
+
+
+/********************************************************************
+ * @name	build
+ * @brief	Cluster the sources and compute the expansion coefficients
+ *			of every cluster and class. Farthest-point clustering
+ *			gives the radius reached with every number of clusters
+ *			K; for each K the smallest order meeting epsilon fixes
+ *			the number of terms, and the clusters within the cut-off
+ *			of a few sources estimate how many expansions a query
+ *			evaluates. The cheapest K whose coefficients fit in
+ *			IFGT_MAX_COEFFICIENTS is kept, provided a query costs
+ *			less than the exact sum over every source.
+ * @param	points - Row-major number x dimension sources
+ * @param	labels - Class of each source, from 0 to classes - 1
+ * @param	number - Number of sources
+ * @param	dimension - Number of features
+ * @param	classes - Number of classes
+ * @param	bandwidth - Bandwidth b of exp(-|y - x|^2 / b^2)
+ * @param	epsilon - Target error of the mean kernel value of a class
+ * @param	ids - Id of each source for remove(), nullptr to number the
+ *			sources from 0
+ * @return	False when epsilon cannot be met within the limits, or
+ *			when the exact sums are cheaper; the transform is then
+ *			empty
+ * */
+bool FastGaussTransform::build(const double* points, const int* labels, size_t number,
+	int dimension, int classes, double bandwidth, double epsilon, const size_t* ids)
+{
+	this->dimension = dimension;
+	this->classes = classes;
+	this->bandwidth = bandwidth;
+	this->epsilon = epsilon;
+	isMapped = false;
+	centers.clear();
+	coefficients.clear();
+	clusterCount.clear();
+	sourceCluster.clear();
+	clusterRadius = 0;
+	clusterLimit = 0;
+	if (number == 0)
+	{
+		// Sources inserted later open clusters of the default radius
+		int order = orderFor(IFGT_TARGET_RADIUS);
+		if (order == 0)
+		{
+			cout << "IFGT cannot reach the accuracy " << epsilon << " within its limits" << endl;
+			return false;
+		}
+		setOrder(order);
+		targetRadius = IFGT_TARGET_RADIUS * bandwidth;
+		clusterLimit = clustersFor(terms);
+		return true;
+	}
+
+	// Farthest-point clustering, radius[k] is reached with k + 1 clusters.
+	// More centers than the exact sums can afford are never kept.
+	double directCost = number * (IFGT_DIRECT_COST + IFGT_DIRECT_FEATURE_COST * dimension);
+	double centerCost = IFGT_CENTER_COST + IFGT_FEATURE_COST * dimension;
+	size_t maxClusters = min(min(number, IFGT_MAX_CLUSTERS), (size_t)(directCost / centerCost) + 1);
+	vector<double> nearest(number, HUGE_VAL);
+	vector<size_t> seeds;
+	vector<double> radius;
+	size_t next = 0;
+	while (true)
+	{
+		seeds.push_back(next);
+		const double* center = points + next * dimension;
+		double farthest = 0;
+		for (size_t i = 0; i < number; i++)
+		{
+			double distance = 0;
+			for (int f = 0; f < dimension; f++)
+			{
+				double diff = points[i * dimension + f] - center[f];
+				distance += diff * diff;
+			}
+			if (distance < nearest[i])
+			{
+				nearest[i] = distance;
+			}
+			if (nearest[i] > farthest)
+			{
+				farthest = nearest[i];
+				next = i;
+			}
+		}
+		radius.push_back(sqrt(farthest));
+		// Smaller clusters cannot lower the order below 1
+		if (farthest == 0 || seeds.size() >= maxClusters || orderFor(radius.back() / bandwidth) == 1)
+		{
+			break;
+		}
+	}
+
+	// Squared distances from evenly spaced sources to every center
+	size_t probes = min(number, IFGT_COST_PROBES);
+	size_t seedNumber = seeds.size();
+	vector<double> probeDistance(probes * seedNumber);
+	for (size_t q = 0; q < probes; q++)
+	{
+		const double* y = points + q * number / probes * dimension;
+		for (size_t k = 0; k < seedNumber; k++)
+		{
+			const double* center = points + seeds[k] * dimension;
+			double distance = 0;
+			for (int f = 0; f < dimension; f++)
+			{
+				double diff = y[f] - center[f];
+				distance += diff * diff;
+			}
+			probeDistance[q * seedNumber + k] = distance;
+		}
+	}
+	double tail = epsilon < 1 ? sqrt(log(1 / epsilon)) : 0;
+	double bestCost = HUGE_VAL;
+	size_t bestClusters = 0;
+	int bestOrder = 0;
+	for (size_t k = 1; k <= seedNumber; k++)
+	{
+		double rx = radius[k - 1] / bandwidth;
+		int order = orderFor(rx);
+		if (order == 0 || clustersFor((int)(termCount(order) + 0.5)) < k)
+		{
+			continue;
+		}
+		double cutoff = (rx + tail) * bandwidth;
+		size_t within = 0;
+		for (size_t q = 0; q < probes; q++)
+		{
+			for (size_t j = 0; j < k; j++)
+			{
+				within += probeDistance[q * seedNumber + j] <= cutoff * cutoff;
+			}
+		}
+		// Distances to the centers, then the monomials and the
+		// coefficients of every class of the clusters within the cut-off
+		double cost = (double)within / probes
+			* (IFGT_EXPANSION_COST + termCount(order) * (classes + 1) * IFGT_TERM_COST) + k * centerCost;
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestClusters = k;
+			bestOrder = order;
+		}
+	}
+	if (bestClusters == 0)
+	{
+		// When the clusters were capped by the cost of the exact sums
+		// rather than by the limits, more of them might reach the
+		// accuracy but could not be cheaper
+		if (maxClusters == min(number, IFGT_MAX_CLUSTERS))
+		{
+			cout << "IFGT cannot reach the accuracy " << epsilon << " within its limits" << endl;
+		}
+		return false;
+	}
+	if (bestCost >= directCost)
+	{
+		return false;
+	}
+
+	// Sources go to the nearest of the kept centers
+	vector<int> assignment(number, 0);
+	for (size_t k = 0; k < bestClusters; k++)
+	{
+		const double* center = points + seeds[k] * dimension;
+		centers.insert(centers.end(), center, center + dimension);
+	}
+	for (size_t i = 0; i < number; i++)
+	{
+		double best = HUGE_VAL;
+		for (size_t k = 0; k < bestClusters; k++)
+		{
+			double distance = 0;
+			for (int f = 0; f < dimension; f++)
+			{
+				double diff = points[i * dimension + f] - centers[k * dimension + f];
+				distance += diff * diff;
+			}
+			if (distance < best)
+			{
+				best = distance;
+				assignment[i] = (int)k;
+			}
+		}
+	}
+	clusterRadius = radius[bestClusters - 1];
+	setOrder(bestOrder);
+	targetRadius = clusterRadius;
+	clusterLimit = max(clustersFor(terms), bestClusters);
+
+	// Expansion coefficients
+	coefficients.assign((size_t)clusterNumber() * classes * terms, 0.0);
+	clusterCount.assign(clusterNumber(), 0);
+	for (size_t i = 0; i < number; i++)
+	{
+		size_t id = ids != nullptr ? ids[i] : i;
+		if (id >= sourceCluster.size())
+		{
+			sourceCluster.resize(id + 1, -1);
+		}
+		sourceCluster[id] = assignment[i];
+		clusterCount[assignment[i]]++;
+		accumulate(assignment[i], points + i * dimension, labels[i], 1);
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	insert
+ * @brief	Add one source to the nearest cluster. A source farther
+ *			than the planned radius from every center becomes the
+ *			center of an empty cluster, or of a new one while the
+ *			coefficients fit in IFGT_MAX_COEFFICIENTS. Otherwise the
+ *			cluster radius grows, and with it errorBound().
+ * @param	x - Features of the source
+ * @param	label - Class of the source, from 0 to classes - 1
+ * @param	id - Id of the source, not in use
+ * @return	none
+ * */
+void FastGaussTransform::insert(const double* x, int label, size_t id)
+{
+	if (isMapped)
+	{
+		throw logic_error("FastGaussTransform::insert");
+	}
+	double distance = HUGE_VAL;
+	int cluster = nearestCenter(x, &distance);
+	if (cluster < 0 || distance > targetRadius)
+	{
+		int empty = (int)(find(clusterCount.begin(), clusterCount.end(), 0) - clusterCount.begin());
+		if (empty < clusterNumber())
+		{
+			copy(x, x + dimension, centers.begin() + (size_t)empty * dimension);
+			cluster = empty;
+			distance = 0;
+		}
+		else if ((size_t)clusterNumber() < clusterLimit)
+		{
+			cluster = clusterNumber();
+			centers.insert(centers.end(), x, x + dimension);
+			coefficients.resize(coefficients.size() + (size_t)classes * terms, 0.0);
+			clusterCount.push_back(0);
+			distance = 0;
+		}
+	}
+	if (distance > clusterRadius)
+	{
+		clusterRadius = distance;
+		updateBound();
+	}
+	if (id >= sourceCluster.size())
+	{
+		sourceCluster.resize(id + 1, -1);
+	}
+	sourceCluster[id] = cluster;
+	clusterCount[cluster]++;
+	accumulate(cluster, x, label, 1);
+}
+
+
+/********************************************************************
+ * @name	remove
+ * @brief	Subtract one source from the cluster it was added to. The
+ *			coefficients of a cluster left empty are cleared, so no
+ *			rounding error stays behind.
+ * @param	x - Features of the source, as inserted
+ * @param	label - Class of the source
+ * @param	id - Id of the source
+ * @return	none
+ * */
+void FastGaussTransform::remove(const double* x, int label, size_t id)
+{
+	if (isMapped)
+	{
+		throw logic_error("FastGaussTransform::remove");
+	}
+	if (id >= sourceCluster.size() || sourceCluster[id] < 0)
+	{
+		return;
+	}
+	int cluster = sourceCluster[id];
+	sourceCluster[id] = -1;
+	if (--clusterCount[cluster] == 0)
+	{
+		fill(coefficients.begin() + (size_t)cluster * classes * terms,
+			coefficients.begin() + (size_t)(cluster + 1) * classes * terms, 0.0);
+		return;
+	}
+	accumulate(cluster, x, label, -1);
+}
+
+
+/********************************************************************
+ * @name	accumulate
+ * @brief	Add the expansion terms of one source to the coefficients
+ *			of its cluster and class
+ * @param	cluster - Cluster of the source
+ * @param	x - Features of the source
+ * @param	label - Class of the source
+ * @param	sign - 1 to add the source, -1 to remove it
+ * @return	none
+ * */
+void FastGaussTransform::accumulate(int cluster, const double* x, int label, double sign)
+{
+	ArenaScope scratch;
+	double* monomials = scratch.allocate<double>(terms);
+	double* v = scratch.allocate<double>(dimension);
+	const double* center = centers.data() + (size_t)cluster * dimension;
+	double distance = 0;
+	for (int f = 0; f < dimension; f++)
+	{
+		v[f] = (x[f] - center[f]) / bandwidth;
+		distance += v[f] * v[f];
+	}
+	double weight = sign * exp(-distance);
+	computeMonomials(v, monomials);
+	double* coefficient = coefficients.data() + ((size_t)cluster * classes + label) * terms;
+	for (int t = 0; t < terms; t++)
+	{
+		coefficient[t] += weight * constants[t] * monomials[t];
+	}
+}
+
+
+/********************************************************************
+ * @name	nearestCenter
+ * @brief	Closest center of a cluster with sources, the first one
+ *			on ties
+ * @param	x - Point
+ * @param	distance - Output, distance to the center
+ * @return	Cluster index, -1 without clusters
+ * */
+int FastGaussTransform::nearestCenter(const double* x, double* distance) const
+{
+	int nearest = -1;
+	double best = HUGE_VAL;
+	int clusters = clusterNumber();
+	for (int k = 0; k < clusters; k++)
+	{
+		if (clusterCount[k] == 0)
+		{
+			continue;
+		}
+		const double* center = centers.data() + (size_t)k * dimension;
+		double squared = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			double diff = x[f] - center[f];
+			squared += diff * diff;
+		}
+		if (squared < best)
+		{
+			best = squared;
+			nearest = k;
+		}
+	}
+	*distance = sqrt(best);
+	return nearest;
+}
+
+
+/********************************************************************
+ * @name	orderFor
+ * @brief	Smallest order meeting the accuracy for a cluster radius
+ * @param	rx - Cluster radius in units of the bandwidth
+ * @return	The order, 0 when no order within IFGT_MAX_ORDER and
+ *			IFGT_MAX_TERMS meets it
+ * */
+int FastGaussTransform::orderFor(double rx) const
+{
+	for (int order = 1; order <= IFGT_MAX_ORDER && termCount(order) <= IFGT_MAX_TERMS; order++)
+	{
+		if (truncationBound(order, rx) <= epsilon)
+		{
+			return order;
+		}
+	}
+	return 0;
+}
+
+
+/********************************************************************
+ * @name	termCount
+ * @brief	Number of terms of total degree below an order,
+ *			C(order - 1 + d, d)
+ * @param	order - Truncation order
+ * @return	Number of terms, as a double so it cannot overflow
+ * */
+double FastGaussTransform::termCount(int order) const
+{
+	// C(q + d, d) = C(q - 1 + d, d) * (q + d) / q
+	double combinations = 1;
+	for (int q = 1; q < order; q++)
+	{
+		combinations = combinations * (q + dimension) / q;
+	}
+	return combinations;
+}
+
+
+/********************************************************************
+ * @name	clustersFor
+ * @brief	Number of clusters whose coefficients fit in
+ *			IFGT_MAX_COEFFICIENTS
+ * @param	count - Number of expansion terms
+ * @return	Number of clusters, at most IFGT_MAX_CLUSTERS
+ * */
+size_t FastGaussTransform::clustersFor(int count) const
+{
+	double clusters = floor(IFGT_MAX_COEFFICIENTS / ((double)max(classes, 1) * count));
+	return clusters < IFGT_MAX_CLUSTERS ? (size_t)clusters : IFGT_MAX_CLUSTERS;
+}
+
+
+/********************************************************************
+ * @name	setOrder
+ * @brief	Use a truncation order. Sets the number of terms, their
+ *			constants, the cut-off and the bound.
+ * @param	order - Truncation order
+ * @return	none
+ * */
+void FastGaussTransform::setOrder(int order)
+{
+	p = order;
+	terms = (int)(termCount(order) + 0.5);
+	constants.resize(terms);
+	computeConstants(constants.data());
+	updateBound();
+}
+
+
+/********************************************************************
+ * @name	updateBound
+ * @brief	Cut-off radius and error bound for the current cluster
+ *			radius and order
+ * @param	none
+ * @return	none
+ * */
+void FastGaussTransform::updateBound()
+{
+	double rx = clusterRadius / bandwidth;
+	// Beyond the cut-off every source contributes less than epsilon
+	double ry = rx + (epsilon < 1 ? sqrt(log(1 / epsilon)) : 0);
+	cutoffRadius = ry * bandwidth;
+	bound = max(truncationBound(p, rx), exp(-(ry - rx) * (ry - rx)));
+}
+
+
+/********************************************************************
+ * @name	kernelSums
+ * @brief	Gaussian kernel sum of each class at a query point
+ * @param	y - Query point
+ * @param	sums - Output, one kernel sum per class
+ * @return	none
+ * */
+void FastGaussTransform::kernelSums(const double* y, double* sums) const
+{
+	for (int c = 0; c < classes; c++)
+	{
+		sums[c] = 0;
+	}
+	ArenaScope scratch;
+	double* monomials = scratch.allocate<double>(terms);
+	double* v = scratch.allocate<double>(dimension);
+	int clusters = clusterNumber();
+	const double* centerData = isMapped ? mappedCenters : centers.data();
+	const double* coefficientData = isMapped ? mappedCoefficients : coefficients.data();
+	const size_t* count = isMapped ? mappedCount : clusterCount.data();
+	double cutoff = cutoffRadius * cutoffRadius;
+	for (int k = 0; k < clusters; k++)
+	{
+		if (count[k] == 0)
+		{
+			continue;
+		}
+		const double* center = centerData + (size_t)k * dimension;
+		double distance = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			double diff = y[f] - center[f];
+			distance += diff * diff;
+		}
+		if (distance > cutoff)
+		{
+			continue;
+		}
+		for (int f = 0; f < dimension; f++)
+		{
+			v[f] = (y[f] - center[f]) / bandwidth;
+		}
+		double weight = exp(-distance / (bandwidth * bandwidth));
+		computeMonomials(v, monomials);
+		for (int c = 0; c < classes; c++)
+		{
+			const double* coefficient = coefficientData + ((size_t)k * classes + c) * terms;
+			double sum = 0;
+			for (int t = 0; t < terms; t++)
+			{
+				sum += coefficient[t] * monomials[t];
+			}
+			sums[c] += weight * sum;
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	computeMonomials
+ * @brief	All monomials v^alpha with |alpha| < p in graded order.
+ *			Each degree is built from the previous one: the block
+ *			starting at heads[i] holds the monomials whose lowest
+ *			variable is i, so multiplying by v[i] never repeats one.
+ * @param	v - Point relative to a center, in units of the bandwidth
+ * @param	monomials - Output, terms values
+ * @return	none
+ * */
+void FastGaussTransform::computeMonomials(const double* v, double* monomials) const
+{
+	ArenaScope scratch;
+	int* heads = scratch.allocate<int>(dimension, 0);
+	monomials[0] = 1;
+	int t = 1;
+	int tail = 1;
+	for (int k = 1; k < p; k++)
+	{
+		for (int i = 0; i < dimension; i++)
+		{
+			int head = heads[i];
+			heads[i] = t;
+			for (int j = head; j < tail; j++)
+			{
+				monomials[t++] = v[i] * monomials[j];
+			}
+		}
+		tail = t;
+	}
+}
+
+
+/********************************************************************
+ * @name	computeConstants
+ * @brief	The factors 2^|alpha| / alpha! in the order used by
+ *			computeMonomials
+ * @param	constants - Output, terms values
+ * @return	none
+ * */
+void FastGaussTransform::computeConstants(double* constants) const
+{
+	vector<int> heads(dimension + 1, 0);
+	vector<int> power(terms, 0);
+	heads[dimension] = INT_MAX;
+	constants[0] = 1;
+	int t = 1;
+	int tail = 1;
+	for (int k = 1; k < p; k++)
+	{
+		for (int i = 0; i < dimension; i++)
+		{
+			int head = heads[i];
+			heads[i] = t;
+			for (int j = head; j < tail; j++, t++)
+			{
+				// Exponent of v[i] in the new monomial
+				power[t] = (j < heads[i + 1]) ? power[j] + 1 : 1;
+				constants[t] = 2.0 * constants[j] / power[t];
+			}
+		}
+		tail = t;
+	}
+}
+
+
+/********************************************************************
+ * @name	truncationBound
+ * @brief	Error per source of truncating the expansion at order p,
+ *			maximised over the query distance:
+ *			2^p / p! * (rx * ry)^p * exp(-(ry - rx)^2) with
+ *			ry = (rx + sqrt(rx^2 + 2p)) / 2
+ * @param	p - Truncation order
+ * @param	rx - Cluster radius in units of the bandwidth
+ * @return	The bound
+ * */
+double FastGaussTransform::truncationBound(int p, double rx)
+{
+	if (rx <= 0)
+	{
+		return 0;
+	}
+	double ry = (rx + sqrt(rx * rx + 2.0 * p)) / 2;
+	return exp(p * log(2.0) - lgamma(p + 1.0) + p * log(rx * ry) - (ry - rx) * (ry - rx));
+}
+
+
+/********************************************************************
+ * @name	clusterNumber
+ * @brief	Number of clusters
+ * @param	none
+ * @return	Number of clusters
+ * */
+int FastGaussTransform::clusterNumber() const
+{
+	if (isMapped)
+	{
+		return mappedClusters;
+	}
+	return dimension > 0 ? (int)(centers.size() / dimension) : 0;
+}
+
+
+/********************************************************************
+ * @name	order
+ * @brief	Truncation order p
+ * @param	none
+ * @return	Truncation order
+ * */
+int FastGaussTransform::order() const
+{
+	return p;
+}
+
+
+/********************************************************************
+ * @name	errorBound
+ * @brief	Guaranteed error of the mean kernel value of a class. It
+ *			exceeds the requested epsilon only when the expansion
+ *			size limit was reached.
+ * @param	none
+ * @return	The bound
+ * */
+double FastGaussTransform::errorBound() const
+{
+	return bound;
+}
+
+
+/********************************************************************
+ * @name	save
+ * @brief	Add the centers and the expansions to a model file
+ * @param	writer - Model file being written
+ * @param	firstSection - Id of the first of the transform's sections
+ * @return	none
+ * */
+void FastGaussTransform::save(ModelWriter& writer, uint32_t firstSection) const
+{
+	size_t clusters = clusterNumber();
+	GaussTransformParameters parameters = { p, terms, clusters, bandwidth, cutoffRadius,
+		clusterRadius, epsilon, bound };
+	writer.add(firstSection + IFGT_SECTION_PARAMETERS, &parameters, sizeof(parameters));
+	writer.add(firstSection + IFGT_SECTION_CENTERS, isMapped ? mappedCenters : centers.data(),
+		clusters * dimension * sizeof(double));
+	writer.add(firstSection + IFGT_SECTION_COEFFICIENTS, isMapped ? mappedCoefficients : coefficients.data(),
+		clusters * classes * terms * sizeof(double));
+	writer.add(firstSection + IFGT_SECTION_CLUSTER_COUNT, isMapped ? mappedCount : clusterCount.data(),
+		clusters * sizeof(size_t));
+}
+
+
+/********************************************************************
+ * @name	load
+ * @brief	Serve queries from a transform inside a mapped model file.
+ *			The number of terms must match the order, as the
+ *			monomials of a query are written by that count.
+ * @param	file - Mapped model file, kept open by the caller
+ * @param	firstSection - Id of the first of the transform's sections
+ * @param	dimension - Number of features
+ * @param	classes - Number of classes
+ * @return	Whether the transform is valid, it is empty otherwise
+ * */
+bool FastGaussTransform::load(const ModelFile& file, uint32_t firstSection, int dimension, int classes)
+{
+	build(nullptr, nullptr, 0, dimension, classes, 1, 1);
+	const GaussTransformParameters* parameters =
+		file.array<GaussTransformParameters>(firstSection + IFGT_SECTION_PARAMETERS, 1);
+	if (parameters == nullptr || parameters->p < 1 || parameters->p > IFGT_MAX_ORDER
+		|| parameters->clusters > IFGT_MAX_CLUSTERS || !(parameters->bandwidth > 0))
+	{
+		return false;
+	}
+	double combinations = termCount(parameters->p);
+	size_t clusters = parameters->clusters;
+	if (combinations > IFGT_MAX_TERMS || parameters->terms != (int)(combinations + 0.5)
+		|| (double)clusters * classes * combinations > IFGT_MAX_COEFFICIENTS)
+	{
+		return false;
+	}
+	const double* centerData = file.array<double>(firstSection + IFGT_SECTION_CENTERS, clusters * dimension);
+	const double* coefficientData = file.array<double>(firstSection + IFGT_SECTION_COEFFICIENTS,
+		clusters * classes * parameters->terms);
+	const size_t* count = file.array<size_t>(firstSection + IFGT_SECTION_CLUSTER_COUNT, clusters);
+	if (centerData == nullptr || coefficientData == nullptr || count == nullptr)
+	{
+		return false;
+	}
+	p = parameters->p;
+	terms = parameters->terms;
+	bandwidth = parameters->bandwidth;
+	cutoffRadius = parameters->cutoffRadius;
+	clusterRadius = parameters->clusterRadius;
+	epsilon = parameters->epsilon;
+	bound = parameters->bound;
+	mappedCenters = centerData;
+	mappedCoefficients = coefficientData;
+	mappedCount = count;
+	mappedClusters = (int)clusters;
+	isMapped = true;
+	return true;
+}
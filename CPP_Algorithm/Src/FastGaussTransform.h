@@ -0,0 +1,147 @@
+/********************************************************************
+ * @File name:		FastGaussTransform.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-18
+ * @Description:	Declare the Improved Fast Gauss Transform used as a
+ *					Parzen Window backend
+ ********************************************************************/
+
+#pragma once
+
+#ifndef FASTGAUSSTRANSFORM_H
+#define FASTGAUSSTRANSFORM_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ModelFile.h"
+
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	FastGaussTransform
+ * @brief	Improved Fast Gauss Transform (Yang, Duraiswami, Gumerov;
+ *			error bounds after Raykar et al.). The sources are
+ *			grouped by farthest-point clustering and each cluster
+ *			keeps, per class, a Taylor expansion of total degree
+ *			below p. A query evaluates the expansions of the clusters
+ *			within the cut-off radius, so its cost is independent of
+ *			the number of sources. The kernel is exp(-|y - x|^2 / b^2)
+ *			and every class sum is within epsilon * n_c of the exact
+ *			value (see errorBound()).
+ *
+ *			build() picks the number of clusters, and with their
+ *			radius the order and the cut-off, from a cost model: the
+ *			expansion terms a query evaluates in the clusters within
+ *			its cut-off, plus the distances to the centers. The
+ *			coefficients are capped at 64 MB. When no order within
+ *			the limits meets epsilon, or when a query would cost more
+ *			than the exact sum over every source, build() leaves the
+ *			transform empty and returns false, so the caller sums
+ *			directly. In many dimensions with a bandwidth near the
+ *			spread of the data, the order needed grows quickly and
+ *			the direct sums are chosen.
+ *
+ *			Sources can be inserted and removed after the build: the
+ *			expansion is linear in the sources, so their terms are
+ *			added to or subtracted from their cluster. A source far
+ *			from every center opens a new cluster, reusing one that
+ *			has lost all its sources; otherwise the cluster radius
+ *			grows and the cut-off and the bound follow with the order
+ *			kept, so errorBound() can exceed epsilon until the next
+ *			build().
+ *
+ *			save() stores the centers and the expansions, and load()
+ *			serves queries from them inside the mapped file. A loaded
+ *			transform is read-only until the next build().
+ * */
+class FastGaussTransform
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Number of features
+	int dimension = 0;
+	// Number of classes
+	int classes = 0;
+	// Bandwidth b
+	double bandwidth = 1;
+	// Truncation order, the expansion keeps degrees 0 to p - 1
+	int p = 0;
+	// Number of expansion terms, C(p - 1 + d, d)
+	int terms = 0;
+	// Queries ignore clusters farther than this
+	double cutoffRadius = 0;
+	// Largest distance from a source to its cluster center
+	double clusterRadius = 0;
+	// Distance from every center beyond which an inserted source opens
+	// a new cluster, the cluster radius chosen by build()
+	double targetRadius = 0;
+	// Number of clusters whose coefficients fit in the memory limit
+	size_t clusterLimit = 0;
+	// Requested error of the mean kernel value of a class
+	double epsilon = 1;
+	// Guaranteed error of the mean kernel value of a class
+	double bound = 0;
+	// Cluster centers, dimension values each
+	vector<double> centers;
+	// Expansion coefficients, terms values per class per cluster
+	vector<double> coefficients;
+	// The factors 2^|alpha| / alpha! of the expansion terms
+	vector<double> constants;
+	// Number of sources in each cluster
+	vector<size_t> clusterCount;
+	// Cluster of each source id, -1 for unused ids
+	vector<int> sourceCluster;
+	// Centers, coefficients and counts inside a mapped model file,
+	// used instead of the members above after load()
+	const double* mappedCenters = nullptr;
+	const double* mappedCoefficients = nullptr;
+	const size_t* mappedCount = nullptr;
+	int mappedClusters = 0;
+	bool isMapped = false;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void computeMonomials(const double* v, double* monomials) const;
+	void computeConstants(double* constants) const;
+	int orderFor(double rx) const;
+	double termCount(int order) const;
+	size_t clustersFor(int count) const;
+	void setOrder(int order);
+	void updateBound();
+	int nearestCenter(const double* x, double* distance) const;
+	void accumulate(int cluster, const double* x, int label, double sign);
+	static double truncationBound(int p, double rx);
+
+public:
+	FastGaussTransform();
+	bool build(const double* points, const int* labels, size_t number, int dimension,
+		int classes, double bandwidth, double epsilon, const size_t* ids = nullptr);
+	void insert(const double* x, int label, size_t id);
+	void remove(const double* x, int label, size_t id);
+	void kernelSums(const double* y, double* sums) const;
+	int clusterNumber() const;
+	int order() const;
+	double errorBound() const;
+	void save(ModelWriter& writer, uint32_t firstSection) const;
+	bool load(const ModelFile& file, uint32_t firstSection, int dimension, int classes);
+};
+
+#endif
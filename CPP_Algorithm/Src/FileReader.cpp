@@ -10,16 +10,70 @@
  // Includes
  //-------------------------------------------------------------------
 #include "FileReader.h"
+#include "DatasetFile.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
-#include <fstream>
+#include <charconv>
+#include <cstring>
 #include <iostream>
 
 
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	LabelTable
+ * @brief	Open-addressing hash table from class names to labels. The
+ *			names are kept as pointers into the mapped file, so a
+ *			lookup never allocates; only a new class is copied into
+ *			the data set.
+ * */
+class LabelTable
+{
+private:
+	// One entry of the table
+	typedef struct
+	{
+		// Class name inside the file, nullptr for a free slot
+		const char* name;
+		// Length of the name
+		size_t length;
+		// Label of the class
+		int label;
+	}Slot;
+
+	// Power-of-two number of slots, at most half of them used
+	vector<Slot> slots;
+	// Number of used slots
+	size_t used = 0;
+	// Most recent lookup, files are usually sorted by class
+	const char* lastName = nullptr;
+	size_t lastLength = 0;
+	int lastLabel = CLASS_UNKNOWN;
+
+	static size_t hash(const char* name, size_t length);
+	void insert(const char* name, size_t length, int label);
+
+public:
+	LabelTable();
+	int intern(const char* name, size_t length, Dataset& dataset);
+};
+
+
 //-------------------------------------------------------------------
 // Private function declaration
 //-------------------------------------------------------------------
-vector<string>* readFile(string filename);
-vector<string> stringSplit(const string& str, char delim);
+const char* lineEnd(const char* first, const char* last);
+const char* trimFront(const char* first, const char* last);
+const char* trimBack(const char* first, const char* last);
+int countFeatures(const char* first, const char* last);
+size_t countLines(const char* first, const char* last);
+bool parseLine(const char* first, const char* last, int dimension, double* features,
+	const char** label, size_t* labelLength);
+size_t parseChunk(const char* first, const char* last, Dataset& dataset, size_t row,
+	Dataset& classes, size_t* skipped);
 
 
 //-------------------------------------------------------------------
@@ -28,99 +82,564 @@ vector<string> stringSplit(const string& str, char delim);
 
 /********************************************************************
  * @name	readAsDataList
- * @brief	Use to read the data set and load it as a vector
+ * @brief	Use to read the data set and load it as a vector. Every
+ *			line holds the features followed by the class name. The
+ *			number of features is taken from the first line, and the
+ *			classes are numbered in order of first appearance. The
+ *			file is mapped and parsed in place straight into the
+ *			feature buffer, nothing is allocated per line or field.
+ *
+ *			With several threads the file is cut into byte ranges
+ *			at line boundaries. The lines of every range are counted
+ *			in parallel, a prefix sum gives each range its first row,
+ *			and the ranges are then parsed in parallel into their own
+ *			rows. The result is identical to a single-threaded read.
+ *
+ *			Binary data set files (see DatasetFile.h) are recognised
+ *			by their first bytes, and the data set views their rows
+ *			in place without parsing or copying.
  * @param	filename - Name and path of the file to be read
- * @return	Pointer of a vector of the dataset
+ * @param	threads - Number of threads, 0 for one per core
+ * @return	Pointer of the dataset, nullptr if the file cannot be read
  * */
-vector<DataStruct>* readAsDataList(string filename)
+Dataset* readAsDataList(string filename, int threads)
 {
-	vector<string>* datasetOld = readFile(filename);
-	vector<DataStruct>* datasetNew = new vector<DataStruct>;
-	for (string data : *datasetOld)
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		cout << "File opening failure!\n";
+		return nullptr;
+	}
+	if (DatasetFile::isDatasetFile(file.data(), file.size()))
+	{
+		file.close();
+		DatasetFile binary;
+		return binary.open(filename) ? binary.toDataset() : nullptr;
+	}
+	const char* first = file.data();
+	const char* last = first + file.size();
+	// The first line that is not blank gives the number of features
+	int dimension = 0;
+	for (const char* line = first; line < last; )
+	{
+		const char* end = lineEnd(line, last);
+		dimension = countFeatures(line, end);
+		if (dimension > 0)
+		{
+			break;
+		}
+		line = end + 1;
+	}
+	Dataset* dataset = new Dataset(dimension);
+	if (dimension == 0)
+	{
+		return dataset;
+	}
+
+	// Cut the file into ranges that start at the beginning of a line
+	if (threads <= 0)
+	{
+		threads = ThreadPool::defaultThreads();
+	}
+	size_t chunks = file.size() / READ_MIN_CHUNK;
+	if (chunks > (size_t)threads)
+	{
+		chunks = threads;
+	}
+	if (chunks < 1)
+	{
+		chunks = 1;
+	}
+	vector<const char*> bounds(chunks + 1);
+	bounds[0] = first;
+	bounds[chunks] = last;
+	for (size_t c = 1; c < chunks; c++)
+	{
+		const char* cut = first + file.size() / chunks * c;
+		if (cut < bounds[c - 1])
+		{
+			cut = bounds[c - 1];
+		}
+		bounds[c] = cut == first ? first : lineEnd(cut - 1, last);
+		if (bounds[c] < last)
+		{
+			bounds[c]++;
+		}
+	}
+
+	// One row per line at most, the prefix sum gives each range its rows
+	vector<size_t> offset(chunks + 1, 0);
+	vector<size_t> rows(chunks, 0);
+	vector<size_t> skipped(chunks, 0);
+	// Class names of each range, numbered in order of appearance in it
+	vector<Dataset> classes(chunks);
+	if (chunks > 1)
+	{
+		ThreadPool pool((int)chunks);
+		for (size_t c = 0; c < chunks; c++)
+		{
+			pool.submit([&bounds, &offset, c]()
+				{
+					offset[c + 1] = countLines(bounds[c], bounds[c + 1]);
+				});
+		}
+		pool.wait();
+	}
+	else
+	{
+		offset[1] = countLines(first, last);
+	}
+	for (size_t c = 0; c < chunks; c++)
+	{
+		offset[c + 1] += offset[c];
+	}
+	dataset->resize(offset[chunks]);
+	if (chunks > 1)
 	{
-		vector<string> dataSplit = stringSplit(data, ',');
-		DataStruct dataStruct;
-		dataStruct.data[0] = stof(dataSplit.at(0));
-		dataStruct.data[1] = stof(dataSplit.at(1));
-		dataStruct.data[2] = stof(dataSplit.at(2));
-		dataStruct.data[3] = stof(dataSplit.at(3));
-		if (dataSplit.at(4) == "Iris-setosa")
+		ThreadPool pool((int)chunks);
+		for (size_t c = 0; c < chunks; c++)
 		{
-			dataStruct.classIndex = IRIS_SETOSA;
+			pool.submit([&, c]()
+				{
+					rows[c] = parseChunk(bounds[c], bounds[c + 1], *dataset, offset[c],
+						classes[c], &skipped[c]);
+				});
 		}
-		else if (dataSplit.at(4) == "Iris-versicolor")
+		pool.wait();
+	}
+	else
+	{
+		rows[0] = parseChunk(first, last, *dataset, 0, classes[0], &skipped[0]);
+	}
+
+	// Register the classes in order of first appearance in the file, and
+	// close the gaps left by blank or malformed lines
+	int* labelData = dataset->labelData();
+	size_t total = 0;
+	size_t totalSkipped = 0;
+	vector<int> global;
+	for (size_t c = 0; c < chunks; c++)
+	{
+		global.assign(classes[c].classNumber() + 1, CLASS_UNKNOWN);
+		for (int k = 1; k <= classes[c].classNumber(); k++)
 		{
-			dataStruct.classIndex = IRIS_VERSICOLOR;
+			global[k] = dataset->addClass(classes[c].className(k));
 		}
-		else if (dataSplit.at(4) == "Iris-virginica")
+		if (total != offset[c])
 		{
-			dataStruct.classIndex = IRIS_VIRGINICA;
+			memmove(dataset->row(total), dataset->row(offset[c]), rows[c] * dimension * sizeof(double));
 		}
-		else
+		for (size_t j = 0; j < rows[c]; j++)
 		{
-			dataStruct.classIndex = IRIS_UNKNOWN;
+			labelData[total + j] = global[labelData[offset[c] + j]];
 		}
-		datasetNew->push_back(dataStruct);
+		total += rows[c];
+		totalSkipped += skipped[c];
+	}
+	dataset->resize(total);
+	if (totalSkipped > 0)
+	{
+		cout << "Skipped " << totalSkipped << " malformed lines!\n";
 	}
-	delete datasetOld;
-	return datasetNew;
+	return dataset;
 }
 
 
 /********************************************************************
- * @name	readFile
- * @brief	Use to read the data set and load it as a vector
- * @param	filename - Name and path of the file to be read
- * @return	Pointer of a vector of the dataset
+ * @name	parseChunk
+ * @brief	Parse the lines of a range into consecutive rows of the
+ *			data set. The labels are numbered by a separate class
+ *			list, so ranges can be parsed in parallel.
+ * @param	first - Start of the range, at the beginning of a line
+ * @param	last - End of the range, just after a '\n' or at the end
+ * @param	dataset - Data set sized for every line of the range
+ * @param	row - First row of the range
+ * @param	classes - Receives the class names of the range
+ * @param	skipped - Receives the number of malformed lines
+ * @return	Number of rows written
  * */
-vector<string>* readFile(string filename)
+size_t parseChunk(const char* first, const char* last, Dataset& dataset, size_t row,
+	Dataset& classes, size_t* skipped)
 {
-	// Open the file read stream
-	fstream fst;
-	fst.open(filename, ios::in);
-	// If opening fails, print it in the console
-	if (!fst.is_open())
+	LabelTable labels;
+	int dimension = dataset.dimension();
+	int* labelData = dataset.labelData();
+	size_t rows = row;
+	*skipped = 0;
+	for (const char* line = first; line < last; )
 	{
-		cout << "File opening failure!\n";
-		return nullptr;
+		const char* end = lineEnd(line, last);
+		const char* label;
+		size_t labelLength;
+		if (parseLine(line, end, dimension, dataset.row(rows), &label, &labelLength) && labelLength > 0)
+		{
+			labelData[rows] = labels.intern(label, labelLength, classes);
+			rows++;
+		}
+		else if (trimFront(line, end) != end)
+		{
+			(*skipped)++;
+		}
+		line = end + 1;
+	}
+	return rows - row;
+}
+
+
+/********************************************************************
+ * @name	lineEnd
+ * @brief	Find the end of a line
+ * @param	first - Start of the line
+ * @param	last - End of the buffer
+ * @return	Position of the '\n', or last
+ * */
+const char* lineEnd(const char* first, const char* last)
+{
+	const char* end = (const char*)memchr(first, '\n', last - first);
+	return end == nullptr ? last : end;
+}
+
+
+/********************************************************************
+ * @name	trimFront
+ * @brief	Skip leading blanks
+ * @param	first - Start of the text
+ * @param	last - End of the text
+ * @return	First character that is not a blank, or last
+ * */
+const char* trimFront(const char* first, const char* last)
+{
+	while (first < last && (*first == ' ' || *first == '\t' || *first == '\r'))
+	{
+		first++;
 	}
-	// Read the data line by line
-	vector<string>* readBuff = new vector<string>;
-	string line;
-	while (getline(fst, line))
+	return first;
+}
+
+
+/********************************************************************
+ * @name	trimBack
+ * @brief	Drop trailing blanks, including the '\r' of Windows files
+ * @param	first - Start of the text
+ * @param	last - End of the text
+ * @return	One past the last character that is not a blank
+ * */
+const char* trimBack(const char* first, const char* last)
+{
+	while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
 	{
-		readBuff->push_back(line);
+		last--;
 	}
-	// Close the file read stream
-	fst.close();
-	return readBuff;
+	return last;
 }
 
 
 /********************************************************************
- * @name	stringSplit
- * @brief	Use to read the data set and load it as a list
- * @param	str - String to be split
- * @param	delim - Split by this character
- * @return	Pointer of a vector of the dataset
+ * @name	countFeatures
+ * @brief	Number of features of a line, one less than its fields
+ * @param	first - Start of the line
+ * @param	last - End of the line
+ * @return	Number of commas, 0 for a blank line
  * */
-vector<string> stringSplit(const string& str, char delim)
+int countFeatures(const char* first, const char* last)
 {
-	size_t previous = 0;
-	size_t current = str.find(delim);
-	vector<string> elems;
-	while (current != string::npos)
+	int commas = 0;
+	for (const char* p = first; p < last; p++)
 	{
-		if (current > previous)
+		commas += *p == ',';
+	}
+	return commas;
+}
+
+
+/********************************************************************
+ * @name	countLines
+ * @brief	Number of lines of a buffer, counting an unterminated
+ *			last line
+ * @param	first - Start of the buffer
+ * @param	last - End of the buffer
+ * @return	Number of lines
+ * */
+size_t countLines(const char* first, const char* last)
+{
+	size_t lines = 0;
+	for (const char* p = first; p < last; )
+	{
+		p = lineEnd(p, last) + 1;
+		lines++;
+	}
+	return lines;
+}
+
+
+/********************************************************************
+ * @name	parseLine
+ * @brief	Parse "x1,x2,...,xd,name" or "x1,x2,...,xd" in place.
+ *			Blanks around the fields are ignored.
+ * @param	first - Start of the line
+ * @param	last - End of the line, without the '\n'
+ * @param	dimension - Number of features expected
+ * @param	features - Receives the dimension features
+ * @param	label - Receives the start of the class name
+ * @param	labelLength - Receives the length of the class name, 0
+ *			when the line has none
+ * @return	Whether the line is well-formed
+ * */
+bool parseLine(const char* first, const char* last, int dimension, double* features,
+	const char** label, size_t* labelLength)
+{
+	const char* p = first;
+	for (int i = 0; i < dimension; i++)
+	{
+		p = trimFront(p, last);
+		// from_chars does not take an explicit plus sign
+		if (p < last && *p == '+')
+		{
+			p++;
+		}
+		from_chars_result parsed = from_chars(p, last, features[i]);
+		if (parsed.ec != errc())
+		{
+			return false;
+		}
+		p = trimFront(parsed.ptr, last);
+		if (p == last && i == dimension - 1)
+		{
+			// No class name
+			*label = p;
+			*labelLength = 0;
+			return true;
+		}
+		if (p == last || *p != ',')
+		{
+			return false;
+		}
+		p++;
+	}
+	p = trimFront(p, last);
+	const char* end = trimBack(p, last);
+	if (p == end || memchr(p, ',', end - p) != nullptr)
+	{
+		return false;
+	}
+	*label = p;
+	*labelLength = end - p;
+	return true;
+}
+
+
+/********************************************************************
+ * @name	LabelTable
+ * @brief	The constructor. Starts with room for a few classes.
+ * */
+LabelTable::LabelTable()
+{
+	slots.assign(16, Slot{ nullptr, 0, CLASS_UNKNOWN });
+}
+
+
+/********************************************************************
+ * @name	hash
+ * @brief	FNV-1a hash of a class name
+ * @param	name - Class name
+ * @param	length - Length of the name
+ * @return	Hash value
+ * */
+size_t LabelTable::hash(const char* name, size_t length)
+{
+	unsigned long long value = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		value = (value ^ (unsigned char)name[i]) * 1099511628211ULL;
+	}
+	return (size_t)value;
+}
+
+
+/********************************************************************
+ * @name	insert
+ * @brief	Add a name that is not in the table, growing it when half
+ *			full
+ * @param	name - Class name
+ * @param	length - Length of the name
+ * @param	label - Label of the class
+ * @return	none
+ * */
+void LabelTable::insert(const char* name, size_t length, int label)
+{
+	if (2 * (used + 1) > slots.size())
+	{
+		vector<Slot> old;
+		old.swap(slots);
+		slots.assign(2 * old.size(), Slot{ nullptr, 0, CLASS_UNKNOWN });
+		used = 0;
+		for (const Slot& slot : old)
 		{
-			elems.push_back(str.substr(previous, current - previous));
+			if (slot.name != nullptr)
+			{
+				insert(slot.name, slot.length, slot.label);
+			}
 		}
-		previous = current + 1;
-		current = str.find(delim, previous);
 	}
-	if (previous != str.size())
+	size_t mask = slots.size() - 1;
+	size_t i = hash(name, length) & mask;
+	while (slots[i].name != nullptr)
 	{
-		elems.push_back(str.substr(previous));
+		i = (i + 1) & mask;
 	}
-	return elems;
-}
\ No newline at end of file
+	slots[i] = Slot{ name, length, label };
+	used++;
+}
+
+
+/********************************************************************
+ * @name	intern
+ * @brief	Label of a class name, registering the class in the data
+ *			set the first time it appears
+ * @param	name - Class name inside the file
+ * @param	length - Length of the name
+ * @param	dataset - Data set that owns the class names
+ * @return	Label of the class
+ * */
+int LabelTable::intern(const char* name, size_t length, Dataset& dataset)
+{
+	if (length == lastLength && lastName != nullptr && memcmp(name, lastName, length) == 0)
+	{
+		return lastLabel;
+	}
+	size_t mask = slots.size() - 1;
+	size_t i = hash(name, length) & mask;
+	int label = CLASS_UNKNOWN;
+	while (slots[i].name != nullptr)
+	{
+		if (slots[i].length == length && memcmp(slots[i].name, name, length) == 0)
+		{
+			label = slots[i].label;
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	if (label == CLASS_UNKNOWN)
+	{
+		label = dataset.addClass(string(name, length));
+		insert(name, length, label);
+	}
+	lastName = name;
+	lastLength = length;
+	lastLabel = label;
+	return label;
+}
+
+
+/********************************************************************
+ * @name	RecordReader
+ * @brief	The constructor
+ * @param	input - Stream to read, a file or cin
+ * @param	model - Data set the model was trained on, gives the number
+ *			of features and the class names
+ * @param	chunkBytes - Bytes read from the stream at a time
+ * */
+RecordReader::RecordReader(istream& input, const Dataset& model, size_t chunkBytes)
+{
+	this->input = &input;
+	this->dimension = model.dimension();
+	buffer.resize(chunkBytes > 0 ? chunkBytes : READ_STREAM_CHUNK);
+	for (int k = 1; k <= model.classNumber(); k++)
+	{
+		classNames.push_back(model.className(k));
+	}
+}
+
+
+/********************************************************************
+ * @name	next
+ * @brief	Read the next records. The buffer only grows when a single
+ *			line is longer than it, so memory stays bounded by the
+ *			chunk size and maxRows.
+ * @param	batch - Receives the records, its dimension must match the
+ *			model
+ * @param	maxRows - Maximum number of records to read
+ * @return	Number of records read, 0 at the end of the stream
+ * */
+size_t RecordReader::next(Dataset& batch, size_t maxRows)
+{
+	batch.clear();
+	batch.reserve(maxRows);
+	vector<double> features(dimension);
+	while (batch.size() < maxRows)
+	{
+		const char* first = buffer.data() + begin;
+		const char* last = buffer.data() + end;
+		const char* line = lineEnd(first, last);
+		if (line == last && !finished)
+		{
+			// Keep the partial line and read the next chunk behind it
+			if (begin > 0)
+			{
+				memmove(buffer.data(), first, end - begin);
+				end -= begin;
+				begin = 0;
+			}
+			if (end == buffer.size())
+			{
+				buffer.resize(2 * buffer.size());
+			}
+			input->read(buffer.data() + end, buffer.size() - end);
+			size_t count = (size_t)input->gcount();
+			end += count;
+			if (count == 0)
+			{
+				finished = true;
+			}
+			continue;
+		}
+		if (first == last)
+		{
+			break;
+		}
+		const char* label;
+		size_t labelLength;
+		if (parseLine(first, line, dimension, features.data(), &label, &labelLength))
+		{
+			batch.append(features.data(), labelLength > 0 ? findClass(label, labelLength) : CLASS_UNKNOWN);
+		}
+		else if (trimFront(first, line) != line)
+		{
+			skipped++;
+		}
+		begin = line < last ? line + 1 - buffer.data() : end;
+	}
+	return batch.size();
+}
+
+
+/********************************************************************
+ * @name	skippedLines
+ * @brief	Number of lines that could not be parsed so far
+ * @param	none
+ * @return	Number of malformed lines
+ * */
+size_t RecordReader::skippedLines() const
+{
+	return skipped;
+}
+
+
+/********************************************************************
+ * @name	findClass
+ * @brief	Label of a class name without building a string
+ * @param	name - Class name inside the buffer
+ * @param	length - Length of the name
+ * @return	Label of the class, CLASS_UNKNOWN if the model lacks it
+ * */
+int RecordReader::findClass(const char* name, size_t length) const
+{
+	for (size_t k = 0; k < classNames.size(); k++)
+	{
+		if (classNames[k].size() == length && memcmp(classNames[k].data(), name, length) == 0)
+		{
+			return (int)k + 1;
+		}
+	}
+	return CLASS_UNKNOWN;
+}
@@ -17,10 +17,68 @@
 //-------------------------------------------------------------------
 #include "Algorithm.h"
 
+#include <istream>
 #include <string>
 #include <vector>
 
 
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Smallest part of a file given to one reader thread, in bytes
+#define READ_MIN_CHUNK (1 << 20)
+// Bytes a RecordReader reads from its stream at a time
+#define READ_STREAM_CHUNK (1 << 16)
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	RecordReader
+ * @brief	Reads feature records from a stream in fixed-size chunks,
+ *			so input of any length can be classified with bounded
+ *			memory. Lines have the format of readAsDataList; the
+ *			class name is optional and is looked up among the classes
+ *			of the model, CLASS_UNKNOWN when missing or not known.
+ * */
+class RecordReader
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Stream the records come from
+	istream* input;
+	// Bytes read from the stream but not parsed yet
+	vector<char> buffer;
+	// Unparsed bytes are buffer[begin, end)
+	size_t begin = 0;
+	size_t end = 0;
+	// Whether the stream is exhausted
+	bool finished = false;
+	// Number of features of a record
+	int dimension;
+	// Class names of the model, classNames[i] is class i + 1
+	vector<string> classNames;
+	// Number of lines that could not be parsed
+	size_t skipped = 0;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	int findClass(const char* name, size_t length) const;
+
+public:
+	RecordReader(istream& input, const Dataset& model, size_t chunkBytes = READ_STREAM_CHUNK);
+	size_t next(Dataset& batch, size_t maxRows);
+	size_t skippedLines() const;
+};
+
+
 //-------------------------------------------------------------------
 // Namespace
 //-------------------------------------------------------------------
@@ -30,6 +88,6 @@ using namespace std;
 //-------------------------------------------------------------------
 // Public function declaration
 //-------------------------------------------------------------------
-vector<DataStruct>* readAsDataList(string filename);
+Dataset* readAsDataList(string filename, int threads = 1);
 
 #endif
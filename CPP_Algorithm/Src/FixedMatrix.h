@@ -0,0 +1,370 @@
+/********************************************************************
+ * @File name:		FixedMatrix.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-12
+ * @Description:	Declare and implement fixed-size matrix template
+ ********************************************************************/
+
+#pragma once
+
+#ifndef FIXEDMATRIX_H
+#define FIXEDMATRIX_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Matrix.h"
+
+#include <math.h>
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	FixedMatrix
+ * @brief	Matrix whose shape is known at compile time. The elements
+ *			live inside the object, so small matrices stay on the
+ *			stack and no operation touches the heap. Results match
+ *			those of Matrix exactly. It is also an expression, so
+ *			Matrix::quadratic() and the Matrix operators read it with
+ *			its shape known to the compiler.
+ * */
+template<int R, int C>
+class FixedMatrix : public MatrixExpression<FixedMatrix<R, C>>
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Row-major elements
+	double mat[R * C] = { 0 };
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	FixedMatrix();
+	explicit FixedMatrix(const double* mat);
+	void print() const;
+	double* data();
+	const double* data() const;
+	double get(int row, int column) const;
+	void set(int row, int column, double value);
+	int rows() const;
+	int columns() const;
+	double operator()(int row, int column) const;
+	bool aliases(const Matrix& matrix) const;
+	FixedMatrix operator+(const FixedMatrix& B) const;
+	FixedMatrix operator-(const FixedMatrix& B) const;
+	template<int K>
+	FixedMatrix<R, K> operator*(const FixedMatrix<C, K>& B) const;
+	FixedMatrix operator*(const double B) const;
+	static FixedMatrix<C, R> trans(const FixedMatrix& matrix);
+	static FixedMatrix inverse(const FixedMatrix& matrix);
+	static double det(const FixedMatrix& matrix);
+};
+
+/********************************************************************
+ * @name	MatrixOperand
+ * @brief	Expressions keep a fixed-size matrix by reference rather
+ *			than copying its elements
+ * */
+template<int R, int C>
+struct MatrixOperand<FixedMatrix<R, C>>
+{
+	typedef const FixedMatrix<R, C>& type;
+};
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	FixedMatrix
+ * @brief	Constructor. Create a matrix with an initial value of 0.
+ * */
+template<int R, int C>
+FixedMatrix<R, C>::FixedMatrix()
+{
+}
+
+
+/********************************************************************
+ * @name	FixedMatrix
+ * @brief	Constructor. Create a matrix with an input initial value.
+ * @param	mat - Input initial value, R * C values in row-major order
+ * */
+template<int R, int C>
+FixedMatrix<R, C>::FixedMatrix(const double* mat)
+{
+	for (int i = 0; i < R * C; i++)
+	{
+		this->mat[i] = mat[i];
+	}
+}
+
+
+/********************************************************************
+ * @name	print
+ * @brief	Output matrix to console
+ * @param	none
+ * @return	none
+ * */
+template<int R, int C>
+void FixedMatrix<R, C>::print() const
+{
+	Matrix(R, C, mat).print();
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Gets the row-major element buffer.
+ * @param	none
+ * @return	Pointer to the first element
+ * */
+template<int R, int C>
+double* FixedMatrix<R, C>::data()
+{
+	return mat;
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Gets the row-major element buffer.
+ * @param	none
+ * @return	Pointer to the first element
+ * */
+template<int R, int C>
+const double* FixedMatrix<R, C>::data() const
+{
+	return mat;
+}
+
+
+/********************************************************************
+ * @name	get
+ * @brief	Gets the value of a location.
+ * @param	row - Matrix rows
+ * @param	column - Matrix columns
+ * @return	The value in the position
+ * */
+template<int R, int C>
+double FixedMatrix<R, C>::get(int row, int column) const
+{
+	return mat[row * C + column];
+}
+
+
+/********************************************************************
+ * @name	set
+ * @brief	Set the value of a location.
+ * @param	row - Matrix rows
+ * @param	column - Matrix columns
+ * @param	value - The new value that need to be set
+ * @return	none
+ * */
+template<int R, int C>
+void FixedMatrix<R, C>::set(int row, int column, double value)
+{
+	mat[row * C + column] = value;
+}
+
+
+/********************************************************************
+ * @name	rows
+ * @brief	Gets the number of rows.
+ * @param	none
+ * @return	R
+ * */
+template<int R, int C>
+int FixedMatrix<R, C>::rows() const
+{
+	return R;
+}
+
+
+/********************************************************************
+ * @name	columns
+ * @brief	Gets the number of columns.
+ * @param	none
+ * @return	C
+ * */
+template<int R, int C>
+int FixedMatrix<R, C>::columns() const
+{
+	return C;
+}
+
+
+/********************************************************************
+ * @name	operator()
+ * @brief	Read one element as an expression
+ * @param	row - Matrix rows
+ * @param	column - Matrix columns
+ * @return	The value in the position
+ * */
+template<int R, int C>
+double FixedMatrix<R, C>::operator()(int row, int column) const
+{
+	return mat[row * C + column];
+}
+
+
+/********************************************************************
+ * @name	aliases
+ * @brief	Whether the matrix shares elements with a Matrix
+ * @param	matrix - A matrix
+ * @return	False, the elements live inside the object
+ * */
+template<int R, int C>
+bool FixedMatrix<R, C>::aliases(const Matrix&) const
+{
+	return false;
+}
+
+
+/********************************************************************
+ * @name	operator+
+ * @brief	Implement matrix addition
+ * @param	B - Another matrix
+ * @return	Matrix plus result
+ * */
+template<int R, int C>
+FixedMatrix<R, C> FixedMatrix<R, C>::operator+(const FixedMatrix& B) const
+{
+	FixedMatrix result;
+	for (int i = 0; i < R * C; i++)
+	{
+		double value = mat[i] + B.mat[i];
+		result.mat[i] = fabs(value) < MATRIX_EPSILON ? 0.0 : value;
+	}
+	return result;
+}
+
+
+/********************************************************************
+ * @name	operator-
+ * @brief	Implement matrix minus
+ * @param	B - Another matrix
+ * @return	Matrix minus result
+ * */
+template<int R, int C>
+FixedMatrix<R, C> FixedMatrix<R, C>::operator-(const FixedMatrix& B) const
+{
+	FixedMatrix result;
+	for (int i = 0; i < R * C; i++)
+	{
+		double value = mat[i] - B.mat[i];
+		result.mat[i] = fabs(value) < MATRIX_EPSILON ? 0.0 : value;
+	}
+	return result;
+}
+
+
+/********************************************************************
+ * @name	operator*
+ * @brief	Implement matrix multiplication. The shapes are checked
+ *			at compile time.
+ * @param	B - Another matrix
+ * @return	Matrix multiplication result
+ * */
+template<int R, int C>
+template<int K>
+FixedMatrix<R, K> FixedMatrix<R, C>::operator*(const FixedMatrix<C, K>& B) const
+{
+	FixedMatrix<R, K> result;
+	const double* b = B.data();
+	for (int i = 0; i < R; i++)
+	{
+		for (int j = 0; j < K; j++)
+		{
+			double sum = 0;
+			for (int k = 0; k < C; k++)
+			{
+				sum += mat[i * C + k] * b[k * K + j];
+			}
+			result.set(i, j, fabs(sum) < MATRIX_EPSILON ? 0.0 : sum);
+		}
+	}
+	return result;
+}
+
+
+/********************************************************************
+ * @name	operator*
+ * @brief	Implement matrix multiplication with a constant
+ * @param	B - A constant
+ * @return	Matrix multiplication result
+ * */
+template<int R, int C>
+FixedMatrix<R, C> FixedMatrix<R, C>::operator*(const double B) const
+{
+	FixedMatrix result;
+	for (int i = 0; i < R * C; i++)
+	{
+		result.mat[i] = B * mat[i];
+	}
+	return result;
+}
+
+
+/********************************************************************
+ * @name	trans
+ * @brief	Compute the transpose of the matrix
+ * @param	matrix - A matrix
+ * @return	Transpose of the matrix
+ * */
+template<int R, int C>
+FixedMatrix<C, R> FixedMatrix<R, C>::trans(const FixedMatrix& matrix)
+{
+	FixedMatrix<C, R> AT;
+	for (int i = 0; i < C; i++)
+	{
+		for (int j = 0; j < R; j++)
+		{
+			AT.set(i, j, matrix.mat[j * C + i]);
+		}
+	}
+	return AT;
+}
+
+
+/********************************************************************
+ * @name	inverse
+ * @brief	Compute the inverse of the matrix
+ * @param	matrix - A square matrix
+ * @return	Inverse of the matrix
+ * */
+template<int R, int C>
+FixedMatrix<R, C> FixedMatrix<R, C>::inverse(const FixedMatrix& matrix)
+{
+	static_assert(R == C, "Invalid matrix dimension!");
+	FixedMatrix inv_A;
+	double work[R * R];
+	Matrix::inverse(matrix.mat, inv_A.mat, R, work);
+	return inv_A;
+}
+
+
+/********************************************************************
+ * @name	det
+ * @brief	Compute the determinant of the matrix
+ * @param	matrix - A square matrix
+ * @return	Determinant of the matrix
+ * */
+template<int R, int C>
+double FixedMatrix<R, C>::det(const FixedMatrix& matrix)
+{
+	static_assert(R == C, "Invalid matrix dimension!");
+	double work[R * R];
+	return Matrix::det(matrix.mat, R, work);
+}
+
+#endif
@@ -0,0 +1,479 @@
+/********************************************************************
+ * @File name:		InferenceServer.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-6
+ * @Description:	Classification server with request micro-batching
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "InferenceServer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Connections waiting to be accepted
+const int SERVE_BACKLOG = 128;
+// How often the acceptor checks whether the server stops, in ms
+const int SERVE_POLL_MS = 100;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+bool littleEndianHost();
+bool readFully(int socket, void* data, size_t bytes);
+bool writeFully(int socket, const void* data, size_t bytes);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	InferenceServer
+ * @brief	The constructor. Nothing is served until start().
+ * @param	model - Trained model, must outlive the server
+ * @param	dimension - Number of features of the model
+ * @param	classNumber - Number of classes of the model
+ * @param	batchRows - Rows of a full batch
+ * @param	maxLatencyMicros - Longest wait of a request for others to
+ *			join its batch, in microseconds
+ * */
+InferenceServer::InferenceServer(const Algorithm* model, int dimension, int classNumber,
+	size_t batchRows, int maxLatencyMicros) :
+	model(model), dimension(dimension), classNumber(classNumber),
+	batchRows(batchRows > 0 ? batchRows : 1), maxLatency(maxLatencyMicros > 0 ? maxLatencyMicros : 0),
+	batch(dimension)
+{
+}
+
+
+/********************************************************************
+ * @name	~InferenceServer
+ * @brief	The destructor. Stops the server.
+ * */
+InferenceServer::~InferenceServer()
+{
+	stop();
+}
+
+
+/********************************************************************
+ * @name	listenUnix
+ * @brief	Listen on a Unix domain socket. A stale socket left at the
+ *			path by an earlier server is replaced.
+ * @param	path - Path of the socket
+ * @return	Whether the socket is listening
+ * */
+bool InferenceServer::listenUnix(const string& path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		cout << "Socket path too long: " << path << endl;
+		return false;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size());
+	struct stat status;
+	if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+	{
+		unlink(path.c_str());
+	}
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || ::bind(listener, (const sockaddr*)&address, sizeof(address)) != 0
+		|| listen(listener, SERVE_BACKLOG) != 0)
+	{
+		cout << "Unable to listen on " << path << ": " << strerror(errno) << endl;
+		if (listener >= 0)
+		{
+			close(listener);
+		}
+		listener = -1;
+		return false;
+	}
+	socketPath = path;
+	return true;
+}
+
+
+/********************************************************************
+ * @name	listenTcp
+ * @brief	Listen on a TCP port of the loopback interface only
+ * @param	port - Port number
+ * @return	Whether the socket is listening
+ * */
+bool InferenceServer::listenTcp(int port)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int reuse = 1;
+	listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+		|| ::bind(listener, (const sockaddr*)&address, sizeof(address)) != 0
+		|| listen(listener, SERVE_BACKLOG) != 0)
+	{
+		cout << "Unable to listen on port " << port << ": " << strerror(errno) << endl;
+		if (listener >= 0)
+		{
+			close(listener);
+		}
+		listener = -1;
+		return false;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	start
+ * @brief	Start accepting connections and scoring batches
+ * @param	none
+ * @return	none
+ * */
+void InferenceServer::start()
+{
+	if (!littleEndianHost())
+	{
+		cout << "The server can only run on little-endian hosts!" << endl;
+		return;
+	}
+	batcher = thread(&InferenceServer::batchLoop, this);
+	acceptor = thread(&InferenceServer::acceptLoop, this);
+}
+
+
+/********************************************************************
+ * @name	stop
+ * @brief	Stop accepting, close every connection and wait for the
+ *			threads. Requests already queued are still answered.
+ *			Later calls do nothing.
+ * @param	none
+ * @return	none
+ * */
+void InferenceServer::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+		// Wakes the connection threads blocked in a read
+		for (auto& connection : connections)
+		{
+			shutdown(connection.first, SHUT_RDWR);
+		}
+	}
+	requestReady.notify_all();
+	if (acceptor.joinable())
+	{
+		acceptor.join();
+	}
+	for (auto& connection : connections)
+	{
+		connection.second.join();
+		close(connection.first);
+	}
+	connections.clear();
+	finished.clear();
+	if (batcher.joinable())
+	{
+		batcher.join();
+	}
+	if (listener >= 0)
+	{
+		close(listener);
+		listener = -1;
+	}
+	if (!socketPath.empty())
+	{
+		unlink(socketPath.c_str());
+		socketPath.clear();
+	}
+}
+
+
+/********************************************************************
+ * @name	acceptLoop
+ * @brief	Body of the acceptor thread. Starts a thread for each new
+ *			connection and joins the finished ones.
+ * @param	none
+ * @return	none
+ * */
+void InferenceServer::acceptLoop()
+{
+	while (true)
+	{
+		pollfd ready = { listener, POLLIN, 0 };
+		int events = poll(&ready, 1, SERVE_POLL_MS);
+		lock_guard<mutex> guard(lock);
+		reapConnections();
+		if (stopping)
+		{
+			return;
+		}
+		if (events <= 0)
+		{
+			continue;
+		}
+		int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0)
+		{
+			continue;
+		}
+		// Responses are small, send them without waiting for more
+		int noDelay = 1;
+		setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		connections[connection] = thread(&InferenceServer::serveConnection, this, connection);
+	}
+}
+
+
+/********************************************************************
+ * @name	reapConnections
+ * @brief	Join the threads of finished connections and close their
+ *			sockets. The socket stays open until then, so its number
+ *			cannot be reused by a connection accepted in between.
+ * @param	none
+ * @return	none
+ * */
+void InferenceServer::reapConnections()
+{
+	for (int connection : finished)
+	{
+		connections[connection].join();
+		connections.erase(connection);
+		close(connection);
+	}
+	finished.clear();
+}
+
+
+/********************************************************************
+ * @name	serveConnection
+ * @brief	Body of a connection thread. Reads requests until the
+ *			client closes the connection or sends a bad request.
+ * @param	socket - Connected socket
+ * @return	none
+ * */
+void InferenceServer::serveConnection(int socket)
+{
+	vector<double> features;
+	vector<int> predictions;
+	RequestHeader request;
+	while (readFully(socket, &request, sizeof(request)) && request.magic == SERVE_REQUEST_MAGIC)
+	{
+		ResponseHeader response = { SERVE_RESPONSE_MAGIC, request.id, request.rows, SERVE_OK };
+		if (request.rows == 0)
+		{
+			response.rows = dimension;
+			response.status = classNumber;
+			if (!writeFully(socket, &response, sizeof(response)))
+			{
+				break;
+			}
+			continue;
+		}
+		if (request.dimension != (uint32_t)dimension || request.rows > SERVE_MAX_REQUEST_ROWS)
+		{
+			response.rows = 0;
+			response.status = request.dimension != (uint32_t)dimension ? SERVE_BAD_DIMENSION : SERVE_TOO_MANY_ROWS;
+			writeFully(socket, &response, sizeof(response));
+			break;
+		}
+		features.resize((size_t)request.rows * dimension);
+		predictions.resize(request.rows);
+		if (!readFully(socket, features.data(), features.size() * sizeof(double)))
+		{
+			break;
+		}
+		ServeRequest pending = { features.data(), request.rows, predictions.data(),
+			chrono::steady_clock::now(), false };
+		if (!score(pending))
+		{
+			break;
+		}
+		// The classes go out as int32 in one write with the header
+		vector<char> out(sizeof(response) + request.rows * sizeof(int32_t));
+		memcpy(out.data(), &response, sizeof(response));
+		for (uint32_t i = 0; i < request.rows; i++)
+		{
+			int32_t label = predictions[i];
+			memcpy(out.data() + sizeof(response) + i * sizeof(int32_t), &label, sizeof(label));
+		}
+		if (!writeFully(socket, out.data(), out.size()))
+		{
+			break;
+		}
+	}
+	lock_guard<mutex> guard(lock);
+	finished.push_back(socket);
+}
+
+
+/********************************************************************
+ * @name	score
+ * @brief	Queue a request and wait until its batch is scored
+ * @param	request - The request, its predictions are filled in
+ * @return	False when the server stops before the request is queued
+ * */
+bool InferenceServer::score(ServeRequest& request)
+{
+	unique_lock<mutex> guard(lock);
+	if (stopping)
+	{
+		return false;
+	}
+	queue.push_back(&request);
+	queuedRows += request.rows;
+	requestReady.notify_all();
+	batchDone.wait(guard, [&request]() { return request.done; });
+	return true;
+}
+
+
+/********************************************************************
+ * @name	batchLoop
+ * @brief	Body of the batcher thread. A batch opens with the oldest
+ *			queued request and closes when batchRows rows are queued,
+ *			when every open connection is waiting or when that
+ *			request has waited maxLatency. It then takes the
+ *			requests in arrival order while they fit, at least one,
+ *			and scores them together. Ends once the server stops and
+ *			the queue is empty.
+ * @param	none
+ * @return	none
+ * */
+void InferenceServer::batchLoop()
+{
+	vector<ServeRequest*> taken;
+	vector<int> predictions;
+	unique_lock<mutex> guard(lock);
+	while (true)
+	{
+		requestReady.wait(guard, [this]() { return stopping || !queue.empty(); });
+		if (queue.empty())
+		{
+			return;
+		}
+		chrono::steady_clock::time_point deadline = queue.front()->arrival + maxLatency;
+		// Each connection has one request at a time, so once every open
+		// connection has queued one, no other request can join
+		requestReady.wait_until(guard, deadline, [this]()
+			{
+				return stopping || queuedRows >= batchRows || queue.size() >= connections.size() - finished.size();
+			});
+		taken.clear();
+		size_t rows = 0;
+		while (!queue.empty() && (taken.empty() || rows + queue.front()->rows <= batchRows))
+		{
+			taken.push_back(queue.front());
+			rows += queue.front()->rows;
+			queue.pop_front();
+		}
+		queuedRows -= rows;
+		guard.unlock();
+
+		// The requests are copied next to each other and scored at once
+		batch.resize(rows);
+		predictions.resize(rows);
+		size_t offset = 0;
+		for (ServeRequest* request : taken)
+		{
+			memcpy(batch.row(offset), request->features, request->rows * dimension * sizeof(double));
+			offset += request->rows;
+		}
+		model->predict(batch, predictions.data());
+		offset = 0;
+		for (ServeRequest* request : taken)
+		{
+			copy(predictions.begin() + offset, predictions.begin() + offset + request->rows, request->predictions);
+			offset += request->rows;
+		}
+
+		guard.lock();
+		for (ServeRequest* request : taken)
+		{
+			request->done = true;
+		}
+		batchDone.notify_all();
+	}
+}
+
+
+/********************************************************************
+ * @name	readFully
+ * @brief	Read an exact number of bytes from a socket
+ * @param	socket - Connected socket
+ * @param	data - Receives the bytes
+ * @param	bytes - Number of bytes
+ * @return	False when the connection ends or fails first
+ * */
+bool readFully(int socket, void* data, size_t bytes)
+{
+	char* cursor = (char*)data;
+	while (bytes > 0)
+	{
+		ssize_t count = recv(socket, cursor, bytes, 0);
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (count <= 0)
+		{
+			return false;
+		}
+		cursor += count;
+		bytes -= count;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	writeFully
+ * @brief	Write an exact number of bytes to a socket
+ * @param	socket - Connected socket
+ * @param	data - Bytes to write
+ * @param	bytes - Number of bytes
+ * @return	False when the connection fails first
+ * */
+bool writeFully(int socket, const void* data, size_t bytes)
+{
+	const char* cursor = (const char*)data;
+	while (bytes > 0)
+	{
+		ssize_t count = send(socket, cursor, bytes, 0);
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (count <= 0)
+		{
+			return false;
+		}
+		cursor += count;
+		bytes -= count;
+	}
+	return true;
+}
@@ -0,0 +1,195 @@
+/********************************************************************
+ * @File name:		InferenceServer.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-6
+ * @Description:	Declare the classification server that answers
+ *					binary requests over a Unix domain socket or
+ *					loopback TCP in micro-batches
+ ********************************************************************/
+
+#pragma once
+
+#ifndef INFERENCESERVER_H
+#define INFERENCESERVER_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Algorithm.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Rows scored together at most
+#define SERVE_BATCH_ROWS 4096
+// Longest time a request waits for others to join its batch
+#define SERVE_MAX_LATENCY_US 1000
+// Largest request accepted, in rows
+#define SERVE_MAX_REQUEST_ROWS 65536
+// First field of every request and response, "PZRQ" and "PZRS"
+#define SERVE_REQUEST_MAGIC 0x51525a50u
+#define SERVE_RESPONSE_MAGIC 0x53525a50u
+// Response status
+#define SERVE_OK 0
+#define SERVE_BAD_DIMENSION 1
+#define SERVE_TOO_MANY_ROWS 2
+
+/********************************************************************
+ * @name	RequestHeader
+ * @brief	Start of a request. All values are little endian. The
+ *			header is followed by rows x dimension float64 features,
+ *			row by row. A request of 0 rows asks for the dimension
+ *			and the number of classes of the model.
+ * */
+typedef struct
+{
+	// SERVE_REQUEST_MAGIC
+	uint32_t magic;
+	// Chosen by the client, returned in the response
+	uint32_t id;
+	// Number of samples
+	uint32_t rows;
+	// Number of features of every sample
+	uint32_t dimension;
+}RequestHeader;
+
+/********************************************************************
+ * @name	ResponseHeader
+ * @brief	Start of a response, followed by rows int32 predicted
+ *			classes when the status is SERVE_OK. The connection is
+ *			closed after any other status.
+ * */
+typedef struct
+{
+	// SERVE_RESPONSE_MAGIC
+	uint32_t magic;
+	// Id of the request
+	uint32_t id;
+	// Number of predictions; for a request of 0 rows, the dimension
+	uint32_t rows;
+	// SERVE_OK or an error; for a request of 0 rows, the number of
+	// classes
+	int32_t status;
+}ResponseHeader;
+
+/********************************************************************
+ * @name	ServeRequest
+ * @brief	A request waiting for its batch
+ * */
+typedef struct
+{
+	// Row-major features
+	const double* features;
+	// Number of samples
+	size_t rows;
+	// Receives one predicted class per sample
+	int* predictions;
+	// When the request was queued
+	chrono::steady_clock::time_point arrival;
+	// Set by the batcher once the predictions are written
+	bool done;
+}ServeRequest;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	InferenceServer
+ * @brief	Serves a trained model. Every connection has a thread that
+ *			reads one request at a time and queues it; a single
+ *			batcher thread coalesces the queued requests into one
+ *			batch, closing it when it holds batchRows rows, when
+ *			every open connection is waiting or when its oldest
+ *			request has waited maxLatency, scores it with
+ *			Algorithm::predict() on the model's test threads and
+ *			hands every request its predictions. Requests of one
+ *			connection are answered in order.
+ * */
+class InferenceServer
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// The model, not owned
+	const Algorithm* model;
+	// Number of features of the model
+	int dimension;
+	// Number of classes of the model
+	int classNumber;
+	// Rows of a full batch
+	size_t batchRows;
+	// Longest wait of a request before its batch is scored
+	chrono::microseconds maxLatency;
+	// Listening socket, -1 before listen
+	int listener = -1;
+	// Path of the Unix domain socket, removed by stop()
+	string socketPath;
+	// Accepts connections
+	thread acceptor;
+	// Scores the batches
+	thread batcher;
+	// Protects every member below
+	mutex lock;
+	// Signalled when a request is queued or the server stops
+	condition_variable requestReady;
+	// Signalled when a batch is scored
+	condition_variable batchDone;
+	// Requests waiting for a batch
+	deque<ServeRequest*> queue;
+	// Rows of the queued requests
+	size_t queuedRows = 0;
+	// Thread and socket of each open connection
+	map<int, thread> connections;
+	// Connections whose thread has finished, joined by the acceptor
+	vector<int> finished;
+	// Set by stop()
+	bool stopping = false;
+	// Samples of the batch being scored
+	Dataset batch;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void acceptLoop();
+	void batchLoop();
+	void serveConnection(int socket);
+	bool score(ServeRequest& request);
+	void reapConnections();
+
+public:
+	InferenceServer(const Algorithm* model, int dimension, int classNumber,
+		size_t batchRows = SERVE_BATCH_ROWS, int maxLatencyMicros = SERVE_MAX_LATENCY_US);
+	~InferenceServer();
+	InferenceServer(const InferenceServer&) = delete;
+	InferenceServer& operator=(const InferenceServer&) = delete;
+	bool listenUnix(const string& path);
+	bool listenTcp(int port);
+	void start();
+	void stop();
+};
+
+#endif
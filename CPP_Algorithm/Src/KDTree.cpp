@@ -0,0 +1,824 @@
+/********************************************************************
+ * @File name:		KDTree.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-16
+ * @Description:	KD-tree index for bounded-error Gaussian kernel sums
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "KDTree.h"
+#include "Arena.h"
+#include "ParzenKernel.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdexcept>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Sections of a saved tree, after the first section id
+enum
+{
+	KDTREE_SECTION_PARAMETERS,
+	KDTREE_SECTION_BLOCKS,
+	KDTREE_SECTION_LOWER,
+	KDTREE_SECTION_UPPER,
+	KDTREE_SECTION_LEFT,
+	KDTREE_SECTION_RIGHT,
+	KDTREE_SECTION_BLOCK,
+	KDTREE_SECTION_CLASS_COUNT,
+	KDTREE_SECTION_CLASS_TOTAL
+};
+
+/********************************************************************
+ * @name	KDTreeParameters
+ * @brief	Sizes of a saved tree
+ * */
+typedef struct
+{
+	// Number of points
+	uint64_t number;
+	// Slots of every leaf block
+	uint64_t leafCapacity;
+	// Number of nodes
+	uint64_t nodes;
+	// Number of leaf blocks
+	uint64_t blocks;
+}KDTreeParameters;
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	KDTree
+ * @brief	The constructor. Creates an empty tree.
+ * */
+KDTree::KDTree()
+{
+}
+
+
+/********************************************************************
+ * @name	build
+ * @brief	Build the tree. Existing content is discarded.
+ * @param	points - Row-major number x dimension points
+ * @param	labels - Class of each point, from 0 to classes - 1
+ * @param	number - Number of points
+ * @param	dimension - Number of features
+ * @param	classes - Number of classes
+ * @param	leafSize - Number of points in a leaf after the build,
+ *			leaves hold up to twice as many before they split
+ * @param	ids - Id of each point for remove(), nullptr to number the
+ *			points from 0
+ * @return	none
+ * */
+void KDTree::build(const double* points, const int* labels, size_t number, int dimension,
+	int classes, int leafSize, const size_t* ids)
+{
+	const size_t lane = FEATURE_ALIGNMENT / sizeof(double);
+	leafSize = max(leafSize, 1);
+	this->dimension = dimension;
+	this->classes = classes;
+	this->number = 0;
+	isMapped = false;
+	leafCapacity = (2 * (size_t)leafSize + lane - 1) / lane * lane;
+	blocks.clear();
+	slotId.clear();
+	lower.clear();
+	upper.clear();
+	left.clear();
+	right.clear();
+	parent.clear();
+	splitFeature.clear();
+	splitValue.clear();
+	block.clear();
+	classCount.clear();
+	pointCount.clear();
+	classTotal.assign(classes, 0);
+	pointLeaf.clear();
+	pointSlot.clear();
+	pointLabel.clear();
+	vector<size_t> numbering;
+	if (ids == nullptr)
+	{
+		numbering.resize(number);
+		for (size_t i = 0; i < number; i++)
+		{
+			numbering[i] = i;
+		}
+		ids = numbering.data();
+	}
+	vector<size_t> order(number);
+	for (size_t i = 0; i < number; i++)
+	{
+		order[i] = i;
+	}
+	buildNode(points, labels, ids, order, 0, number, leafSize, -1);
+}
+
+
+/********************************************************************
+ * @name	buildNode
+ * @brief	Build the subtree over order[first, last). The range is
+ *			split at the median of its widest dimension.
+ * @param	points - Row-major points
+ * @param	labels - Class of each point
+ * @param	ids - Id of each point
+ * @param	order - Permutation of the points, rearranged in place
+ * @param	first - First position of the range
+ * @param	last - One past the last position of the range
+ * @param	leafSize - Maximum number of points in a leaf
+ * @param	parentNode - Parent of the new node, -1 for the root
+ * @return	Index of the node
+ * */
+int KDTree::buildNode(const double* points, const int* labels, const size_t* ids,
+	vector<size_t>& order, size_t first, size_t last, int leafSize, int parentNode)
+{
+	int node = addNode(parentNode);
+	if (last - first <= (size_t)leafSize)
+	{
+		fillLeaf(node, points, labels, ids, order.data() + first, last - first);
+		return node;
+	}
+	// Bounding box and class counts
+	for (size_t i = first; i < last; i++)
+	{
+		const double* point = points + order[i] * dimension;
+		for (int f = 0; f < dimension; f++)
+		{
+			lower[node * dimension + f] = min(lower[node * dimension + f], point[f]);
+			upper[node * dimension + f] = max(upper[node * dimension + f], point[f]);
+		}
+		classCount[node * classes + labels[order[i]]]++;
+	}
+	pointCount[node] = last - first;
+	// Split the widest dimension at the median
+	int split = widestFeature(node);
+	size_t middle = first + (last - first) / 2;
+	nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+		[points, split, this](size_t a, size_t b)
+		{
+			return points[a * dimension + split] < points[b * dimension + split];
+		});
+	splitFeature[node] = split;
+	splitValue[node] = points[order[middle] * dimension + split];
+	int leftNode = buildNode(points, labels, ids, order, first, middle, leafSize, node);
+	int rightNode = buildNode(points, labels, ids, order, middle, last, leafSize, node);
+	left[node] = leftNode;
+	right[node] = rightNode;
+	return node;
+}
+
+
+/********************************************************************
+ * @name	addNode
+ * @brief	Append an empty node
+ * @param	parentNode - Parent of the node, -1 for the root
+ * @return	Index of the node
+ * */
+int KDTree::addNode(int parentNode)
+{
+	int node = (int)left.size();
+	left.push_back(-1);
+	right.push_back(-1);
+	parent.push_back(parentNode);
+	splitFeature.push_back(0);
+	splitValue.push_back(0);
+	block.push_back(-1);
+	pointCount.push_back(0);
+	lower.resize(lower.size() + dimension, HUGE_VAL);
+	upper.resize(upper.size() + dimension, -HUGE_VAL);
+	classCount.resize(classCount.size() + classes, 0);
+	return node;
+}
+
+
+/********************************************************************
+ * @name	fillLeaf
+ * @brief	Turn an empty node into a leaf holding the given points,
+ *			sorted by class. The node counts are set, the counts of
+ *			its ancestors and of the tree are updated by the caller.
+ * @param	leaf - Node index
+ * @param	points - Row-major points
+ * @param	labels - Class of each point
+ * @param	ids - Id of each point
+ * @param	order - Points of the leaf, rearranged in place
+ * @param	count - Number of points, at most leafCapacity
+ * @return	none
+ * */
+void KDTree::fillLeaf(int leaf, const double* points, const int* labels, const size_t* ids,
+	size_t* order, size_t count)
+{
+	if (block[leaf] < 0)
+	{
+		block[leaf] = (int)(slotId.size() / leafCapacity);
+		blocks.resize(blocks.size() + leafCapacity * dimension, 0.0);
+		slotId.resize(slotId.size() + leafCapacity, 0);
+	}
+	stable_sort(order, order + count, [labels](size_t a, size_t b) { return labels[a] < labels[b]; });
+	double* columns = blocks.data() + block[leaf] * leafCapacity * dimension;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t id = ids[order[i]];
+		const double* point = points + order[i] * dimension;
+		for (int f = 0; f < dimension; f++)
+		{
+			columns[f * leafCapacity + i] = point[f];
+		}
+		slotId[block[leaf] * leafCapacity + i] = id;
+		if (id >= pointLeaf.size())
+		{
+			pointLeaf.resize(id + 1, -1);
+			pointSlot.resize(id + 1, 0);
+			pointLabel.resize(id + 1, 0);
+		}
+		pointLeaf[id] = leaf;
+		pointSlot[id] = i;
+		pointLabel[id] = labels[order[i]];
+		classCount[leaf * classes + labels[order[i]]]++;
+		classTotal[labels[order[i]]]++;
+	}
+	pointCount[leaf] = count;
+	number += count;
+	fitLeaf(leaf);
+}
+
+
+/********************************************************************
+ * @name	insert
+ * @brief	Add one point. Its leaf is found through the splits; a
+ *			full leaf is split at the median of its widest dimension
+ *			first. Inside the leaf the first point of every later
+ *			class moves to the end of its run, which frees the slot
+ *			after the run of the new point's class.
+ * @param	x - Features of the point
+ * @param	label - Class of the point, from 0 to classes - 1
+ * @param	id - Id of the point, not in use
+ * @return	none
+ * */
+void KDTree::insert(const double* x, int label, size_t id)
+{
+	if (isMapped)
+	{
+		throw logic_error("KDTree::insert");
+	}
+	if (left.empty())
+	{
+		build(x, &label, 0, dimension, classes, (int)(leafCapacity / 2), &id);
+	}
+	int node = 0;
+	while (block[node] < 0)
+	{
+		node = x[splitFeature[node]] < splitValue[node] ? left[node] : right[node];
+	}
+	if (pointCount[node] == leafCapacity)
+	{
+		splitLeaf(node);
+		node = x[splitFeature[node]] < splitValue[node] ? left[node] : right[node];
+	}
+	int leaf = node;
+	const size_t* counts = classCount.data() + leaf * classes;
+	size_t end = 0;
+	for (int c = 0; c <= label; c++)
+	{
+		end += counts[c];
+	}
+	size_t gap = pointCount[leaf];
+	for (int c = classes - 1; c > label; c--)
+	{
+		if (counts[c] > 0)
+		{
+			moveSlot(leaf, gap - counts[c], gap);
+			gap -= counts[c];
+		}
+	}
+	double* columns = blocks.data() + block[leaf] * leafCapacity * dimension;
+	for (int f = 0; f < dimension; f++)
+	{
+		columns[f * leafCapacity + end] = x[f];
+	}
+	slotId[block[leaf] * leafCapacity + end] = id;
+	if (id >= pointLeaf.size())
+	{
+		pointLeaf.resize(id + 1, -1);
+		pointSlot.resize(id + 1, 0);
+		pointLabel.resize(id + 1, 0);
+	}
+	pointLeaf[id] = leaf;
+	pointSlot[id] = end;
+	pointLabel[id] = label;
+	// Counts and boxes along the path to the root
+	for (; node >= 0; node = parent[node])
+	{
+		pointCount[node]++;
+		classCount[node * classes + label]++;
+		for (int f = 0; f < dimension; f++)
+		{
+			lower[node * dimension + f] = min(lower[node * dimension + f], x[f]);
+			upper[node * dimension + f] = max(upper[node * dimension + f], x[f]);
+		}
+	}
+	classTotal[label]++;
+	number++;
+}
+
+
+/********************************************************************
+ * @name	remove
+ * @brief	Remove one point. The last point of its class run takes
+ *			its slot and the last point of every later class run
+ *			moves one slot down. The boxes of the leaf and of its
+ *			ancestors shrink back to their content.
+ * @param	id - Id of the point
+ * @return	none
+ * */
+void KDTree::remove(size_t id)
+{
+	if (isMapped)
+	{
+		throw logic_error("KDTree::remove");
+	}
+	if (id >= pointLeaf.size() || pointLeaf[id] < 0)
+	{
+		return;
+	}
+	int leaf = pointLeaf[id];
+	int label = pointLabel[id];
+	const size_t* counts = classCount.data() + leaf * classes;
+	size_t end = 0;
+	for (int c = 0; c <= label; c++)
+	{
+		end += counts[c];
+	}
+	size_t gap = end - 1;
+	if (pointSlot[id] != gap)
+	{
+		moveSlot(leaf, gap, pointSlot[id]);
+	}
+	for (int c = label + 1; c < classes; c++)
+	{
+		if (counts[c] > 0)
+		{
+			moveSlot(leaf, gap + counts[c], gap);
+			gap += counts[c];
+		}
+	}
+	pointLeaf[id] = -1;
+	for (int node = leaf; node >= 0; node = parent[node])
+	{
+		pointCount[node]--;
+		classCount[node * classes + label]--;
+	}
+	classTotal[label]--;
+	number--;
+	// Shrink the boxes, inner nodes take the union of their children
+	fitLeaf(leaf);
+	for (int node = parent[leaf]; node >= 0; node = parent[node])
+	{
+		for (int f = 0; f < dimension; f++)
+		{
+			lower[node * dimension + f] = min(lower[left[node] * dimension + f], lower[right[node] * dimension + f]);
+			upper[node * dimension + f] = max(upper[left[node] * dimension + f], upper[right[node] * dimension + f]);
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	moveSlot
+ * @brief	Move the point in one slot of a leaf to another slot
+ * @param	leaf - Node index
+ * @param	from - Source slot
+ * @param	to - Destination slot
+ * @return	none
+ * */
+void KDTree::moveSlot(int leaf, size_t from, size_t to)
+{
+	double* columns = blocks.data() + block[leaf] * leafCapacity * dimension;
+	for (int f = 0; f < dimension; f++)
+	{
+		columns[f * leafCapacity + to] = columns[f * leafCapacity + from];
+	}
+	size_t id = slotId[block[leaf] * leafCapacity + from];
+	slotId[block[leaf] * leafCapacity + to] = id;
+	pointSlot[id] = to;
+}
+
+
+/********************************************************************
+ * @name	fitLeaf
+ * @brief	Recompute the bounding box of a leaf from its points. An
+ *			empty leaf gets an empty box.
+ * @param	leaf - Node index
+ * @return	none
+ * */
+void KDTree::fitLeaf(int leaf)
+{
+	const double* columns = blocks.data() + block[leaf] * leafCapacity * dimension;
+	for (int f = 0; f < dimension; f++)
+	{
+		double lo = HUGE_VAL;
+		double hi = -HUGE_VAL;
+		for (size_t i = 0; i < pointCount[leaf]; i++)
+		{
+			lo = min(lo, columns[f * leafCapacity + i]);
+			hi = max(hi, columns[f * leafCapacity + i]);
+		}
+		lower[leaf * dimension + f] = lo;
+		upper[leaf * dimension + f] = hi;
+	}
+}
+
+
+/********************************************************************
+ * @name	splitLeaf
+ * @brief	Split a leaf at the median of its widest dimension. The
+ *			lower half stays in its block and the upper half moves
+ *			to a new one; the leaf becomes their parent.
+ * @param	leaf - Node index
+ * @return	none
+ * */
+void KDTree::splitLeaf(int leaf)
+{
+	size_t count = pointCount[leaf];
+	// Copy the points out of the block, row-major
+	vector<double> points(count * dimension);
+	vector<int> labels(count);
+	vector<size_t> ids(count);
+	vector<size_t> order(count);
+	const double* columns = blocks.data() + block[leaf] * leafCapacity * dimension;
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int f = 0; f < dimension; f++)
+		{
+			points[i * dimension + f] = columns[f * leafCapacity + i];
+		}
+		ids[i] = slotId[block[leaf] * leafCapacity + i];
+		labels[i] = pointLabel[ids[i]];
+		order[i] = i;
+	}
+	int split = widestFeature(leaf);
+	size_t middle = count / 2;
+	nth_element(order.begin(), order.begin() + middle, order.end(),
+		[&points, split, this](size_t a, size_t b)
+		{
+			return points[a * dimension + split] < points[b * dimension + split];
+		});
+	int leftNode = addNode(leaf);
+	int rightNode = addNode(leaf);
+	block[leftNode] = block[leaf];
+	block[leaf] = -1;
+	splitFeature[leaf] = split;
+	splitValue[leaf] = points[order[middle] * dimension + split];
+	left[leaf] = leftNode;
+	right[leaf] = rightNode;
+	// fillLeaf counts the points again
+	number -= count;
+	for (size_t i = 0; i < count; i++)
+	{
+		classTotal[labels[i]]--;
+	}
+	fillLeaf(leftNode, points.data(), labels.data(), ids.data(), order.data(), middle);
+	fillLeaf(rightNode, points.data(), labels.data(), ids.data(), order.data() + middle, count - middle);
+}
+
+
+/********************************************************************
+ * @name	widestFeature
+ * @brief	Dimension in which a node's box is widest
+ * @param	node - Node index
+ * @return	Feature index
+ * */
+int KDTree::widestFeature(int node) const
+{
+	int split = 0;
+	for (int f = 1; f < dimension; f++)
+	{
+		if (upper[node * dimension + f] - lower[node * dimension + f] >
+			upper[node * dimension + split] - lower[node * dimension + split])
+		{
+			split = f;
+		}
+	}
+	return split;
+}
+
+
+/********************************************************************
+ * @name	kernelSums
+ * @brief	Gaussian kernel sum of each class at a query point
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @param	absError - Allowed error of the mean kernel value of a class
+ * @param	relError - Allowed error relative to the kernel sum of a class
+ * @param	sums - Output, one kernel sum per class
+ * @param	work - Receives the cost of the query in kernel values, the
+ *			points summed plus KDTREE_NODE_COST per node visited,
+ *			nullptr when not needed
+ * @return	none
+ * */
+void KDTree::kernelSums(const double* x, double scale, double absError, double relError,
+	double* sums, size_t* work) const
+{
+	size_t cost = 0;
+	ArenaScope scratch;
+	double* lowerSums = scratch.allocate<double>(classes, 0.0);
+	for (int c = 0; c < classes; c++)
+	{
+		sums[c] = 0;
+	}
+	if (number > 0)
+	{
+		KDTreeArrays tree = arrays();
+		queryNode(tree, 0, minDistance(tree, 0, x), x, scale, absError, relError, sums, lowerSums, cost);
+	}
+	if (work != nullptr)
+	{
+		*work = cost;
+	}
+}
+
+
+/********************************************************************
+ * @name	arrays
+ * @brief	The arrays queries read: the mapped ones after load(), the
+ *			members otherwise
+ * @param	none
+ * @return	Pointers to the arrays
+ * */
+KDTreeArrays KDTree::arrays() const
+{
+	if (isMapped)
+	{
+		return mapped;
+	}
+	KDTreeArrays tree;
+	tree.nodeNumber = block.size();
+	tree.blockNumber = leafCapacity * dimension > 0 ? blocks.size() / (leafCapacity * dimension) : 0;
+	tree.blocks = blocks.data();
+	tree.lower = lower.data();
+	tree.upper = upper.data();
+	tree.left = left.data();
+	tree.right = right.data();
+	tree.block = block.data();
+	tree.classCount = classCount.data();
+	tree.classTotal = classTotal.data();
+	return tree;
+}
+
+
+/********************************************************************
+ * @name	queryNode
+ * @brief	Accumulate the kernel sums of one subtree. A node is not
+ *			opened when, for every class, half the spread of the
+ *			kernel over its box is within that class's share of the
+ *			error budget. Each point then carries at most
+ *			max(absError, relError * L_c / n_c) error, where L_c is a
+ *			lower bound of the class sum collected so far. A node
+ *			whose largest kernel value is within twice the budget
+ *			counts at half that value, without the farthest corner.
+ * @param	tree - Arrays of the tree
+ * @param	node - Node index
+ * @param	distance - Smallest squared distance from x to the node
+ * @param	x - Query point
+ * @param	scale - Exponent factor
+ * @param	absError - Allowed absolute error per point
+ * @param	relError - Allowed relative error
+ * @param	sums - Estimated kernel sums, accumulated
+ * @param	lowerSums - Lower bounds of the kernel sums, accumulated
+ * @param	work - Cost of the query, accumulated
+ * @return	none
+ * */
+void KDTree::queryNode(const KDTreeArrays& tree, int node, double distance, const double* x, double scale,
+	double absError, double relError, double* sums, double* lowerSums, size_t& work) const
+{
+	work += KDTREE_NODE_COST;
+	double kernelMax = exp(scale * distance);
+	const size_t* counts = tree.classCount + node * classes;
+	// Smallest budget over the classes of the node
+	double budget = HUGE_VAL;
+	for (int c = 0; c < classes; c++)
+	{
+		if (counts[c] > 0)
+		{
+			budget = min(budget, max(absError, relError * lowerSums[c] / tree.classTotal[c]));
+		}
+	}
+	if (kernelMax <= 2 * budget)
+	{
+		for (int c = 0; c < classes; c++)
+		{
+			sums[c] += counts[c] * kernelMax / 2;
+		}
+		return;
+	}
+	double kernelMin = exp(scale * maxDistance(tree, node, x));
+	if ((kernelMax - kernelMin) / 2 <= budget)
+	{
+		for (int c = 0; c < classes; c++)
+		{
+			sums[c] += counts[c] * (kernelMax + kernelMin) / 2;
+			lowerSums[c] += counts[c] * kernelMin;
+		}
+		return;
+	}
+	if (tree.block[node] >= 0)
+	{
+		// Leaf: exact sums, the points of each class are contiguous
+		const double* columns = tree.blocks + tree.block[node] * leafCapacity * dimension;
+		size_t offset = 0;
+		for (int c = 0; c < classes; c++)
+		{
+			if (counts[c] == 0)
+			{
+				continue;
+			}
+			double sum = gaussKernelSum(columns + offset, leafCapacity, counts[c], dimension, x, scale);
+			work += counts[c];
+			sums[c] += sum;
+			lowerSums[c] += sum;
+			offset += counts[c];
+		}
+		return;
+	}
+	// Visit the closer child first so the lower bounds grow early
+	int first = tree.left[node];
+	int second = tree.right[node];
+	double firstDistance = minDistance(tree, first, x);
+	double secondDistance = minDistance(tree, second, x);
+	if (secondDistance < firstDistance)
+	{
+		swap(first, second);
+		swap(firstDistance, secondDistance);
+	}
+	queryNode(tree, first, firstDistance, x, scale, absError, relError, sums, lowerSums, work);
+	queryNode(tree, second, secondDistance, x, scale, absError, relError, sums, lowerSums, work);
+}
+
+
+/********************************************************************
+ * @name	minDistance
+ * @brief	Smallest squared distance from a point to a node's box
+ * @param	tree - Arrays of the tree
+ * @param	node - Node index
+ * @param	x - Query point
+ * @return	Squared distance
+ * */
+double KDTree::minDistance(const KDTreeArrays& tree, int node, const double* x) const
+{
+	double distance = 0;
+	for (int f = 0; f < dimension; f++)
+	{
+		double lo = tree.lower[node * dimension + f];
+		double hi = tree.upper[node * dimension + f];
+		double diff = x[f] < lo ? lo - x[f] : (x[f] > hi ? x[f] - hi : 0.0);
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+
+/********************************************************************
+ * @name	maxDistance
+ * @brief	Largest squared distance from a point to a node's box
+ * @param	tree - Arrays of the tree
+ * @param	node - Node index
+ * @param	x - Query point
+ * @return	Squared distance
+ * */
+double KDTree::maxDistance(const KDTreeArrays& tree, int node, const double* x) const
+{
+	double distance = 0;
+	for (int f = 0; f < dimension; f++)
+	{
+		double diff = max(fabs(x[f] - tree.lower[node * dimension + f]),
+			fabs(x[f] - tree.upper[node * dimension + f]));
+		distance += diff * diff;
+	}
+	return distance;
+}
+
+
+/********************************************************************
+ * @name	size
+ * @brief	Number of indexed points
+ * @param	none
+ * @return	Number of points
+ * */
+size_t KDTree::size() const
+{
+	return number;
+}
+
+
+/********************************************************************
+ * @name	save
+ * @brief	Add the arrays queries read to a model file
+ * @param	writer - Model file being written
+ * @param	firstSection - Id of the first of the tree's sections
+ * @return	none
+ * */
+void KDTree::save(ModelWriter& writer, uint32_t firstSection) const
+{
+	KDTreeArrays tree = arrays();
+	size_t nodes = tree.nodeNumber;
+	size_t values = tree.blockNumber * leafCapacity * dimension;
+	KDTreeParameters parameters = { number, leafCapacity, nodes, tree.blockNumber };
+	writer.add(firstSection + KDTREE_SECTION_PARAMETERS, &parameters, sizeof(parameters));
+	writer.add(firstSection + KDTREE_SECTION_BLOCKS, tree.blocks, values * sizeof(double));
+	writer.add(firstSection + KDTREE_SECTION_LOWER, tree.lower, nodes * dimension * sizeof(double));
+	writer.add(firstSection + KDTREE_SECTION_UPPER, tree.upper, nodes * dimension * sizeof(double));
+	writer.add(firstSection + KDTREE_SECTION_LEFT, tree.left, nodes * sizeof(int));
+	writer.add(firstSection + KDTREE_SECTION_RIGHT, tree.right, nodes * sizeof(int));
+	writer.add(firstSection + KDTREE_SECTION_BLOCK, tree.block, nodes * sizeof(int));
+	writer.add(firstSection + KDTREE_SECTION_CLASS_COUNT, tree.classCount, nodes * classes * sizeof(size_t));
+	writer.add(firstSection + KDTREE_SECTION_CLASS_TOTAL, tree.classTotal, classes * sizeof(size_t));
+}
+
+
+/********************************************************************
+ * @name	load
+ * @brief	Serve queries from a tree inside a mapped model file. The
+ *			structure is checked first, so a damaged file cannot make
+ *			a query read outside the mapping: the children of a node
+ *			come after it and every leaf's counts fit in its block.
+ * @param	file - Mapped model file, kept open by the caller
+ * @param	firstSection - Id of the first of the tree's sections
+ * @param	dimension - Number of features
+ * @param	classes - Number of classes
+ * @return	Whether the tree is valid, the tree is empty otherwise
+ * */
+bool KDTree::load(const ModelFile& file, uint32_t firstSection, int dimension, int classes)
+{
+	build(nullptr, nullptr, 0, dimension, classes);
+	const KDTreeParameters* parameters = file.array<KDTreeParameters>(firstSection + KDTREE_SECTION_PARAMETERS, 1);
+	if (parameters == nullptr || parameters->nodes == 0 || parameters->nodes > (uint64_t)INT32_MAX
+		|| parameters->leafCapacity == 0 || parameters->leafCapacity % (FEATURE_ALIGNMENT / sizeof(double)) != 0
+		|| parameters->blocks > SIZE_MAX / parameters->leafCapacity / max(dimension, 1))
+	{
+		return false;
+	}
+	size_t nodes = parameters->nodes;
+	KDTreeArrays tree;
+	tree.nodeNumber = nodes;
+	tree.blockNumber = parameters->blocks;
+	tree.blocks = file.array<double>(firstSection + KDTREE_SECTION_BLOCKS,
+		tree.blockNumber * parameters->leafCapacity * dimension);
+	tree.lower = file.array<double>(firstSection + KDTREE_SECTION_LOWER, nodes * dimension);
+	tree.upper = file.array<double>(firstSection + KDTREE_SECTION_UPPER, nodes * dimension);
+	tree.left = file.array<int>(firstSection + KDTREE_SECTION_LEFT, nodes);
+	tree.right = file.array<int>(firstSection + KDTREE_SECTION_RIGHT, nodes);
+	tree.block = file.array<int>(firstSection + KDTREE_SECTION_BLOCK, nodes);
+	tree.classCount = file.array<size_t>(firstSection + KDTREE_SECTION_CLASS_COUNT, nodes * classes);
+	tree.classTotal = file.array<size_t>(firstSection + KDTREE_SECTION_CLASS_TOTAL, classes);
+	if (tree.blocks == nullptr || tree.lower == nullptr || tree.upper == nullptr || tree.left == nullptr
+		|| tree.right == nullptr || tree.block == nullptr || tree.classCount == nullptr || tree.classTotal == nullptr)
+	{
+		return false;
+	}
+	for (size_t node = 0; node < nodes; node++)
+	{
+		const size_t* counts = tree.classCount + node * classes;
+		size_t count = 0;
+		for (int c = 0; c < classes; c++)
+		{
+			count += counts[c];
+		}
+		bool valid;
+		if (tree.block[node] >= 0)
+		{
+			valid = (size_t)tree.block[node] < tree.blockNumber && count <= parameters->leafCapacity;
+		}
+		else
+		{
+			valid = tree.left[node] > (int)node && (size_t)tree.left[node] < nodes
+				&& tree.right[node] > (int)node && (size_t)tree.right[node] < nodes;
+		}
+		if (!valid)
+		{
+			return false;
+		}
+	}
+	size_t total = 0;
+	for (int c = 0; c < classes; c++)
+	{
+		total += tree.classTotal[c];
+	}
+	if (total != parameters->number)
+	{
+		return false;
+	}
+	number = parameters->number;
+	leafCapacity = parameters->leafCapacity;
+	mapped = tree;
+	isMapped = true;
+	return true;
+}
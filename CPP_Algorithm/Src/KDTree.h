@@ -0,0 +1,165 @@
+/********************************************************************
+ * @File name:		KDTree.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-16
+ * @Description:	Declare KD-tree index for bounded-error Gaussian
+ *					kernel sums
+ ********************************************************************/
+
+#pragma once
+
+#ifndef KDTREE_H
+#define KDTREE_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "AlignedAllocator.h"
+#include "ModelFile.h"
+
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Points per leaf after a build. Leaves of a few hundred points keep
+// the SIMD kernels busy and the number of visited nodes low.
+#define KDTREE_LEAF_SIZE 256
+// Cost of visiting a node, in kernel values of one point: two
+// exponentials, the distances to two boxes and the recursion
+#define KDTREE_NODE_COST 64
+
+/********************************************************************
+ * @name	KDTreeArrays
+ * @brief	The arrays a query reads, owned by the tree or inside a
+ *			mapped model file
+ * */
+typedef struct
+{
+	// Number of nodes and of leaf blocks
+	size_t nodeNumber;
+	size_t blockNumber;
+	const double* blocks;
+	const double* lower;
+	const double* upper;
+	const int* left;
+	const int* right;
+	const int* block;
+	const size_t* classCount;
+	const size_t* classTotal;
+}KDTreeArrays;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	KDTree
+ * @brief	KD-tree over labelled points with per-node class counts.
+ *			Queries return the Gaussian kernel sum of every class.
+ *			Nodes whose kernel value varies too little over their
+ *			bounding box are not opened and count at the midpoint of
+ *			their bounds. The result of class c is then within
+ *			max(absError * n_c, relError * S_c) of the exact sum S_c.
+ *
+ *			Every leaf owns a block of leafCapacity slots, so points
+ *			can be inserted and removed in place: counts and boxes
+ *			are updated along the path to the root, and a full leaf
+ *			is split in two. The tree is never rebuilt.
+ *
+ *			save() stores the arrays queries read and load() serves
+ *			queries from them inside the mapped file. A loaded tree
+ *			is read-only until the next build().
+ * */
+class KDTree
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Number of features
+	int dimension = 0;
+	// Number of classes
+	int classes = 0;
+	// Number of points
+	size_t number = 0;
+	// Slots of every leaf block, a multiple of the SIMD alignment
+	size_t leafCapacity = 0;
+	// Leaf blocks, one column of leafCapacity values per feature. Inside
+	// a block the points are sorted by class.
+	AlignedVector blocks;
+	// Point id stored in each slot of each block
+	vector<size_t> slotId;
+	// Bounding box of each node, dimension values per node
+	vector<double> lower;
+	vector<double> upper;
+	// Children of each node, -1 for leaves
+	vector<int> left;
+	vector<int> right;
+	// Parent of each node, -1 for the root
+	vector<int> parent;
+	// Split of each inner node: points with x[splitFeature] below
+	// splitValue go left
+	vector<int> splitFeature;
+	vector<double> splitValue;
+	// Block of each leaf, -1 for inner nodes
+	vector<int> block;
+	// Number of points of each class in each node
+	vector<size_t> classCount;
+	// Number of points in each node
+	vector<size_t> pointCount;
+	// Number of points of each class in the whole tree
+	vector<size_t> classTotal;
+	// Leaf, slot and class of each point id, -1 leaf for unused ids
+	vector<int> pointLeaf;
+	vector<size_t> pointSlot;
+	vector<int> pointLabel;
+	// Arrays inside a mapped model file, used instead of the members
+	// above after load()
+	KDTreeArrays mapped;
+	bool isMapped = false;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	int buildNode(const double* points, const int* labels, const size_t* ids,
+		vector<size_t>& order, size_t first, size_t last, int leafSize, int parentNode);
+	int addNode(int parentNode);
+	void fillLeaf(int leaf, const double* points, const int* labels, const size_t* ids,
+		size_t* order, size_t count);
+	void moveSlot(int leaf, size_t from, size_t to);
+	void fitLeaf(int leaf);
+	void splitLeaf(int leaf);
+	int widestFeature(int node) const;
+	KDTreeArrays arrays() const;
+	void queryNode(const KDTreeArrays& tree, int node, double distance, const double* x, double scale,
+		double absError, double relError, double* sums, double* lowerSums, size_t& work) const;
+	double minDistance(const KDTreeArrays& tree, int node, const double* x) const;
+	double maxDistance(const KDTreeArrays& tree, int node, const double* x) const;
+
+public:
+	KDTree();
+	void build(const double* points, const int* labels, size_t number, int dimension,
+		int classes, int leafSize = KDTREE_LEAF_SIZE, const size_t* ids = nullptr);
+	void insert(const double* x, int label, size_t id);
+	void remove(size_t id);
+	void kernelSums(const double* x, double scale, double absError, double relError,
+		double* sums, size_t* work = nullptr) const;
+	size_t size() const;
+	void save(ModelWriter& writer, uint32_t firstSection) const;
+	bool load(const ModelFile& file, uint32_t firstSection, int dimension, int classes);
+};
+
+#endif
@@ -0,0 +1,189 @@
+/********************************************************************
+ * @File name:		MappedFile.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-26
+ * @Description:	Read-only memory-mapped file
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	MappedFile
+ * @brief	The constructor. Nothing is mapped until open().
+ * */
+MappedFile::MappedFile()
+{
+}
+
+
+/********************************************************************
+ * @name	~MappedFile
+ * @brief	The destructor. Unmaps the file.
+ * */
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+/********************************************************************
+ * @name	open
+ * @brief	Map a file, unmapping the previous one
+ * @param	filename - Name and path of the file
+ * @return	Whether the file could be mapped
+ * */
+bool MappedFile::open(const string& filename)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	length = (size_t)fileSize.QuadPart;
+	if (length > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+		{
+			close();
+			return false;
+		}
+		mappingHandle = mapping;
+		begin = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (begin == nullptr)
+		{
+			close();
+			return false;
+		}
+	}
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		::close(file);
+		return false;
+	}
+	length = (size_t)status.st_size;
+	if (length > 0)
+	{
+		void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+		if (address == MAP_FAILED)
+		{
+			::close(file);
+			length = 0;
+			return false;
+		}
+		// The file is read front to back
+		madvise(address, length, MADV_SEQUENTIAL);
+		begin = (const char*)address;
+	}
+	// The mapping stays valid after the descriptor is closed
+	::close(file);
+#endif
+	opened = true;
+	return true;
+}
+
+
+/********************************************************************
+ * @name	close
+ * @brief	Unmap the file
+ * @param	none
+ * @return	none
+ * */
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (begin != nullptr)
+	{
+		UnmapViewOfFile(begin);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (begin != nullptr)
+	{
+		munmap((void*)begin, length);
+	}
+#endif
+	begin = nullptr;
+	length = 0;
+	opened = false;
+}
+
+
+/********************************************************************
+ * @name	isOpen
+ * @brief	Whether a file is mapped
+ * @param	none
+ * @return	True after a successful open()
+ * */
+bool MappedFile::isOpen() const
+{
+	return opened;
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Contents of the file
+ * @param	none
+ * @return	Pointer to the first byte, nullptr for an empty file
+ * */
+const char* MappedFile::data() const
+{
+	return begin;
+}
+
+
+/********************************************************************
+ * @name	size
+ * @brief	Size of the file
+ * @param	none
+ * @return	Number of bytes
+ * */
+size_t MappedFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,71 @@
+/********************************************************************
+ * @File name:		MappedFile.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-26
+ * @Description:	Declare a read-only memory-mapped file
+ ********************************************************************/
+
+#pragma once
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include <cstddef>
+#include <string>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	MappedFile
+ * @brief	Maps a whole file read-only into memory. The pages are
+ *			loaded by the operating system on first access, so
+ *			nothing is copied and large files can be parsed in place.
+ * */
+class MappedFile
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// First byte of the file, nullptr when nothing is mapped
+	const char* begin = nullptr;
+	// Size of the file in bytes
+	size_t length = 0;
+	// Whether open() succeeded
+	bool opened = false;
+#ifdef _WIN32
+	// File and mapping handles
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool open(const string& filename);
+	void close();
+	bool isOpen() const;
+	const char* data() const;
+	size_t size() const;
+};
+
+#endif
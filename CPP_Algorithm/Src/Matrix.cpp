@@ -11,15 +11,9 @@
  //-------------------------------------------------------------------
 #include "Matrix.h"
 
+#include <algorithm>
 #include <math.h>
-
-
-//-------------------------------------------------------------------
-// Constants and Typedefine
-//-------------------------------------------------------------------
-
-// If the value is less than this value, it is judged to be 0.
-const double epsilon = 1e-12;
+#include <stdexcept>
 
 
 //-------------------------------------------------------------------
@@ -32,15 +26,8 @@ const double epsilon = 1e-12;
  * @param	row - Matrix rows
  * @param	column - Matrix columns
  * */
-Matrix::Matrix(int row, int column)
+Matrix::Matrix(int row, int column) : row(row), column(column), mat((size_t)row * column, 0.0)
 {
-	this->row = row;
-	this->column = column;
-	for (int i = 0; i < row; i++)
-	{
-		vector<double> aRow(column, 0);
-		this->mat.push_back(aRow);
-	}
 }
 
 
@@ -49,21 +36,11 @@ Matrix::Matrix(int row, int column)
  * @brief	Constructor. Create a matrix with an input initial value.
  * @param	row - Matrix rows
  * @param	column - Matrix columns
- * @param	mat - Input initial value
+ * @param	mat - Input initial value, row-major
  * */
-Matrix::Matrix(int row, int column, double* mat)
+Matrix::Matrix(int row, int column, const double* mat) : row(row), column(column),
+	mat(mat, mat + (size_t)row * column)
 {
-	this->row = row;
-	this->column = column;
-	for (int i = 0; i < row; i++)
-	{
-		vector<double> aRow;
-		for (int j = 0; j < column; j++)
-		{
-			aRow.push_back(*mat++);
-		}
-		this->mat.push_back(aRow);
-	}
 }
 
 
@@ -83,19 +60,67 @@ Matrix::~Matrix()
  * @param	none
  * @return	none
  * */
-void Matrix::print()
+void Matrix::print() const
 {
 	for (int i = 0; i < row; i++)
 	{
 		for (int j = 0; j < column; j++)
 		{
-			cout << mat[i][j] << "\t\t";
+			cout << mat[i * column + j] << "\t\t";
 		}
 		cout << endl;
 	}
 }
 
 
+/********************************************************************
+ * @name	rows
+ * @brief	Gets the number of rows.
+ * @param	none
+ * @return	Matrix rows
+ * */
+int Matrix::rows() const
+{
+	return row;
+}
+
+
+/********************************************************************
+ * @name	columns
+ * @brief	Gets the number of columns.
+ * @param	none
+ * @return	Matrix columns
+ * */
+int Matrix::columns() const
+{
+	return column;
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Gets the row-major element buffer.
+ * @param	none
+ * @return	Pointer to the first element
+ * */
+double* Matrix::data()
+{
+	return mat.data();
+}
+
+
+/********************************************************************
+ * @name	data
+ * @brief	Gets the row-major element buffer.
+ * @param	none
+ * @return	Pointer to the first element
+ * */
+const double* Matrix::data() const
+{
+	return mat.data();
+}
+
+
 /********************************************************************
  * @name	get
  * @brief	Gets the value of a location.
@@ -103,9 +128,13 @@ void Matrix::print()
  * @param	column - Matrix columns
  * @return	The value in the position
  * */
-double Matrix::get(int row, int column)
+double Matrix::get(int row, int column) const
 {
-	return mat.at(row).at(column);
+	if (row < 0 || row >= this->row || column < 0 || column >= this->column)
+	{
+		throw out_of_range("Matrix::get");
+	}
+	return mat[row * this->column + column];
 }
 
 
@@ -119,282 +148,502 @@ double Matrix::get(int row, int column)
  * */
 void Matrix::set(int row, int column, double value)
 {
+	mat[row * this->column + column] = value;
+}
 
-	mat[row][column] = value;
+
+/********************************************************************
+ * @name	inverse
+ * @brief	Compute the inverse of the matrix
+ * @param	matrix - A matrix
+ * @return	Inverse of the matrix
+ * */
+Matrix Matrix::inverse(const Matrix& matrix)
+{
+	if (matrix.row != matrix.column)
+	{
+		cout << "Invalid matrix dimension!" << endl;
+		exit(0);
+	}
+	int n = matrix.row;
+	Matrix inv_A(n, n);
+	vector<double> work((size_t)n * n);
+	Matrix::inverse(matrix.mat.data(), inv_A.mat.data(), n, work.data());
+	return inv_A;
 }
 
 
 /********************************************************************
- * @name	operator+
- * @brief	Implement matrix addition
- * @param	B - Another matrix
- * @return	Matrix plus result
+ * @name	inverse
+ * @brief	Compute the inverse of a row-major n x n buffer by
+ *			Gauss-Jordan elimination with partial pivoting, without
+ *			allocating. Symmetric positive definite matrices are
+ *			better served by cholesky() and choleskyInverse().
+ * @param	A - Input matrix
+ * @param	inv_A - Output inverse, may not alias A
+ * @param	n - Matrix order
+ * @param	work - Scratch of at least n * n values
+ * @return	none
  * */
-Matrix Matrix::operator+(const Matrix B)
+void Matrix::inverse(const double* A, double* inv_A, int n, double* work)
 {
-	Matrix* C = new Matrix(row, column);
-	for (int i = 0; i < row; i++)
+	double* a = work;
+	copy(A, A + n * n, a);
+	fill(inv_A, inv_A + n * n, 0.0);
+	for (int i = 0; i < n; i++)
 	{
-		for (int j = 0; j < column; j++)
+		inv_A[i * n + i] = 1;
+	}
+	for (int j = 0; j < n; j++)
+	{
+		// Largest pivot of the column
+		int pivot = j;
+		for (int i = j + 1; i < n; i++)
 		{
-			C->mat[i][j] = mat[i][j] + B.mat[i][j];
-			if (abs(C->mat[i][j]) < epsilon)
+			if (fabs(a[i * n + j]) > fabs(a[pivot * n + j]))
 			{
-				C->mat[i][j] = 0.0;
+				pivot = i;
+			}
+		}
+		if (pivot != j)
+		{
+			swap_ranges(a + j * n, a + (j + 1) * n, a + pivot * n);
+			swap_ranges(inv_A + j * n, inv_A + (j + 1) * n, inv_A + pivot * n);
+		}
+		double scale = 1 / a[j * n + j];
+		for (int k = 0; k < n; k++)
+		{
+			a[j * n + k] *= scale;
+			inv_A[j * n + k] *= scale;
+		}
+		// Eliminate the column from every other row
+		for (int i = 0; i < n; i++)
+		{
+			double factor = a[i * n + j];
+			if (i == j || factor == 0)
+			{
+				continue;
+			}
+			for (int k = 0; k < n; k++)
+			{
+				a[i * n + k] -= factor * a[j * n + k];
+				inv_A[i * n + k] -= factor * inv_A[j * n + k];
 			}
 		}
 	}
-	return *C;
 }
 
 
 /********************************************************************
- * @name	operator-
- * @brief	Implement matrix minus
- * @param	B - Another matrix
- * @return	Matrix minus result
+ * @name	det
+ * @brief	Compute the determinant of the matrix
+ * @param	matrix - A matrix
+ * @return	Determinant of the matrix
  * */
-Matrix Matrix::operator-(const Matrix B)
+double Matrix::det(const Matrix& matrix)
 {
-	Matrix* C = new Matrix(row, column);
-	for (int i = 0; i < row; i++)
+	if (matrix.row != matrix.column)
 	{
-		for (int j = 0; j < column; j++)
-		{
-			C->mat[i][j] = mat[i][j] - B.mat[i][j];
-			if (abs(C->mat[i][j]) < epsilon)
-			{
-				C->mat[i][j] = 0.0;
-			}
-		}
+		cout << "Invalid matrix dimension!" << endl;
+		exit(0);
 	}
-	return *C;
+	int n = matrix.row;
+	vector<double> work((size_t)n * n);
+	return Matrix::det(matrix.mat.data(), n, work.data());
 }
 
 
 /********************************************************************
- * @name	operator*
- * @brief	Implement matrix multiplication
- * @param	B - Another matrix
- * @return	Matrix multiplication result
+ * @name	solve
+ * @brief	Solve A * X = B for a symmetric positive definite A through
+ *			its Cholesky factor, regularised if A is only
+ *			semi-definite
+ * @param	A - A symmetric positive definite matrix
+ * @param	B - Right-hand sides, one per column
+ * @return	The solution X
  * */
-Matrix Matrix::operator*(const Matrix B)
+Matrix Matrix::solve(const Matrix& A, const Matrix& B)
 {
-	int A_row = row;
-	int A_column = column;
-	int B_row = B.row;
-	int B_column = B.column;
-	if (A_column != B_row)
+	if (A.row != A.column || B.row != A.row)
 	{
 		cout << "Invalid matrix dimension!" << endl;
 		exit(0);
 	}
-	Matrix* C = new Matrix(A_row, B_column);
-	for (int i = 0; i < A_row; i++)
+	int n = A.row;
+	vector<double> L((size_t)n * n);
+	if (Matrix::choleskyRegularised(A.mat.data(), L.data(), n) < 0)
 	{
-		for (int j = 0; j < B_column; j++)
-		{
-			C->mat[i][j] = 0;
-			for (int k = 0; k < A_column; k++)
-			{
-				C->mat[i][j] += mat[i][k] * B.mat[k][j];
-			}
-			if (abs(C->mat[i][j]) < epsilon)
-			{
-				C->mat[i][j] = 0.0;
-			}
-		}
+		cout << "Matrix is not positive definite!" << endl;
+		exit(0);
 	}
-	return *C;
+	Matrix X = B;
+	Matrix::choleskySolve(L.data(), X.mat.data(), n, B.column);
+	return X;
 }
 
 
 /********************************************************************
- * @name	operator*
- * @brief	Implement matrix multiplication with a constant
- * @param	B - A constant
- * @return	Matrix multiplication result
+ * @name	det
+ * @brief	Compute the determinant of a row-major n x n buffer by LU
+ *			factorisation with partial pivoting, without allocating.
+ *			For covariance matrices, whose determinant overflows for
+ *			long feature vectors, use choleskyLogDet().
+ * @param	A - Input matrix
+ * @param	n - Matrix order
+ * @param	work - Scratch of at least n * n values
+ * @return	Determinant of the matrix
  * */
-Matrix Matrix::operator*(const double B)
+double Matrix::det(const double* A, int n, double* work)
 {
-	Matrix* C = new Matrix(row, column);
-	for (int i = 0; i < row; i++)
+	double* a = work;
+	copy(A, A + n * n, a);
+	double determinant = 1;
+	for (int j = 0; j < n; j++)
 	{
-		for (int j = 0; j < column; j++)
+		int pivot = j;
+		for (int i = j + 1; i < n; i++)
+		{
+			if (fabs(a[i * n + j]) > fabs(a[pivot * n + j]))
+			{
+				pivot = i;
+			}
+		}
+		if (a[pivot * n + j] == 0)
+		{
+			return 0;
+		}
+		if (pivot != j)
 		{
-			C->mat[i][j] = B * mat[i][j];
+			swap_ranges(a + j * n, a + (j + 1) * n, a + pivot * n);
+			determinant = -determinant;
+		}
+		determinant *= a[j * n + j];
+		for (int i = j + 1; i < n; i++)
+		{
+			double factor = a[i * n + j] / a[j * n + j];
+			for (int k = j + 1; k < n; k++)
+			{
+				a[i * n + k] -= factor * a[j * n + k];
+			}
 		}
 	}
-	return *C;
+	return determinant;
 }
 
 
 /********************************************************************
- * @name	trans
- * @brief	Compute the transpose of the matrix
- * @param	matrix - A matrix
- * @return	Transpose of the matrix
+ * @name	cholesky
+ * @brief	Cholesky factorisation A + ridge * I = L * L^T of a
+ *			symmetric positive definite row-major n x n buffer. Only
+ *			the lower triangle of A is read. Each element of L is a
+ *			dot product of two contiguous row prefixes.
+ * @param	A - Input symmetric matrix
+ * @param	L - Output lower triangular factor, the upper triangle is
+ *			set to 0. May alias A.
+ * @param	n - Matrix order
+ * @param	ridge - Value added to the diagonal
+ * @return	False when A + ridge * I is not positive definite
  * */
-Matrix Matrix::trans(const Matrix matrix)
+bool Matrix::cholesky(const double* A, double* L, int n, double ridge)
 {
-	int row = matrix.column;
-	int column = matrix.row;
-	Matrix* AT = new Matrix(row, column);
-	for (int i = 0; i < row; i++)
+	for (int i = 0; i < n; i++)
 	{
-		for (int j = 0; j < column; j++)
+		const double* Li = L + i * n;
+		for (int j = 0; j <= i; j++)
 		{
-			AT->mat[i][j] = matrix.mat[j][i];
+			const double* Lj = L + j * n;
+			double sum = A[i * n + j];
+			for (int k = 0; k < j; k++)
+			{
+				sum -= Li[k] * Lj[k];
+			}
+			if (j < i)
+			{
+				L[i * n + j] = sum / Lj[j];
+				continue;
+			}
+			sum += ridge;
+			// Also rejects NaN
+			if (!(sum > 0))
+			{
+				return false;
+			}
+			L[i * n + i] = sqrt(sum);
 		}
+		fill(L + i * n + i + 1, L + (i + 1) * n, 0.0);
 	}
-	return *AT;
+	return true;
 }
 
 
 /********************************************************************
- * @name	inverse
- * @brief	Compute the inverse of the matrix
- * @param	matrix - A matrix
- * @return	Inverse of the matrix
+ * @name	choleskyRegularised
+ * @brief	Cholesky factorisation that retries with a growing ridge
+ *			on the diagonal when A is only semi-definite. The first
+ *			ridge is MATRIX_RIDGE times the mean diagonal and each
+ *			retry multiplies it by 10.
+ * @param	A - Input symmetric matrix, may not alias L
+ * @param	L - Output lower triangular factor
+ * @param	n - Matrix order
+ * @return	The ridge added to the diagonal, 0 when none was needed,
+ *			negative when every attempt failed
  * */
-Matrix Matrix::inverse(const Matrix matrix)
+double Matrix::choleskyRegularised(const double* A, double* L, int n)
 {
-	if (matrix.row != matrix.column)
+	if (cholesky(A, L, n, 0))
 	{
-		cout << "Invalid matrix dimension!" << endl;
-		exit(0);
+		return 0;
 	}
-	int n = matrix.row;
-	Matrix* inv_A = new Matrix(n, n);
-	Matrix L(n, n);
-	Matrix U(n, n);
-	Matrix inv_L(n, n);
-	Matrix inv_U(n, n);
-	// Factor L and U
+	double trace = 0;
 	for (int i = 0; i < n; i++)
 	{
-		L.mat[i][i] = 1;
+		trace += fabs(A[i * n + i]);
 	}
-	for (int i = 0; i < n; i++)
-	{
-		U.mat[0][i] = matrix.mat[0][i];
-	}
-	for (int i = 1; i < n; i++)
+	double ridge = MATRIX_RIDGE * (trace > 0 ? trace / n : 1);
+	for (int retry = 0; retry < MATRIX_RIDGE_RETRIES; retry++, ridge *= 10)
 	{
-		L.mat[i][0] = 1.0 * matrix.mat[i][0] / matrix.mat[0][0];
+		if (cholesky(A, L, n, ridge))
+		{
+			return ridge;
+		}
 	}
-	// Compute the L and U triangles
-	for (int i = 1; i < n; i++)
+	return -1;
+}
+
+
+/********************************************************************
+ * @name	choleskySolve
+ * @brief	Solve A * X = B in place from the Cholesky factor of A, by
+ *			forward substitution with L and back substitution with
+ *			L^T
+ * @param	L - Lower triangular factor
+ * @param	B - Right-hand sides, row-major n x m, replaced by X
+ * @param	n - Matrix order
+ * @param	m - Number of right-hand sides
+ * @return	none
+ * */
+void Matrix::choleskySolve(const double* L, double* B, int n, int m)
+{
+	for (int i = 0; i < n; i++)
 	{
-		for (int j = i; j < n; j++)
+		double* Bi = B + i * m;
+		for (int k = 0; k < i; k++)
 		{
-			double tem = 0;
-			for (int k = 0; k < i; k++)
+			double factor = L[i * n + k];
+			const double* Bk = B + k * m;
+			for (int c = 0; c < m; c++)
 			{
-				tem += L.mat[i][k] * U.mat[k][j];
-			}
-			U.mat[i][j] = matrix.mat[i][j] - tem;
-			if (abs(U.mat[i][j]) < epsilon)
-			{
-				U.mat[i][j] = 0.0;
+				Bi[c] -= factor * Bk[c];
 			}
 		}
-		// Compute L (row J, column I)
-		for (int j = i; j < n; j++)
+		for (int c = 0; c < m; c++)
 		{
-			double tem = 0;
-			for (int k = 0; k < i; k++)
-			{
-				tem += L.mat[j][k] * U.mat[k][i];
-			}
-			L.mat[j][i] = 1.0 * (matrix.mat[j][i] - tem) / U.mat[i][i];
-			if (abs(L.mat[i][j]) < epsilon)
-			{
-				L.mat[i][j] = 0.0;
-			}
+			Bi[c] /= L[i * n + i];
 		}
 	}
-	// The rest of L and U is set to 0
-	for (int i = 0; i < n; i++)
+	for (int i = n - 1; i >= 0; i--)
 	{
-		for (int j = 0; j < n; j++)
+		double* Bi = B + i * m;
+		for (int k = i + 1; k < n; k++)
 		{
-			if (i > j)
-			{
-				U.mat[i][j] = 0.0;
-			}
-			else if (i < j)
+			double factor = L[k * n + i];
+			const double* Bk = B + k * m;
+			for (int c = 0; c < m; c++)
 			{
-				L.mat[i][j] = 0.0;
+				Bi[c] -= factor * Bk[c];
 			}
 		}
+		for (int c = 0; c < m; c++)
+		{
+			Bi[c] /= L[i * n + i];
+		}
 	}
-	// The inverse of the matrix U
+}
+
+
+/********************************************************************
+ * @name	choleskyInverse
+ * @brief	Inverse of A from its Cholesky factor: W = L^-1 row by row,
+ *			then A^-1 = W^T * W. Both steps take about n^3 / 6
+ *			multiply-adds over contiguous rows.
+ * @param	L - Lower triangular factor
+ * @param	inv_A - Output symmetric inverse, may not alias L
+ * @param	n - Matrix order
+ * @param	work - Scratch of at least n * n values
+ * @return	none
+ * */
+void Matrix::choleskyInverse(const double* L, double* inv_A, int n, double* work)
+{
+	double* W = work;
+	fill(W, W + n * n, 0.0);
 	for (int i = 0; i < n; i++)
 	{
-		// Take the value of the diagonal element of U, and just take the inverse
-		inv_U.mat[i][i] = 1 / U.mat[i][i];
-		for (int k = i - 1; k >= 0; k--)
+		// Row i of L * W = I: W[i][j] = -sum(L[i][k] * W[k][j]) / L[i][i]
+		double* Wi = W + i * n;
+		for (int k = 0; k < i; k++)
 		{
-			double s = 0;
-			for (int j = k + 1; j <= i; j++)
-			{
-				s = s + U.mat[k][j] * inv_U.mat[j][i];
-			}
-			// Iterating, getting each value in reverse order.
-			inv_U.mat[k][i] = -s / U.mat[k][k];
-			if (abs(inv_U.mat[k][i]) < epsilon)
+			double factor = L[i * n + k];
+			const double* Wk = W + k * n;
+			for (int j = 0; j <= k; j++)
 			{
-				inv_U.mat[k][i] = 0.0;
+				Wi[j] -= factor * Wk[j];
 			}
 		}
+		double diagonal = 1 / L[i * n + i];
+		for (int j = 0; j < i; j++)
+		{
+			Wi[j] *= diagonal;
+		}
+		Wi[i] = diagonal;
 	}
-	// Take the inverse of L
-	for (int i = 0; i < n; i++)
+	// Lower triangle of W^T * W, then mirror it
+	fill(inv_A, inv_A + n * n, 0.0);
+	for (int k = 0; k < n; k++)
 	{
-		inv_L.mat[i][i] = 1;
-		for (int k = i + 1; k < n; k++)
+		const double* Wk = W + k * n;
+		for (int a = 0; a <= k; a++)
 		{
-			for (int j = i; j <= k - 1; j++)
+			double factor = Wk[a];
+			double* row = inv_A + a * n;
+			for (int b = 0; b <= a; b++)
 			{
-				inv_L.mat[k][i] = inv_L.mat[k][i] - L.mat[k][j] * inv_L.mat[j][i];
-				if (abs(inv_L.mat[k][i]) < epsilon)
-				{
-					inv_L.mat[k][i] = 0.0;
-				}
+				row[b] += factor * Wk[b];
 			}
 		}
 	}
-	*inv_A = inv_U * inv_L;
-	return *inv_A;
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < a; b++)
+		{
+			inv_A[b * n + a] = inv_A[a * n + b];
+		}
+	}
 }
 
 
 /********************************************************************
- * @name	det
- * @brief	Compute the determinant of the matrix
- * @param	matrix - A matrix
- * @return	Determinant of the matrix
+ * @name	choleskyLogDet
+ * @brief	Log-determinant of A from its Cholesky factor, which does
+ *			not overflow like the determinant itself
+ * @param	L - Lower triangular factor
+ * @param	n - Matrix order
+ * @return	log|A| = 2 * sum(log L[i][i])
  * */
-double Matrix::det(const Matrix matrix)
+double Matrix::choleskyLogDet(const double* L, int n)
 {
-	if (matrix.row != matrix.column)
+	double sum = 0;
+	for (int i = 0; i < n; i++)
 	{
-		cout << "Invalid matrix dimension!" << endl;
-		exit(0);
+		sum += log(L[i * n + i]);
 	}
-	else if (matrix.row == 1)
+	return 2 * sum;
+}
+
+
+/********************************************************************
+ * @name	eigenSymmetric
+ * @brief	Eigendecomposition of a symmetric row-major n x n buffer
+ *			with the cyclic Jacobi method
+ * @param	A - Input symmetric matrix
+ * @param	values - Output n eigenvalues in descending order
+ * @param	vectors - Output n x n buffer, row j is the unit eigenvector
+ *			of values[j]
+ * @param	n - Matrix order
+ * @param	work - Scratch of at least 2 * n * n values
+ * @return	none
+ * */
+void Matrix::eigenSymmetric(const double* A, double* values, double* vectors, int n, double* work)
+{
+	double* a = work;
+	double* V = work + n * n;
+	copy(A, A + n * n, a);
+	fill(V, V + n * n, 0.0);
+	for (int i = 0; i < n; i++)
 	{
-		return matrix.mat[0][0];
+		V[i * n + i] = 1;
 	}
-	int n = matrix.row;
-	double sum = 0;
-	for (int i = 0; i < n; i++)
+	// Rotate away the off-diagonal elements until they vanish
+	for (int sweep = 0; sweep < 100; sweep++)
+	{
+		double off = 0;
+		double diag = 0;
+		for (int p = 0; p < n; p++)
+		{
+			diag += a[p * n + p] * a[p * n + p];
+			for (int q = p + 1; q < n; q++)
+			{
+				off += a[p * n + q] * a[p * n + q];
+			}
+		}
+		if (off <= 1e-30 * diag || off == 0)
+		{
+			break;
+		}
+		for (int p = 0; p < n; p++)
+		{
+			for (int q = p + 1; q < n; q++)
+			{
+				double apq = a[p * n + q];
+				if (apq == 0)
+				{
+					continue;
+				}
+				double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+				double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1));
+				double c = 1 / sqrt(t * t + 1);
+				double s = t * c;
+				for (int k = 0; k < n; k++)
+				{
+					double akp = a[k * n + p];
+					double akq = a[k * n + q];
+					a[k * n + p] = c * akp - s * akq;
+					a[k * n + q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < n; k++)
+				{
+					double apk = a[p * n + k];
+					double aqk = a[q * n + k];
+					a[p * n + k] = c * apk - s * aqk;
+					a[q * n + k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < n; k++)
+				{
+					double vkp = V[k * n + p];
+					double vkq = V[k * n + q];
+					V[k * n + p] = c * vkp - s * vkq;
+					V[k * n + q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+	// Sort by descending eigenvalue, the eigenvectors are the columns of V
+	for (int j = 0; j < n; j++)
+	{
+		values[j] = a[j * n + j];
+	}
+	for (int j = 0; j < n; j++)
 	{
-		Matrix complement = Matrix::cofactor(matrix, i, 0);
-		sum += pow(-1, (i + 1) + 1) * matrix.mat[i][0] * Matrix::det(complement);
+		int best = j;
+		for (int k = j + 1; k < n; k++)
+		{
+			if (values[k] > values[best])
+			{
+				best = k;
+			}
+		}
+		if (best != j)
+		{
+			swap(values[j], values[best]);
+			for (int k = 0; k < n; k++)
+			{
+				swap(V[k * n + j], V[k * n + best]);
+			}
+		}
+		for (int k = 0; k < n; k++)
+		{
+			vectors[j * n + k] = V[k * n + j];
+		}
 	}
-	return sum;
 }
 
 
@@ -406,10 +655,10 @@ double Matrix::det(const Matrix matrix)
  * @param	column - Columns that need to be deleted
  * @return	Cofactor of the matrix
  * */
-Matrix Matrix::cofactor(const Matrix matrix, const int row, const int column)
+Matrix Matrix::cofactor(const Matrix& matrix, const int row, const int column)
 {
 	int n = matrix.row;
-	Matrix* cofactor = new Matrix(n - 1, n - 1);
+	Matrix cofactor(n - 1, n - 1);
 	int rowIndex = 0;
 	for (int i = 0; i < n; i++)
 	{
@@ -417,7 +666,7 @@ Matrix Matrix::cofactor(const Matrix matrix, const int row, const int column)
 		for (int j = 0; j < n; j++)
 		{
 			if (i != row && j != column) {
-				cofactor->mat[rowIndex][columnIndex] = matrix.mat[i][j];
+				cofactor.mat[rowIndex * (n - 1) + columnIndex] = matrix.mat[i * n + j];
 				columnIndex++;
 			}
 		}
@@ -426,5 +675,5 @@ Matrix Matrix::cofactor(const Matrix matrix, const int row, const int column)
 			rowIndex++;
 		}
 	}
-	return *cofactor;
-}
\ No newline at end of file
+	return cofactor;
+}
@@ -15,6 +15,10 @@
  //-------------------------------------------------------------------
  // Includes
  //-------------------------------------------------------------------
+#include "Arena.h"
+
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
@@ -25,45 +29,978 @@
 using namespace std;
 
 
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// If the value is less than this value, it is judged to be 0.
+const double MATRIX_EPSILON = 1e-12;
+// First ridge tried when a Cholesky factorisation fails, relative to
+// the mean diagonal element
+const double MATRIX_RIDGE = 1e-10;
+// Number of ridges tried, each 10 times the previous one
+const int MATRIX_RIDGE_RETRIES = 10;
+
+
+class Matrix;
+template<typename E> class MatrixTranspose;
+
+
 //-------------------------------------------------------------------
 // Class Declaration
 //-------------------------------------------------------------------
 
+/********************************************************************
+ * @name	MatrixExpression
+ * @brief	Base of everything that can be read as a matrix. The
+ *			operators build a tree of expressions instead of
+ *			computing; the tree is evaluated element by element,
+ *			once, when it is assigned to a Matrix or read with
+ *			Matrix::scalar(). Expressions refer to the matrices they
+ *			were built from and must not outlive them.
+ * */
+template<typename E>
+class MatrixExpression
+{
+public:
+	/****************************************************************
+	 * @name	self
+	 * @brief	The expression as its own type
+	 * @param	none
+	 * @return	The expression
+	 * */
+	const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return self().rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return self().columns();
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the expression reads the elements of a matrix
+	 * @param	matrix - A matrix
+	 * @return	True when an operand is the matrix or a view of it
+	 * */
+	bool aliases(const Matrix& matrix) const
+	{
+		return self().aliases(matrix);
+	}
+};
+
+/********************************************************************
+ * @name	MatrixOperand
+ * @brief	How an expression keeps an operand: matrices by reference,
+ *			views and expressions, which only hold references and
+ *			shapes, by value
+ * */
+template<typename E>
+struct MatrixOperand
+{
+	typedef const E type;
+};
+
+template<>
+struct MatrixOperand<Matrix>
+{
+	typedef const Matrix& type;
+};
+
+/********************************************************************
+ * @name	MatrixCost
+ * @brief	Whether computing an element of an expression takes a
+ *			product, so that reading the element many times should be
+ *			avoided
+ * */
+template<typename E>
+struct MatrixCost
+{
+	static const bool product = false;
+};
+
 /********************************************************************
  * @name	Matrix
- * @brief	Used for matrix operations.
+ * @brief	Used for matrix operations. The elements are kept in one
+ *			contiguous row-major buffer. The operators and trans()
+ *			return expressions, evaluated without temporaries when
+ *			they are assigned to a matrix.
  * */
-class Matrix
+class Matrix : public MatrixExpression<Matrix>
 {
 //-------------------------------------------------------------------
 // Member Variables
 //-------------------------------------------------------------------
 private:
-	// Matrix columns
+	// Matrix rows
 	int row = 0;
 	// Matrix columns
 	int column = 0;
-	// Vectors used to store matrices
-	vector<vector<double>> mat;
+	// Row-major elements, row * column values
+	vector<double> mat;
 
 //-------------------------------------------------------------------
 // Member Function
 //-------------------------------------------------------------------
+private:
+	template<typename E>
+	void evaluate(const MatrixExpression<E>& expression);
+
 public:
 	Matrix(int row, int column);
-	Matrix(int row, int column, double* mat);
+	Matrix(int row, int column, const double* mat);
+	Matrix(const Matrix& matrix) = default;
+	Matrix(Matrix&& matrix) = default;
+	template<typename E>
+	Matrix(const MatrixExpression<E>& expression);
 	~Matrix();
-	void print();
-	double get(int row, int column);
+	Matrix& operator=(const Matrix& matrix) = default;
+	Matrix& operator=(Matrix&& matrix) = default;
+	template<typename E>
+	Matrix& operator=(const MatrixExpression<E>& expression);
+	void print() const;
+	int rows() const;
+	int columns() const;
+	double* data();
+	const double* data() const;
+	double get(int row, int column) const;
 	void set(int row, int column, double value);
-	Matrix operator+(const Matrix B);
-	Matrix operator-(const Matrix B);
-	Matrix operator*(const Matrix B);
-	Matrix operator*(const double B);
-	static Matrix cofactor(const Matrix matrix, const int row, const int column);
-	static Matrix trans(const Matrix matrix);
-	static Matrix inverse(const Matrix matrix);
-	static double det(const Matrix matrix);
+	double operator()(int row, int column) const;
+	bool aliases(const Matrix& matrix) const;
+	static Matrix cofactor(const Matrix& matrix, const int row, const int column);
+	template<typename E>
+	static MatrixTranspose<E> trans(const MatrixExpression<E>& matrix);
+	template<typename E>
+	static double scalar(const MatrixExpression<E>& expression);
+	template<typename X, typename M>
+	static double quadratic(const MatrixExpression<X>& x, const MatrixExpression<M>& A);
+	static Matrix inverse(const Matrix& matrix);
+	static double det(const Matrix& matrix);
+	static Matrix solve(const Matrix& A, const Matrix& B);
+	static void inverse(const double* A, double* inv_A, int n, double* work);
+	static double det(const double* A, int n, double* work);
+	static bool cholesky(const double* A, double* L, int n, double ridge = 0);
+	static double choleskyRegularised(const double* A, double* L, int n);
+	static void choleskySolve(const double* L, double* B, int n, int m);
+	static void choleskyInverse(const double* L, double* inv_A, int n, double* work);
+	static double choleskyLogDet(const double* L, int n);
+	static void eigenSymmetric(const double* A, double* values, double* vectors, int n, double* work);
+};
+
+/********************************************************************
+ * @name	MatrixView
+ * @brief	A row-major buffer owned elsewhere, read as a matrix, so
+ *			that arrays of a model or a query take part in
+ *			expressions without being copied into a Matrix
+ * */
+class MatrixView : public MatrixExpression<MatrixView>
+{
+private:
+	// Matrix rows
+	int row;
+	// Matrix columns
+	int column;
+	// Row-major elements, not owned
+	const double* mat;
+
+public:
+	/****************************************************************
+	 * @name	MatrixView
+	 * @brief	Constructor
+	 * @param	row - Matrix rows
+	 * @param	column - Matrix columns
+	 * @param	mat - Row-major elements, row * column values
+	 * */
+	MatrixView(int row, int column, const double* mat) : row(row), column(column), mat(mat)
+	{
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return row;
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return column;
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Compute one element of the result
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		return mat[(size_t)row * this->column + column];
+	}
+
+	bool aliases(const Matrix& matrix) const;
+};
+
+/********************************************************************
+ * @name	MatrixTranspose
+ * @brief	Transpose of an expression, read in place
+ * */
+template<typename E>
+class MatrixTranspose : public MatrixExpression<MatrixTranspose<E>>
+{
+private:
+	// The transposed expression
+	typename MatrixOperand<E>::type matrix;
+
+public:
+	/****************************************************************
+	 * @name	MatrixTranspose
+	 * @brief	Constructor
+	 * @param	matrix - Expression to transpose
+	 * */
+	explicit MatrixTranspose(const E& matrix) : matrix(matrix)
+	{
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return matrix.columns();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return matrix.rows();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Compute one element of the result
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		return matrix(column, row);
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the expression reads the elements of a matrix
+	 * @param	other - A matrix
+	 * @return	True when an operand is the matrix or a view of it
+	 * */
+	bool aliases(const Matrix& other) const
+	{
+		return matrix.aliases(other);
+	}
+};
+
+/********************************************************************
+ * @name	MatrixSum
+ * @brief	Element-wise sum (Sign 1) or difference (Sign -1) of two
+ *			expressions. Results below MATRIX_EPSILON are set to 0.
+ * */
+template<typename L, typename R, int Sign>
+class MatrixSum : public MatrixExpression<MatrixSum<L, R, Sign>>
+{
+private:
+	// Left operand
+	typename MatrixOperand<L>::type left;
+	// Right operand
+	typename MatrixOperand<R>::type right;
+
+public:
+	/****************************************************************
+	 * @name	MatrixSum
+	 * @brief	Constructor. Exits on operands of different shapes.
+	 * @param	left - Left operand
+	 * @param	right - Right operand
+	 * */
+	MatrixSum(const L& left, const R& right) : left(left), right(right)
+	{
+		if (left.rows() != right.rows() || left.columns() != right.columns())
+		{
+			cout << "Invalid matrix dimension!" << endl;
+			exit(0);
+		}
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return left.rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return left.columns();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Compute one element of the result
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		double value = left(row, column) + Sign * right(row, column);
+		return fabs(value) < MATRIX_EPSILON ? 0.0 : value;
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the expression reads the elements of a matrix
+	 * @param	matrix - A matrix
+	 * @return	True when an operand is the matrix or a view of it
+	 * */
+	bool aliases(const Matrix& matrix) const
+	{
+		return left.aliases(matrix) || right.aliases(matrix);
+	}
+};
+
+/********************************************************************
+ * @name	MatrixScaled
+ * @brief	An expression multiplied by a constant
+ * */
+template<typename E>
+class MatrixScaled : public MatrixExpression<MatrixScaled<E>>
+{
+private:
+	// The scaled expression
+	typename MatrixOperand<E>::type matrix;
+	// The constant
+	double factor;
+
+public:
+	/****************************************************************
+	 * @name	MatrixScaled
+	 * @brief	Constructor
+	 * @param	matrix - Expression to scale
+	 * @param	factor - The constant
+	 * */
+	MatrixScaled(const E& matrix, double factor) : matrix(matrix), factor(factor)
+	{
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return matrix.rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return matrix.columns();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Compute one element of the result
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		return factor * matrix(row, column);
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the expression reads the elements of a matrix
+	 * @param	other - A matrix
+	 * @return	True when an operand is the matrix or a view of it
+	 * */
+	bool aliases(const Matrix& other) const
+	{
+		return matrix.aliases(other);
+	}
+};
+
+/********************************************************************
+ * @name	MatrixFactor
+ * @brief	Operand of a product. Matrices, views and expressions
+ *			without a product are cheap to read, so they are always
+ *			read in place.
+ * */
+template<typename E, bool Product = MatrixCost<E>::product>
+class MatrixFactor
+{
+private:
+	// The operand
+	typename MatrixOperand<E>::type matrix;
+
+public:
+	/****************************************************************
+	 * @name	MatrixFactor
+	 * @brief	Constructor
+	 * @param	matrix - The operand
+	 * @param	reused - Whether the product reads each element of the
+	 *			operand more than once
+	 * */
+	MatrixFactor(const E& matrix, bool) : matrix(matrix)
+	{
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the operand
+	 * */
+	int rows() const
+	{
+		return matrix.rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the operand
+	 * */
+	int columns() const
+	{
+		return matrix.columns();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Read one element of the operand
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		return matrix(row, column);
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the operand reads the elements of a matrix
+	 * @param	other - A matrix
+	 * @return	True when the operand is the matrix or reads it
+	 * */
+	bool aliases(const Matrix& other) const
+	{
+		return matrix.aliases(other);
+	}
 };
 
+/********************************************************************
+ * @name	MatrixFactor
+ * @brief	Operand of a product that takes a product itself. It is
+ *			read in place when the product needs each of its elements
+ *			once, so x * (A * x^T) runs as a single fused loop, and
+ *			evaluated once by the constructor when its elements would
+ *			be recomputed for every row or column of the product.
+ *			The evaluated elements are taken from the Arena of the
+ *			thread, like the other scratch of the scoring path, and
+ *			released by the ArenaScope the expression is built under.
+ * */
+template<typename E>
+class MatrixFactor<E, true>
+{
+private:
+	// The operand
+	typename MatrixOperand<E>::type matrix;
+	// The evaluated operand, row-major, in the arena of the thread;
+	// null when the operand is read in place
+	const double* value = nullptr;
+
+public:
+	/****************************************************************
+	 * @name	MatrixFactor
+	 * @brief	Constructor
+	 * @param	matrix - The operand
+	 * @param	reused - Whether the product reads each element of the
+	 *			operand more than once
+	 * */
+	MatrixFactor(const E& matrix, bool reused) : matrix(matrix)
+	{
+		if (!reused)
+		{
+			return;
+		}
+		int n = matrix.columns();
+		double* elements = Arena::local().allocate<double>((size_t)matrix.rows() * n);
+		for (int i = 0; i < matrix.rows(); i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				elements[(size_t)i * n + j] = matrix(i, j);
+			}
+		}
+		value = elements;
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the operand
+	 * */
+	int rows() const
+	{
+		return matrix.rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the operand
+	 * */
+	int columns() const
+	{
+		return matrix.columns();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Read one element of the operand
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		if (value == nullptr)
+		{
+			return matrix(row, column);
+		}
+		return value[(size_t)row * matrix.columns() + column];
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the operand reads the elements of a matrix
+	 * @param	other - A matrix
+	 * @return	True when the operand is the matrix or reads it
+	 * */
+	bool aliases(const Matrix& other) const
+	{
+		return matrix.aliases(other);
+	}
+};
+
+/********************************************************************
+ * @name	MatrixProduct
+ * @brief	Matrix product of two expressions. Each element is one dot
+ *			product of a row of the left operand and a column of the
+ *			right one; results below MATRIX_EPSILON are set to 0.
+ * */
+template<typename L, typename R>
+class MatrixProduct : public MatrixExpression<MatrixProduct<L, R>>
+{
+private:
+	// Left operand
+	MatrixFactor<L> left;
+	// Right operand
+	MatrixFactor<R> right;
+
+public:
+	/****************************************************************
+	 * @name	MatrixProduct
+	 * @brief	Constructor. Exits when the columns of the left operand
+	 *			do not match the rows of the right one.
+	 * @param	left - Left operand
+	 * @param	right - Right operand
+	 * */
+	MatrixProduct(const L& left, const R& right) : left(left, right.columns() > 1),
+		right(right, left.rows() > 1)
+	{
+		if (left.columns() != right.rows())
+		{
+			cout << "Invalid matrix dimension!" << endl;
+			exit(0);
+		}
+	}
+
+	/****************************************************************
+	 * @name	rows
+	 * @brief	Gets the number of rows.
+	 * @param	none
+	 * @return	Rows of the result
+	 * */
+	int rows() const
+	{
+		return left.rows();
+	}
+
+	/****************************************************************
+	 * @name	columns
+	 * @brief	Gets the number of columns.
+	 * @param	none
+	 * @return	Columns of the result
+	 * */
+	int columns() const
+	{
+		return right.columns();
+	}
+
+	/****************************************************************
+	 * @name	operator()
+	 * @brief	Compute one element of the result
+	 * @param	row - Row of the element
+	 * @param	column - Column of the element
+	 * @return	The element
+	 * */
+	double operator()(int row, int column) const
+	{
+		double sum = 0;
+		int n = left.columns();
+		for (int k = 0; k < n; k++)
+		{
+			sum += left(row, k) * right(k, column);
+		}
+		return fabs(sum) < MATRIX_EPSILON ? 0.0 : sum;
+	}
+
+	/****************************************************************
+	 * @name	aliases
+	 * @brief	Whether the expression reads the elements of a matrix
+	 * @param	matrix - A matrix
+	 * @return	True when an operand is the matrix or a view of it
+	 * */
+	bool aliases(const Matrix& matrix) const
+	{
+		return left.aliases(matrix) || right.aliases(matrix);
+	}
+};
+
+template<typename L, typename R>
+struct MatrixCost<MatrixProduct<L, R>>
+{
+	static const bool product = true;
+};
+
+template<typename E>
+struct MatrixCost<MatrixTranspose<E>>
+{
+	static const bool product = MatrixCost<E>::product;
+};
+
+template<typename E>
+struct MatrixCost<MatrixScaled<E>>
+{
+	static const bool product = MatrixCost<E>::product;
+};
+
+template<typename L, typename R, int Sign>
+struct MatrixCost<MatrixSum<L, R, Sign>>
+{
+	static const bool product = MatrixCost<L>::product || MatrixCost<R>::product;
+};
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	Matrix
+ * @brief	Constructor. Evaluate an expression.
+ * @param	expression - Expression to evaluate
+ * */
+template<typename E>
+Matrix::Matrix(const MatrixExpression<E>& expression) : row(expression.rows()), column(expression.columns()),
+	mat((size_t)row * column)
+{
+	evaluate(expression);
+}
+
+
+/********************************************************************
+ * @name	operator=
+ * @brief	Evaluate an expression into the matrix. The elements are
+ *			written in place unless the expression reads them.
+ * @param	expression - Expression to evaluate
+ * @return	The matrix
+ * */
+template<typename E>
+Matrix& Matrix::operator=(const MatrixExpression<E>& expression)
+{
+	if (expression.aliases(*this))
+	{
+		Matrix result(expression);
+		row = result.row;
+		column = result.column;
+		mat.swap(result.mat);
+		return *this;
+	}
+	row = expression.rows();
+	column = expression.columns();
+	mat.resize((size_t)row * column);
+	evaluate(expression);
+	return *this;
+}
+
+
+/********************************************************************
+ * @name	evaluate
+ * @brief	Compute every element of an expression of the same shape
+ * @param	expression - Expression to evaluate
+ * @return	none
+ * */
+template<typename E>
+void Matrix::evaluate(const MatrixExpression<E>& expression)
+{
+	const E& e = expression.self();
+	for (int i = 0; i < row; i++)
+	{
+		for (int j = 0; j < column; j++)
+		{
+			mat[(size_t)i * column + j] = e(i, j);
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	operator()
+ * @brief	Gets the value of a location without checking it
+ * @param	row - Matrix rows
+ * @param	column - Matrix columns
+ * @return	The value in the position
+ * */
+inline double Matrix::operator()(int row, int column) const
+{
+	return mat[(size_t)row * this->column + column];
+}
+
+
+/********************************************************************
+ * @name	aliases
+ * @brief	Whether the matrix is another one
+ * @param	matrix - A matrix
+ * @return	True for the same matrix
+ * */
+inline bool Matrix::aliases(const Matrix& matrix) const
+{
+	return this == &matrix;
+}
+
+
+/********************************************************************
+ * @name	aliases
+ * @brief	Whether the view reads the elements of a matrix
+ * @param	matrix - A matrix
+ * @return	True when the view starts inside the matrix
+ * */
+inline bool MatrixView::aliases(const Matrix& matrix) const
+{
+	const double* first = matrix.data();
+	return mat >= first && mat < first + (size_t)matrix.rows() * matrix.columns();
+}
+
+
+/********************************************************************
+ * @name	trans
+ * @brief	Transpose of a matrix or an expression, without copying
+ * @param	matrix - A matrix
+ * @return	Transpose of the matrix
+ * */
+template<typename E>
+MatrixTranspose<E> Matrix::trans(const MatrixExpression<E>& matrix)
+{
+	return MatrixTranspose<E>(matrix.self());
+}
+
+
+/********************************************************************
+ * @name	scalar
+ * @brief	Compute the value of a 1 x 1 expression, without
+ *			evaluating it into a matrix
+ * @param	expression - A 1 x 1 expression
+ * @return	Its only element
+ * */
+template<typename E>
+double Matrix::scalar(const MatrixExpression<E>& expression)
+{
+	if (expression.rows() != 1 || expression.columns() != 1)
+	{
+		cout << "Invalid matrix dimension!" << endl;
+		exit(0);
+	}
+	return expression.self()(0, 0);
+}
+
+
+/********************************************************************
+ * @name	quadratic
+ * @brief	Compute the quadratic form x A x^T in one fused loop that
+ *			reads A row by row and allocates nothing
+ * @param	x - A row vector, or a column vector for x^T A x
+ * @param	A - A square matrix of the length of x
+ * @return	The quadratic form
+ * */
+template<typename X, typename M>
+double Matrix::quadratic(const MatrixExpression<X>& x, const MatrixExpression<M>& A)
+{
+	int n = x.rows() * x.columns();
+	if ((x.rows() != 1 && x.columns() != 1) || A.rows() != n || A.columns() != n)
+	{
+		cout << "Invalid matrix dimension!" << endl;
+		exit(0);
+	}
+	const X& v = x.self();
+	const M& a = A.self();
+	bool row = x.rows() == 1;
+	double sum = 0;
+	for (int i = 0; i < n; i++)
+	{
+		double dot = 0;
+		for (int j = 0; j < n; j++)
+		{
+			dot += a(i, j) * (row ? v(0, j) : v(j, 0));
+		}
+		sum += (row ? v(0, i) : v(i, 0)) * dot;
+	}
+	return sum;
+}
+
+
+//-------------------------------------------------------------------
+// Global Function
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	operator+
+ * @brief	Matrix addition
+ * @param	A - A matrix or an expression
+ * @param	B - Another matrix or expression
+ * @return	Expression of the sum
+ * */
+template<typename L, typename R>
+MatrixSum<L, R, 1> operator+(const MatrixExpression<L>& A, const MatrixExpression<R>& B)
+{
+	return MatrixSum<L, R, 1>(A.self(), B.self());
+}
+
+
+/********************************************************************
+ * @name	operator-
+ * @brief	Matrix minus
+ * @param	A - A matrix or an expression
+ * @param	B - Another matrix or expression
+ * @return	Expression of the difference
+ * */
+template<typename L, typename R>
+MatrixSum<L, R, -1> operator-(const MatrixExpression<L>& A, const MatrixExpression<R>& B)
+{
+	return MatrixSum<L, R, -1>(A.self(), B.self());
+}
+
+
+/********************************************************************
+ * @name	operator*
+ * @brief	Matrix multiplication
+ * @param	A - A matrix or an expression
+ * @param	B - Another matrix or expression
+ * @return	Expression of the product
+ * */
+template<typename L, typename R>
+MatrixProduct<L, R> operator*(const MatrixExpression<L>& A, const MatrixExpression<R>& B)
+{
+	return MatrixProduct<L, R>(A.self(), B.self());
+}
+
+
+/********************************************************************
+ * @name	operator*
+ * @brief	Matrix multiplication with a constant
+ * @param	A - A matrix or an expression
+ * @param	B - A constant
+ * @return	Expression of the scaled matrix
+ * */
+template<typename E>
+MatrixScaled<E> operator*(const MatrixExpression<E>& A, double B)
+{
+	return MatrixScaled<E>(A.self(), B);
+}
+
+
+/********************************************************************
+ * @name	operator*
+ * @brief	Matrix multiplication with a constant
+ * @param	A - A constant
+ * @param	B - A matrix or an expression
+ * @return	Expression of the scaled matrix
+ * */
+template<typename E>
+MatrixScaled<E> operator*(double A, const MatrixExpression<E>& B)
+{
+	return MatrixScaled<E>(B.self(), A);
+}
+
 #endif
\ No newline at end of file
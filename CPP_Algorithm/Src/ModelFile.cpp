@@ -0,0 +1,351 @@
+/********************************************************************
+ * @File name:		ModelFile.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-4
+ * @Description:	Versioned binary model file
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ModelFile.h"
+#include "ModifiedQDF.h"
+#include "ParzenWindow.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+bool littleEndianHost();
+uint64_t alignOffset(uint64_t offset);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	ModelWriter
+ * @brief	The constructor. The model type is set by setModel().
+ * */
+ModelWriter::ModelWriter()
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MODEL_FILE_MAGIC, 8);
+	header.version = MODEL_FILE_VERSION;
+}
+
+
+/********************************************************************
+ * @name	setModel
+ * @brief	Set the type and the shape of the model
+ * @param	type - MODEL_PARZEN or MODEL_MQDF
+ * @param	dimension - Number of features
+ * @param	classNumber - Number of classes
+ * @return	none
+ * */
+void ModelWriter::setModel(uint32_t type, int dimension, int classNumber)
+{
+	header.type = type;
+	header.dimension = dimension;
+	header.classNumber = classNumber;
+}
+
+
+/********************************************************************
+ * @name	add
+ * @brief	Add a section. The bytes are copied.
+ * @param	id - Section id, unique in the file
+ * @param	data - First byte of the section
+ * @param	bytes - Length of the section
+ * @return	none
+ * */
+void ModelWriter::add(uint32_t id, const void* data, size_t bytes)
+{
+	ids.push_back(id);
+	sections.push_back(vector<char>((const char*)data, (const char*)data + bytes));
+}
+
+
+/********************************************************************
+ * @name	addClasses
+ * @brief	Add the class names of a data set
+ * @param	dataset - Data set the model was trained on
+ * @return	none
+ * */
+void ModelWriter::addClasses(const Dataset& dataset)
+{
+	vector<char> names;
+	for (int k = 1; k <= dataset.classNumber(); k++)
+	{
+		string name = dataset.className(k);
+		uint32_t length = (uint32_t)name.size();
+		names.insert(names.end(), (const char*)&length, (const char*)&length + sizeof(length));
+		names.insert(names.end(), name.begin(), name.end());
+	}
+	add(MODEL_SECTION_CLASSES, names);
+}
+
+
+/********************************************************************
+ * @name	write
+ * @brief	Write the header, the section table and the sections
+ * @param	filename - Name and path of the file
+ * @return	Whether the file was written
+ * */
+bool ModelWriter::write(const string& filename) const
+{
+	if (!littleEndianHost())
+	{
+		cout << "Model files can only be written on little-endian hosts!\n";
+		return false;
+	}
+	ModelFileHeader head = header;
+	head.sectionNumber = (uint32_t)sections.size();
+	vector<ModelSection> table(sections.size());
+	uint64_t offset = sizeof(head) + table.size() * sizeof(ModelSection);
+	for (size_t s = 0; s < sections.size(); s++)
+	{
+		offset = alignOffset(offset);
+		table[s].id = ids[s];
+		table[s].reserved = 0;
+		table[s].offset = offset;
+		table[s].size = sections[s].size();
+		offset += sections[s].size();
+	}
+
+	ofstream out(filename, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cout << "File opening failure!\n";
+		return false;
+	}
+	out.write((const char*)&head, sizeof(head));
+	out.write((const char*)table.data(), table.size() * sizeof(ModelSection));
+	uint64_t written = sizeof(head) + table.size() * sizeof(ModelSection);
+	const char padding[FEATURE_ALIGNMENT] = { 0 };
+	for (size_t s = 0; s < sections.size(); s++)
+	{
+		out.write(padding, table[s].offset - written);
+		out.write(sections[s].data(), sections[s].size());
+		written = table[s].offset + table[s].size;
+	}
+	out.close();
+	if (!out)
+	{
+		cout << "Unable to write the model file!\n";
+		return false;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	ModelFile
+ * @brief	The constructor. Nothing is mapped until open().
+ * */
+ModelFile::ModelFile()
+{
+	memset(&header, 0, sizeof(header));
+}
+
+
+/********************************************************************
+ * @name	open
+ * @brief	Map a model file and check that its header and sections
+ *			fit in the file. The contents of the sections are checked
+ *			by the models.
+ * @param	filename - Name and path of the file
+ * @return	Whether the file is a valid model file
+ * */
+bool ModelFile::open(const string& filename)
+{
+	table = nullptr;
+	if (!file.open(filename))
+	{
+		cout << "File opening failure!\n";
+		return false;
+	}
+	const char* data = file.data();
+	uint64_t size = file.size();
+	if (size < sizeof(header) || memcmp(data, MODEL_FILE_MAGIC, 8) != 0 || !littleEndianHost())
+	{
+		cout << "Not a model file: " << filename << "\n";
+		file.close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	bool valid = header.version == MODEL_FILE_VERSION
+		&& (header.type == MODEL_PARZEN || header.type == MODEL_MQDF)
+		&& header.sectionNumber <= (size - sizeof(header)) / sizeof(ModelSection);
+	if (valid)
+	{
+		table = (const ModelSection*)(data + sizeof(header));
+		for (uint32_t s = 0; s < header.sectionNumber && valid; s++)
+		{
+			valid = table[s].offset % FEATURE_ALIGNMENT == 0 && table[s].offset <= size
+				&& table[s].size <= size - table[s].offset;
+		}
+	}
+	if (!valid)
+	{
+		cout << "Corrupted model file: " << filename << "\n";
+		table = nullptr;
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	type
+ * @brief	Type of the model
+ * @param	none
+ * @return	MODEL_PARZEN or MODEL_MQDF
+ * */
+uint32_t ModelFile::type() const
+{
+	return header.type;
+}
+
+
+/********************************************************************
+ * @name	dimension
+ * @brief	Number of features
+ * @param	none
+ * @return	Number of features
+ * */
+int ModelFile::dimension() const
+{
+	return (int)header.dimension;
+}
+
+
+/********************************************************************
+ * @name	classNumber
+ * @brief	Number of classes
+ * @param	none
+ * @return	Number of classes
+ * */
+int ModelFile::classNumber() const
+{
+	return (int)header.classNumber;
+}
+
+
+/********************************************************************
+ * @name	section
+ * @brief	Find a section
+ * @param	id - Section id
+ * @param	bytes - Receives the length of the section
+ * @return	First byte of the section inside the mapping, nullptr
+ *			when the file has no such section
+ * */
+const char* ModelFile::section(uint32_t id, size_t* bytes) const
+{
+	for (uint32_t s = 0; table != nullptr && s < header.sectionNumber; s++)
+	{
+		if (table[s].id == id)
+		{
+			*bytes = table[s].size;
+			return file.data() + table[s].offset;
+		}
+	}
+	return nullptr;
+}
+
+
+/********************************************************************
+ * @name	classes
+ * @brief	An empty data set with the dimension and the class names
+ *			of the model, to parse and name the samples it classifies.
+ *			Classes without a stored name are named by their label.
+ * @param	none
+ * @return	The data set, to be deleted by the caller
+ * */
+Dataset* ModelFile::classes() const
+{
+	Dataset* names = new Dataset(dimension());
+	size_t size = 0;
+	const char* data = section(MODEL_SECTION_CLASSES, &size);
+	size_t offset = 0;
+	while (data != nullptr && size - offset >= sizeof(uint32_t))
+	{
+		uint32_t length;
+		memcpy(&length, data + offset, sizeof(length));
+		offset += sizeof(length);
+		if (size - offset < length)
+		{
+			break;
+		}
+		names->addClass(string(data + offset, length));
+		offset += length;
+	}
+	while (names->classNumber() < classNumber())
+	{
+		names->addClass(to_string(names->classNumber() + 1));
+	}
+	return names;
+}
+
+
+/********************************************************************
+ * @name	isModelFile
+ * @brief	Whether a file starts with the model file magic
+ * @param	filename - Name and path of the file
+ * @return	True for a model file
+ * */
+bool ModelFile::isModelFile(const string& filename)
+{
+	char magic[8] = { 0 };
+	ifstream in(filename, ios::in | ios::binary);
+	return in.read(magic, sizeof(magic)) && memcmp(magic, MODEL_FILE_MAGIC, 8) == 0;
+}
+
+
+/********************************************************************
+ * @name	loadModel
+ * @brief	Map a model file and create the model it holds. The model
+ *			serves queries from the mapping, which stays open as long
+ *			as the model or a clone of it uses it.
+ * @param	filename - Name and path of the file
+ * @param	classes - Receives the dimension and the class names of
+ *			the model when not nullptr
+ * @return	The model, nullptr when the file cannot be loaded
+ * */
+Algorithm* loadModel(const string& filename, Dataset* classes)
+{
+	shared_ptr<ModelFile> file = make_shared<ModelFile>();
+	if (!file->open(filename))
+	{
+		return nullptr;
+	}
+	Algorithm* model;
+	if (file->type() == MODEL_PARZEN)
+	{
+		model = new ParzenWindow(nullptr);
+	}
+	else
+	{
+		model = new ModifiedQDF(nullptr);
+	}
+	if (!model->load(file))
+	{
+		cout << "Corrupted model file: " << filename << "\n";
+		delete model;
+		return nullptr;
+	}
+	if (classes != nullptr)
+	{
+		Dataset* names = file->classes();
+		classes->copyClasses(*names);
+		delete names;
+	}
+	return model;
+}
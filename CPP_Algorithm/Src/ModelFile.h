@@ -0,0 +1,200 @@
+/********************************************************************
+ * @File name:		ModelFile.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-4
+ * @Description:	Declare the versioned binary model file
+ ********************************************************************/
+
+#pragma once
+
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Dataset.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// First bytes of every model file
+#define MODEL_FILE_MAGIC "PZMODEL\n"
+// Current layout version
+#define MODEL_FILE_VERSION 1
+// Model types
+#define MODEL_PARZEN 1
+#define MODEL_MQDF 2
+// Section of the class names, classNumber entries of a uint32 length
+// and the name bytes. Models number their own sections from 16.
+#define MODEL_SECTION_CLASSES 1
+
+/********************************************************************
+ * @name	ModelFileHeader
+ * @brief	First 32 bytes of a model file. All values are little
+ *			endian. The header is followed by the section table of
+ *			sectionNumber ModelSection entries; the sections start on
+ *			FEATURE_ALIGNMENT boundaries, so arrays of doubles
+ *			can be used in place and with aligned SIMD loads.
+ * */
+typedef struct
+{
+	// MODEL_FILE_MAGIC
+	char magic[8];
+	// MODEL_FILE_VERSION
+	uint32_t version;
+	// MODEL_PARZEN or MODEL_MQDF
+	uint32_t type;
+	// Number of features D
+	uint32_t dimension;
+	// Number of classes K
+	uint32_t classNumber;
+	// Number of entries of the section table
+	uint32_t sectionNumber;
+	// Reserved, 0
+	uint32_t reserved;
+}ModelFileHeader;
+
+/********************************************************************
+ * @name	ModelSection
+ * @brief	Entry of the section table
+ * */
+typedef struct
+{
+	// Section id, unique in the file
+	uint32_t id;
+	// Reserved, 0
+	uint32_t reserved;
+	// Byte offset of the section
+	uint64_t offset;
+	// Length of the section in bytes
+	uint64_t size;
+}ModelSection;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	ModelWriter
+ * @brief	Collects the sections of a model and writes the file
+ * */
+class ModelWriter
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Header, the section number is filled in by write()
+	ModelFileHeader header;
+	// Id of each section
+	vector<uint32_t> ids;
+	// Bytes of each section
+	vector<vector<char>> sections;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	ModelWriter();
+	void setModel(uint32_t type, int dimension, int classNumber);
+	void add(uint32_t id, const void* data, size_t bytes);
+	void addClasses(const Dataset& dataset);
+
+	/****************************************************************
+	 * @name	add
+	 * @brief	Add an array as a section
+	 * @param	id - Section id
+	 * @param	values - Elements of the section
+	 * @return	none
+	 * */
+	template<typename T, typename A>
+	void add(uint32_t id, const vector<T, A>& values)
+	{
+		add(id, values.data(), values.size() * sizeof(T));
+	}
+
+	bool write(const string& filename) const;
+};
+
+/********************************************************************
+ * @name	ModelFile
+ * @brief	Model file mapped read-only. open() checks the header and
+ *			the section table; the models then read their arrays
+ *			straight from the mapping, so loading costs no parsing
+ *			or copying and the pages are shared by every process
+ *			serving the same file.
+ * */
+class ModelFile
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// The mapped file
+	MappedFile file;
+	// Header of the mapped file
+	ModelFileHeader header;
+	// Section table inside the mapping
+	const ModelSection* table = nullptr;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+public:
+	ModelFile();
+	bool open(const string& filename);
+	uint32_t type() const;
+	int dimension() const;
+	int classNumber() const;
+	const char* section(uint32_t id, size_t* bytes) const;
+	Dataset* classes() const;
+
+	/****************************************************************
+	 * @name	array
+	 * @brief	A section read as an array
+	 * @param	id - Section id
+	 * @param	count - Number of elements the section must hold
+	 * @return	First element inside the mapping, nullptr when the
+	 *			section is missing or has another size
+	 * */
+	template<typename T>
+	const T* array(uint32_t id, size_t count) const
+	{
+		size_t bytes = 0;
+		const char* data = section(id, &bytes);
+		if (data == nullptr || bytes % sizeof(T) != 0 || bytes / sizeof(T) != count)
+		{
+			return nullptr;
+		}
+		return (const T*)data;
+	}
+
+	static bool isModelFile(const string& filename);
+};
+
+
+//-------------------------------------------------------------------
+// Global Function
+//-------------------------------------------------------------------
+class Algorithm;
+Algorithm* loadModel(const string& filename, Dataset* classes = nullptr);
+
+#endif
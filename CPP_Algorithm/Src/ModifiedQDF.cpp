@@ -10,94 +10,721 @@
 // Includes
 //-------------------------------------------------------------------
 #include "ModifiedQDF.h"
+#include "Arena.h"
+#include "FixedMatrix.h"
+#include "ModelFile.h"
 
-#include<cmath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Sections of a saved model
+enum
+{
+	MQDF_SECTION_PARAMETERS = 16,
+	MQDF_SECTION_NUMBER,
+	MQDF_SECTION_UPDATES,
+	MQDF_SECTION_LOG_DET,
+	MQDF_SECTION_DELTA,
+	MQDF_SECTION_MEAN,
+	MQDF_SECTION_SCATTER,
+	MQDF_SECTION_PRECISION,
+	MQDF_SECTION_AXES,
+	MQDF_SECTION_AXIS_VALUES
+};
+
+/********************************************************************
+ * @name	MqdfParameters
+ * @brief	Scalars of a saved model
+ * */
+typedef struct
+{
+	// Number of principal axes, 0 for the full covariance
+	int32_t principalAxes;
+	// Reserved, 0
+	int32_t reserved;
+	// Minor eigenvalue setting
+	double delta;
+}MqdfParameters;
+
+// Largest number of features whose distances are taken on FixedMatrix
+// copies of the sample on the stack, with the loops unrolled
+const int MQDF_FIXED_DIMENSION = 8;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+template<int D>
+static double fixedDistance(const double* x, const double* mean, const double* precision);
+static double fullDistance(int d, const double* x, const double* mean, const double* precision, double* diff);
 
 
 //-------------------------------------------------------------------
 // Function implementation
 //-------------------------------------------------------------------
 
+/********************************************************************
+ * @name	fixedDistance
+ * @brief	Mahalanobis distance for D features known at compile time.
+ *			Sums in the order of Matrix::quadratic(), so the result is
+ *			the same as on the general path.
+ * @param	x - Features of the data to test
+ * @param	mean - Mean of the class
+ * @param	precision - Row-major D x D inverse covariance
+ * @return	Distance of x to the class mean
+ * */
+template<int D>
+static double fixedDistance(const double* x, const double* mean, const double* precision)
+{
+	FixedMatrix<1, D> diff;
+	for (int j = 0; j < D; j++)
+	{
+		diff.set(0, j, x[j] - mean[j]);
+	}
+	return Matrix::quadratic(diff, MatrixView(D, D, precision));
+}
+
+
+/********************************************************************
+ * @name	fullDistance
+ * @brief	Mahalanobis distance under the full covariance, on the
+ *			stack for up to MQDF_FIXED_DIMENSION features
+ * @param	d - Number of features
+ * @param	x - Features of the data to test
+ * @param	mean - Mean of the class
+ * @param	precision - Row-major d x d inverse covariance
+ * @param	diff - Scratch of d values for longer feature vectors
+ * @return	Distance of x to the class mean
+ * */
+static double fullDistance(int d, const double* x, const double* mean, const double* precision, double* diff)
+{
+	switch (d)
+	{
+	case 1: return fixedDistance<1>(x, mean, precision);
+	case 2: return fixedDistance<2>(x, mean, precision);
+	case 3: return fixedDistance<3>(x, mean, precision);
+	case 4: return fixedDistance<4>(x, mean, precision);
+	case 5: return fixedDistance<5>(x, mean, precision);
+	case 6: return fixedDistance<6>(x, mean, precision);
+	case 7: return fixedDistance<7>(x, mean, precision);
+	case MQDF_FIXED_DIMENSION: return fixedDistance<MQDF_FIXED_DIMENSION>(x, mean, precision);
+	default:
+		break;
+	}
+	for (int j = 0; j < d; j++)
+	{
+		diff[j] = x[j] - mean[j];
+	}
+	return Matrix::quadratic(MatrixView(1, d, diff), MatrixView(d, d, precision));
+}
+
+
 /********************************************************************
  * @name	ModifiedQDF
  * @brief	The constructor
  * @param	dataset - Input data set
  * */
-ModifiedQDF::ModifiedQDF(vector<DataStruct>* dataset) :Algorithm(dataset)
+ModifiedQDF::ModifiedQDF(Dataset* dataset) :Algorithm(dataset)
+{
+}
+
+
+/********************************************************************
+ * @name	clone
+ * @brief	Create an independent copy for training another fold
+ * @param	none
+ * @return	Pointer of the copy
+ * */
+Algorithm* ModifiedQDF::clone() const
 {
+	return new ModifiedQDF(*this);
+}
+
+
+/********************************************************************
+ * @name	setTruncation
+ * @brief	Select the MQDF mode. A trained or loaded model switches
+ *			at once: the precision or the principal axes of every
+ *			class are derived again from its scatter matrix.
+ * @param	k - Number of principal axes to keep, 0 (or >= d) to use
+ *			the full covariance
+ * @param	delta - Constant for the minor eigenvalues, 0 to use the
+ *			average of the discarded eigenvalues of each class
+ * @return	none
+ * */
+void ModifiedQDF::setTruncation(int k, double delta)
+{
+	// The mapped statistics are laid out for the current mode
+	detachModel();
+	this->principalAxes = k;
+	this->delta = delta;
+	for (int i = 0; i < classNumber; i++)
+	{
+		refresh(i);
+	}
 }
 
 
 /********************************************************************
  * @name	train
- * @brief	Training the dataset using MQDF
+ * @brief	Training the dataset using MQDF. Starts from an empty model
+ *			and fits the current training section in one batch.
  * @param	none
  * @return	none
  * */
 void ModifiedQDF::train()
 {
-	// Calculate the mean
-	Matrix sum[3] = { Matrix(1,4), Matrix(1,4), Matrix(1,4) };
-	for (const DataStruct data : datasetSplit[currentTrainDataset])
+	const Dataset& trainSet = datasetSplit[currentTrainDataset];
+	reset(trainSet.dimension());
+	addClasses(trainSet.classNumber());
+	partialFit(trainSet);
+	printDone("Train");
+}
+
+
+/********************************************************************
+ * @name	partialFit
+ * @brief	Fold labelled samples into the model. For every class the
+ *			samples of the batch are summarised with Welford's method
+ *			and merged into the class statistics with Chan's
+ *			formula, after which the precision is recomputed in
+ *			O(d^3). When the class already has a precision and gets
+ *			fewer than d new samples, each sample is applied instead
+ *			as a rank-one update in O(d^2): Sherman-Morrison for the
+ *			precision and the matrix determinant lemma for the
+ *			log-determinant. Samples of unknown class are ignored.
+ * @param	samples - New samples, labelled like the training data set
+ * @return	none
+ * */
+void ModifiedQDF::partialFit(const Dataset& samples)
+{
+	if (dimension == 0)
+	{
+		dimension = samples.dimension();
+	}
+	if (samples.dimension() != dimension)
+	{
+		throw invalid_argument("ModifiedQDF::partialFit");
+	}
+	detachModel();
+	int d = dimension;
+	// New samples of each class
+	int maxLabel = samples.classNumber();
+	for (size_t j = 0; j < samples.size(); j++)
+	{
+		if (samples.label(j) > maxLabel)
+		{
+			maxLabel = samples.label(j);
+		}
+	}
+	addClasses(maxLabel);
+	vector<size_t> count(classNumber, 0);
+	for (size_t j = 0; j < samples.size(); j++)
 	{
-		for (int i = 0; i < 4; i++)
+		if (samples.label(j) != CLASS_UNKNOWN)
 		{
-			double current = sum[data.classIndex - 1].get(0, i);
-			sum[data.classIndex - 1].set(0, i, current + data.data[0]);
+			count[samples.label(j) - 1]++;
 		}
-		number[data.classIndex - 1]++;
 	}
-	for (int i = 0; i < 3; i++)
+	// Rank-one updates pay off while they cost less than one refactoring
+	vector<char> incremental(classNumber, 0);
+	for (int i = 0; i < classNumber; i++)
+	{
+		incremental[i] = !truncated() && number[i] > (size_t)d && count[i] > 0 && count[i] < (size_t)d;
+	}
+	// Batch statistics of the other classes
+	vector<size_t> batchNumber(classNumber, 0);
+	vector<Matrix> batchMean(classNumber, Matrix(0, 0));
+	vector<Matrix> batchScatter(classNumber, Matrix(0, 0));
+	for (int i = 0; i < classNumber; i++)
 	{
-		for (int j = 0; j < 4; j++)
+		if (count[i] > 0 && !incremental[i])
 		{
-			mean[i].set(0, j, sum[i].get(0, j) / number[i]);
+			batchMean[i] = Matrix(1, d);
+			batchScatter[i] = Matrix(d, d);
 		}
 	}
-	// Calculate the covariance matrix
-	for (int i = 0; i < 3; i++)
+	vector<double> diff(d);
+	vector<double> work(2 * d);
+	for (size_t j = 0; j < samples.size(); j++)
 	{
-		for (int j = 0; j < 4; j++)
+		int c = samples.label(j) - 1;
+		if (c < 0)
+		{
+			continue;
+		}
+		const double* x = samples.row(j);
+		if (incremental[c])
+		{
+			rankOneUpdate(c, x, work.data());
+			continue;
+		}
+		// Welford: scatter += (x - old mean)(x - new mean)^T
+		size_t n = ++batchNumber[c];
+		double* m = batchMean[c].data();
+		for (int l = 0; l < d; l++)
 		{
-			for (int k = 0; k < 4; k++)
+			diff[l] = x[l] - m[l];
+			m[l] += diff[l] / n;
+		}
+		double* S = batchScatter[c].data();
+		for (int l = 0; l < d; l++)
+		{
+			double scale = diff[l] * (n - 1) / n;
+			for (int r = l; r < d; r++)
 			{
-				cov[i].set(j, k, calculateCov(i + 1, j, k));
+				S[l * d + r] += scale * diff[r];
 			}
 		}
 	}
-	cout << "Done: Train." << endl;
+	for (int i = 0; i < classNumber; i++)
+	{
+		if (batchNumber[i] == 0)
+		{
+			if (incremental[i] && rankOneUpdates[i] >= MQDF_REFRESH_INTERVAL)
+			{
+				refresh(i);
+			}
+			continue;
+		}
+		// Chan: merge the batch into the class statistics
+		size_t nA = number[i];
+		size_t nB = batchNumber[i];
+		size_t n = nA + nB;
+		double* m = mean[i].data();
+		const double* mB = batchMean[i].data();
+		for (int l = 0; l < d; l++)
+		{
+			diff[l] = mB[l] - m[l];
+			m[l] += diff[l] * nB / n;
+		}
+		double* S = scatter[i].data();
+		const double* SB = batchScatter[i].data();
+		double weight = (double)nA * nB / n;
+		for (int l = 0; l < d; l++)
+		{
+			for (int r = l; r < d; r++)
+			{
+				S[l * d + r] += SB[l * d + r] + weight * diff[l] * diff[r];
+				S[r * d + l] = S[l * d + r];
+			}
+		}
+		number[i] = n;
+		refresh(i);
+	}
 }
 
 
 /********************************************************************
- * @name	testSingle
- * @brief	Test one data in the data set
- * @param	testData - Data to test
- * @return	Result of predict
+ * @name	reset
+ * @brief	Discard every class
+ * @param	dimension - Number of features
+ * @return	none
+ * */
+void ModifiedQDF::reset(int dimension)
+{
+	this->dimension = dimension;
+	classNumber = 0;
+	number.clear();
+	mean.clear();
+	scatter.clear();
+	precision.clear();
+	rankOneUpdates.clear();
+	logDet.clear();
+	classDelta.clear();
+	eigenVectors.clear();
+	eigenValues.clear();
+	mappedMean = nullptr;
+	mappedScatter = nullptr;
+	mappedPrecision = nullptr;
+	mappedAxes = nullptr;
+	mappedAxisValues = nullptr;
+	modelFile.reset();
+}
+
+
+/********************************************************************
+ * @name	addClasses
+ * @brief	Grow the per-class statistics to a number of classes. New
+ *			classes start without samples.
+ * @param	classNumber - Number of classes wanted
+ * @return	none
+ * */
+void ModifiedQDF::addClasses(int classNumber)
+{
+	int d = dimension;
+	while (this->classNumber < classNumber)
+	{
+		number.push_back(0);
+		mean.push_back(Matrix(1, d));
+		scatter.push_back(Matrix(d, d));
+		precision.push_back(Matrix(d, d));
+		rankOneUpdates.push_back(0);
+		logDet.push_back(0);
+		classDelta.push_back(0);
+		eigenVectors.push_back(Matrix(0, d));
+		eigenValues.push_back(vector<double>());
+		this->classNumber++;
+	}
+}
+
+
+/********************************************************************
+ * @name	refresh
+ * @brief	Recompute the cached precision and log-determinant, or the
+ *			principal axes, of one class from its scatter matrix
+ * @param	indexClass - Class index starting from 0
+ * @return	none
+ * */
+void ModifiedQDF::refresh(int indexClass)
+{
+	int d = dimension;
+	rankOneUpdates[indexClass] = 0;
+	if (number[indexClass] < 2)
+	{
+		return;
+	}
+	vector<double> covariance(d * d);
+	const double* S = scatter[indexClass].data();
+	for (int j = 0; j < d * d; j++)
+	{
+		covariance[j] = S[j] / (number[indexClass] - 1);
+	}
+	if (truncated())
+	{
+		truncate(indexClass, covariance.data());
+		return;
+	}
+	// The covariance is positive semi-definite: factor it, adding a
+	// small ridge when it is singular, e.g. with fewer samples than
+	// features
+	vector<double> factor(d * d);
+	vector<double> work(d * d);
+	if (Matrix::choleskyRegularised(covariance.data(), factor.data(), d) < 0)
+	{
+		cout << "Covariance of class " << indexClass + 1 << " is not positive definite!" << endl;
+		fill(precision[indexClass].data(), precision[indexClass].data() + d * d, 0.0);
+		logDet[indexClass] = HUGE_VAL;
+		return;
+	}
+	Matrix::choleskyInverse(factor.data(), precision[indexClass].data(), d, work.data());
+	logDet[indexClass] = Matrix::choleskyLogDet(factor.data(), d);
+}
+
+
+/********************************************************************
+ * @name	rankOneUpdate
+ * @brief	Add one sample to a class with a cached precision. With
+ *			n samples after the update and u = x - old mean, the
+ *			covariance becomes a * C + b * u * u^T with
+ *			a = (n - 2) / (n - 1) and b = 1 / n. With P = C^-1,
+ *			w = P * u and c = b / a:
+ *			new P = (P - c * w * w^T / (1 + c * u^T * w)) / a
+ *			new log|C| = d * log(a) + log|C| + log(1 + c * u^T * w)
+ * @param	indexClass - Class index starting from 0
+ * @param	x - Features of the sample
+ * @param	work - Scratch of 2 * d values
+ * @return	none
+ * */
+void ModifiedQDF::rankOneUpdate(int indexClass, const double* x, double* work)
+{
+	int d = dimension;
+	double* u = work;
+	double* w = work + d;
+	size_t n = ++number[indexClass];
+	double* m = mean[indexClass].data();
+	for (int l = 0; l < d; l++)
+	{
+		u[l] = x[l] - m[l];
+		m[l] += u[l] / n;
+	}
+	// Welford update of the scatter matrix
+	double* S = scatter[indexClass].data();
+	double scatterScale = (double)(n - 1) / n;
+	for (int l = 0; l < d; l++)
+	{
+		for (int r = 0; r < d; r++)
+		{
+			S[l * d + r] += scatterScale * u[l] * u[r];
+		}
+	}
+	// Sherman-Morrison and the matrix determinant lemma
+	double a = (double)(n - 2) / (n - 1);
+	double c = 1.0 / n / a;
+	double* P = precision[indexClass].data();
+	double q = 0;
+	for (int l = 0; l < d; l++)
+	{
+		double sum = 0;
+		for (int r = 0; r < d; r++)
+		{
+			sum += P[l * d + r] * u[r];
+		}
+		w[l] = sum;
+		q += u[l] * sum;
+	}
+	double denominator = 1 + c * q;
+	double factor = c / denominator;
+	for (int l = 0; l < d; l++)
+	{
+		for (int r = 0; r < d; r++)
+		{
+			P[l * d + r] = (P[l * d + r] - factor * w[l] * w[r]) / a;
+		}
+	}
+	logDet[indexClass] += d * log(a) + log(denominator);
+	rankOneUpdates[indexClass]++;
+}
+
+
+/********************************************************************
+ * @name	truncated
+ * @brief	Whether only the principal axes of each class are kept
+ * @param	none
+ * @return	True for MQDF, false for the full covariance
+ * */
+bool ModifiedQDF::truncated() const
+{
+	return principalAxes > 0 && principalAxes < dimension;
+}
+
+
+/********************************************************************
+ * @name	truncate
+ * @brief	Keep the principal axes of one class covariance. The minor
+ *			eigenvalues are replaced by delta, so the log-determinant
+ *			becomes sum(log lambda_j) + (d - k) * log(delta).
+ * @param	indexClass - Class index starting from 0
+ * @param	covariance - Covariance matrix of the class
+ * @return	none
+ * */
+void ModifiedQDF::truncate(int indexClass, const double* covariance)
+{
+	int d = dimension;
+	vector<double> values(d);
+	vector<double> vectors(d * d);
+	vector<double> work(2 * d * d);
+	Matrix::eigenSymmetric(covariance, values.data(), vectors.data(), d, work.data());
+
+	int k = principalAxes;
+	double minor = delta;
+	if (minor <= 0)
+	{
+		// Estimate delta as the average of the discarded eigenvalues
+		minor = 0;
+		for (int j = k; j < d; j++)
+		{
+			minor += values[j];
+		}
+		minor /= d - k;
+	}
+	if (minor < MATRIX_EPSILON)
+	{
+		minor = MATRIX_EPSILON;
+	}
+	classDelta[indexClass] = minor;
+	// With k or fewer samples the trailing kept eigenvalues are zero,
+	// or slightly negative from rounding
+	for (int j = 0; j < k; j++)
+	{
+		if (values[j] < MATRIX_EPSILON)
+		{
+			values[j] = MATRIX_EPSILON;
+		}
+	}
+	eigenVectors[indexClass] = Matrix(k, d, vectors.data());
+	eigenValues[indexClass].assign(values.begin(), values.begin() + k);
+	logDet[indexClass] = (d - k) * log(minor);
+	for (int j = 0; j < k; j++)
+	{
+		logDet[indexClass] += log(values[j]);
+	}
+}
+
+
+/********************************************************************
+ * @name	truncatedDistance
+ * @brief	Mahalanobis distance under the truncated eigenspectrum.
+ *			Costs O(d * k) instead of O(d^2).
+ * @param	indexClass - Class index starting from 0
+ * @param	diff - Difference of the features and the class mean
+ * @return	Distance of x to the class mean
+ * */
+double ModifiedQDF::truncatedDistance(int indexClass, const double* diff) const
+{
+	int d = dimension;
+	MatrixView x(1, d, diff);
+	double residual = Matrix::scalar(x * Matrix::trans(x));
+	const double* lambda = axisValuesOf(indexClass);
+	// Coordinates of x along the principal axes
+	auto projections = MatrixView(principalAxes, d, axesOf(indexClass)) * Matrix::trans(x);
+	double distance = 0;
+	for (int j = 0; j < principalAxes; j++)
+	{
+		double projection = projections(j, 0);
+		distance += projection * projection / lambda[j];
+		residual -= projection * projection;
+	}
+	if (residual < 0)
+	{
+		residual = 0;
+	}
+	return distance + residual / classDelta[indexClass];
+}
+
+
+/********************************************************************
+ * @name	meanOf
+ * @brief	Mean of a class, inside the mapped model file after load()
+ * @param	indexClass - Class index starting from 0
+ * @return	d values
+ * */
+const double* ModifiedQDF::meanOf(int indexClass) const
+{
+	if (mappedMean != nullptr)
+	{
+		return mappedMean + (size_t)indexClass * dimension;
+	}
+	return mean[indexClass].data();
+}
+
+
+/********************************************************************
+ * @name	precisionOf
+ * @brief	Precision matrix of a class, inside the mapped model file
+ *			after load()
+ * @param	indexClass - Class index starting from 0
+ * @return	d x d values
+ * */
+const double* ModifiedQDF::precisionOf(int indexClass) const
+{
+	if (mappedPrecision != nullptr)
+	{
+		return mappedPrecision + (size_t)indexClass * dimension * dimension;
+	}
+	return precision[indexClass].data();
+}
+
+
+/********************************************************************
+ * @name	axesOf
+ * @brief	Principal axes of a class, inside the mapped model file
+ *			after load()
+ * @param	indexClass - Class index starting from 0
+ * @return	k x d values, one axis per row
+ * */
+const double* ModifiedQDF::axesOf(int indexClass) const
+{
+	if (mappedAxes != nullptr)
+	{
+		return mappedAxes + (size_t)indexClass * principalAxes * dimension;
+	}
+	return eigenVectors[indexClass].data();
+}
+
+
+/********************************************************************
+ * @name	axisValuesOf
+ * @brief	Principal eigenvalues of a class, inside the mapped model
+ *			file after load()
+ * @param	indexClass - Class index starting from 0
+ * @return	k values
  * */
-int ModifiedQDF::testSingle(DataStruct testData) {
-	double g_x[3] = { 0, 0, 0 };
-	// Calculate the MQDF
-	for (int i = 0; i < 3; i++)
+const double* ModifiedQDF::axisValuesOf(int indexClass) const
+{
+	if (mappedAxisValues != nullptr)
 	{
-		Matrix mat1(1, 4, testData.data);
-		Matrix mat2 = mat1 - mean[i];
-		Matrix mat3 = mat2 * Matrix::inverse(cov[i]) * Matrix::trans(mat2);
-		g_x[i] = -mat3.get(0, 0) - log(Matrix::det(cov[i]));
-		if (g_x[i] < 0)
+		return mappedAxisValues + (size_t)indexClass * principalAxes;
+	}
+	return eigenValues[indexClass].data();
+}
+
+
+/********************************************************************
+ * @name	detachModel
+ * @brief	Copy the statistics of a loaded model out of the mapped
+ *			file, so the model can change
+ * @param	none
+ * @return	none
+ * */
+void ModifiedQDF::detachModel()
+{
+	if (mappedMean == nullptr)
+	{
+		return;
+	}
+	int d = dimension;
+	int k = principalAxes;
+	for (int i = 0; i < classNumber; i++)
+	{
+		mean[i] = Matrix(1, d, meanOf(i));
+		scatter[i] = Matrix(d, d, mappedScatter + (size_t)i * d * d);
+		if (truncated())
+		{
+			precision[i] = Matrix(d, d);
+			eigenVectors[i] = Matrix(k, d, axesOf(i));
+			eigenValues[i].assign(axisValuesOf(i), axisValuesOf(i) + k);
+		}
+		else
 		{
-			g_x[i] = -g_x[i];
+			precision[i] = Matrix(d, d, precisionOf(i));
 		}
 	}
-	// The minimum is the classification
-	int minIndex = 0;
-	double mimValue = g_x[0];
-	for (int i = 0; i < 3; i++)
+	mappedMean = nullptr;
+	mappedScatter = nullptr;
+	mappedPrecision = nullptr;
+	mappedAxes = nullptr;
+	mappedAxisValues = nullptr;
+}
+
+
+/********************************************************************
+ * @name	testSingle
+ * @brief	Test one data in the data set
+ * @param	x - Features of the data to test
+ * @return	Result of predict, CLASS_UNKNOWN before any class is fitted
+ * */
+int ModifiedQDF::testSingle(const double* x) const
+{
+	int d = dimension;
+	ArenaScope scratch;
+	double* diff = scratch.allocate<double>(d);
+	// Calculate the MQDF: Mahalanobis distance plus the log-determinant,
+	// the minimum is the classification. Classes without a covariance
+	// yet take no part.
+	int minIndex = -1;
+	double mimValue = 0;
+	for (int i = 0; i < classNumber; i++)
 	{
-		if (g_x[i] < mimValue)
+		if (number[i] < 2)
+		{
+			continue;
+		}
+		const double* m = meanOf(i);
+		double g_x;
+		if (truncated())
+		{
+			for (int j = 0; j < d; j++)
+			{
+				diff[j] = x[j] - m[j];
+			}
+			g_x = truncatedDistance(i, diff) + logDet[i];
+		}
+		else
+		{
+			g_x = fullDistance(d, x, m, precisionOf(i), diff) + logDet[i];
+		}
+		if (minIndex < 0 || g_x < mimValue)
 		{
 			minIndex = i;
-			mimValue = g_x[i];
+			mimValue = g_x;
 		}
 	}
 	return minIndex + 1;
@@ -105,23 +732,122 @@ int ModifiedQDF::testSingle(DataStruct testData) {
 
 
 /********************************************************************
- * @name	calculateCov
- * @brief	Computed covariance
- * @param	indexClass - Classes that need to be evaluated
- * @param	indexX - X value
- * @param	indexY - Y value
- * @return	covariance
+ * @name	saveModel
+ * @brief	Add the model to a model file: the class counts, means,
+ *			scatter matrices and log-determinants, and the precision
+ *			matrices or the principal axes and eigenvalues
+ * @param	writer - Model file being written
+ * @return	False before the model is trained
  * */
-double ModifiedQDF::calculateCov(int indexClass, int indexX, int indexY)
+bool ModifiedQDF::saveModel(ModelWriter& writer) const
 {
-	double sum = 0;
-	for (const DataStruct data : datasetSplit[currentTrainDataset])
+	if (dimension == 0)
+	{
+		return false;
+	}
+	int d = dimension;
+	int k = truncated() ? principalAxes : 0;
+	writer.setModel(MODEL_MQDF, d, classNumber);
+	MqdfParameters parameters;
+	memset(&parameters, 0, sizeof(parameters));
+	parameters.principalAxes = principalAxes;
+	parameters.delta = delta;
+	writer.add(MQDF_SECTION_PARAMETERS, &parameters, sizeof(parameters));
+	writer.add(MQDF_SECTION_NUMBER, number);
+	writer.add(MQDF_SECTION_UPDATES, rankOneUpdates);
+	writer.add(MQDF_SECTION_LOG_DET, logDet);
+	writer.add(MQDF_SECTION_DELTA, classDelta);
+	vector<double> means;
+	vector<double> scatters;
+	vector<double> precisions;
+	vector<double> axes((size_t)classNumber * k * d, 0.0);
+	vector<double> axisValues((size_t)classNumber * k, 0.0);
+	for (int i = 0; i < classNumber; i++)
 	{
-		if (data.classIndex == indexClass)
+		means.insert(means.end(), meanOf(i), meanOf(i) + d);
+		const double* S = mappedScatter != nullptr ? mappedScatter + (size_t)i * d * d : scatter[i].data();
+		scatters.insert(scatters.end(), S, S + d * d);
+		if (k == 0)
 		{
-			sum += (data.data[indexX] - mean[indexClass - 1].get(0, indexX))
-				* (data.data[indexY] - mean[indexClass - 1].get(0, indexY));
+			precisions.insert(precisions.end(), precisionOf(i), precisionOf(i) + d * d);
 		}
+		else if (mappedAxes != nullptr || eigenValues[i].size() == (size_t)k)
+		{
+			// Classes without a covariance yet keep zero axes
+			copy(axesOf(i), axesOf(i) + k * d, axes.begin() + (size_t)i * k * d);
+			copy(axisValuesOf(i), axisValuesOf(i) + k, axisValues.begin() + (size_t)i * k);
+		}
+	}
+	writer.add(MQDF_SECTION_MEAN, means);
+	writer.add(MQDF_SECTION_SCATTER, scatters);
+	if (k == 0)
+	{
+		writer.add(MQDF_SECTION_PRECISION, precisions);
+	}
+	else
+	{
+		writer.add(MQDF_SECTION_AXES, axes);
+		writer.add(MQDF_SECTION_AXIS_VALUES, axisValues);
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	load
+ * @brief	Serve a saved model from a mapped model file. The means,
+ *			scatter and precision matrices and principal axes stay in
+ *			the file; only the per-class counts and log-determinants
+ *			are copied.
+ * @param	file - Mapped model file of type MODEL_MQDF
+ * @return	Whether the model is valid
+ * */
+bool ModifiedQDF::load(const shared_ptr<ModelFile>& file)
+{
+	int d = file->dimension();
+	int K = file->classNumber();
+	const MqdfParameters* parameters = file->array<MqdfParameters>(MQDF_SECTION_PARAMETERS, 1);
+	if (file->type() != MODEL_MQDF || d <= 0 || K < 0 || parameters == nullptr || parameters->principalAxes < 0
+		|| (size_t)d * d > SIZE_MAX / sizeof(double) / max(K, 1))
+	{
+		return false;
+	}
+	reset(d);
+	principalAxes = parameters->principalAxes;
+	delta = parameters->delta;
+	int k = truncated() ? principalAxes : 0;
+	size_t K2 = (size_t)K;
+	const size_t* counts = file->array<size_t>(MQDF_SECTION_NUMBER, K2);
+	const size_t* updates = file->array<size_t>(MQDF_SECTION_UPDATES, K2);
+	const double* logDets = file->array<double>(MQDF_SECTION_LOG_DET, K2);
+	const double* deltas = file->array<double>(MQDF_SECTION_DELTA, K2);
+	const double* means = file->array<double>(MQDF_SECTION_MEAN, K2 * d);
+	const double* scatters = file->array<double>(MQDF_SECTION_SCATTER, K2 * d * d);
+	const double* precisions = k == 0 ? file->array<double>(MQDF_SECTION_PRECISION, K2 * d * d) : nullptr;
+	const double* axes = k > 0 ? file->array<double>(MQDF_SECTION_AXES, K2 * k * d) : nullptr;
+	const double* axisValues = k > 0 ? file->array<double>(MQDF_SECTION_AXIS_VALUES, K2 * k) : nullptr;
+	if (counts == nullptr || updates == nullptr || logDets == nullptr || deltas == nullptr || means == nullptr
+		|| scatters == nullptr || (k == 0 && precisions == nullptr) || (k > 0 && (axes == nullptr || axisValues == nullptr)))
+	{
+		reset(0);
+		return false;
 	}
-	return sum / (number[indexClass - 1] - 1);
+	// The matrices are created by detachModel() when needed
+	classNumber = K;
+	number.assign(counts, counts + K);
+	rankOneUpdates.assign(updates, updates + K);
+	logDet.assign(logDets, logDets + K);
+	classDelta.assign(deltas, deltas + K);
+	mean.assign(K, Matrix(0, 0));
+	scatter.assign(K, Matrix(0, 0));
+	precision.assign(K, Matrix(0, 0));
+	eigenVectors.assign(K, Matrix(0, d));
+	eigenValues.assign(K, vector<double>());
+	mappedMean = means;
+	mappedScatter = scatters;
+	mappedPrecision = precisions;
+	mappedAxes = axes;
+	mappedAxisValues = axisValues;
+	modelFile = file;
+	return true;
 }
@@ -19,13 +19,34 @@
 #include "Matrix.h"
 
 
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Rank-one updates after which a precision matrix is recomputed from
+// the scatter matrix, bounding the accumulated rounding error
+#define MQDF_REFRESH_INTERVAL 1024
+
+
 //-------------------------------------------------------------------
 // Class Declaration
 //-------------------------------------------------------------------
 
 /********************************************************************
  * @name	ModifiedQDF
- * @brief	Implement MQDF algorithm
+ * @brief	Implement MQDF algorithm. By default every class keeps its
+ *			full covariance (plain QDF). With setTruncation(k, delta)
+ *			only the k principal axes are kept and the minor
+ *			eigenvalues are replaced by the constant delta.
+ *
+ *			The model can also learn online: partialFit() folds new
+ *			labelled samples into the per-class statistics, and
+ *			keeps the cached precision and log-determinant current
+ *			with rank-one updates instead of refactoring them.
+ *
+ *			A saved model is served from the mapped model file: the
+ *			means, precisions and principal axes are read in place.
+ *			The first partialFit() copies them into the model.
  * */
 class ModifiedQDF : public Algorithm
 {
@@ -33,23 +54,70 @@ class ModifiedQDF : public Algorithm
 // Member Variables
 //-------------------------------------------------------------------
 private:
+	// Number of features
+	int dimension = 0;
+	// Number of classes
+	int classNumber = 0;
 	// The number of each type in the test set
-	int number[3] = { 0 };
-	// The mean matrix for each category in the test set
-	Matrix mean[3] = { Matrix(1,4), Matrix(1,4), Matrix(1,4) };
-	// Covariance matrix for each class in the test set
-	Matrix cov[3] = { Matrix(4,4), Matrix(4,4), Matrix(4,4) };
+	vector<size_t> number;
+	// The mean vector for each category in the test set, 1 x d
+	vector<Matrix> mean;
+	// Sum of (x - mean)(x - mean)^T for each class, d x d; the
+	// covariance is scatter / (number - 1)
+	vector<Matrix> scatter;
+	// Inverse of the covariance matrix for each class, cached by train()
+	vector<Matrix> precision;
+	// Rank-one updates applied to precision since it was last computed
+	// from the scatter matrix
+	vector<size_t> rankOneUpdates;
+	// Log-determinant of the covariance matrix for each class
+	vector<double> logDet;
+	// Number of principal axes kept per class, 0 for the full covariance
+	int principalAxes = 0;
+	// Minor eigenvalue, estimated from the data when not positive
+	double delta = 0;
+	// Minor eigenvalue actually used for each class
+	vector<double> classDelta;
+	// The k principal eigenvectors of each class, one per row
+	vector<Matrix> eigenVectors;
+	// The k principal eigenvalues of each class
+	vector<vector<double>> eigenValues;
+	// Statistics inside the mapped model file, used instead of the
+	// members above after load(): d values per class for the means,
+	// d x d for the scatter and precision matrices, k x d for the
+	// principal axes and k for their eigenvalues
+	const double* mappedMean = nullptr;
+	const double* mappedScatter = nullptr;
+	const double* mappedPrecision = nullptr;
+	const double* mappedAxes = nullptr;
+	const double* mappedAxisValues = nullptr;
 
 //-------------------------------------------------------------------
 // Member Function
 //-------------------------------------------------------------------
 private:
-	double calculateCov(int indexClass, int indexX, int indexY);
-	int testSingle(DataStruct testData);
+	void reset(int dimension);
+	void addClasses(int classNumber);
+	void refresh(int indexClass);
+	void rankOneUpdate(int indexClass, const double* x, double* work);
+	bool truncated() const;
+	void truncate(int indexClass, const double* covariance);
+	double truncatedDistance(int indexClass, const double* diff) const;
+	const double* meanOf(int indexClass) const;
+	const double* precisionOf(int indexClass) const;
+	const double* axesOf(int indexClass) const;
+	const double* axisValuesOf(int indexClass) const;
+	void detachModel();
+	int testSingle(const double* x) const;
+	bool saveModel(ModelWriter& writer) const;
 
 public:
-	ModifiedQDF(vector<DataStruct>* dataset);
+	ModifiedQDF(Dataset* dataset);
+	Algorithm* clone() const;
+	void setTruncation(int k, double delta);
 	void train();
+	void partialFit(const Dataset& samples);
+	bool load(const shared_ptr<ModelFile>& file);
 };
 
 #endif
\ No newline at end of file
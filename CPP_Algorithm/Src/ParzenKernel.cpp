@@ -0,0 +1,187 @@
+/********************************************************************
+ * @File name:		ParzenKernel.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-14
+ * @Description:	Scalar Gaussian kernel sum and run-time selection of
+ *					the widest SIMD implementation the CPU supports
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ParzenKernel.h"
+
+#include <math.h>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+typedef double (*GaussKernelFunction)(const double*, size_t, size_t, int, const double*, double);
+typedef double (*GaussKernelFloatFunction)(const float*, size_t, size_t, int, const float*, double);
+
+/********************************************************************
+ * @name	GaussKernelChoice
+ * @brief	The implementation selected for this CPU
+ * */
+typedef struct
+{
+	// Kernel function
+	GaussKernelFunction function;
+	// Kernel function over float32 points
+	GaussKernelFloatFunction floatFunction;
+	// Name of the instruction set
+	const char* name;
+}GaussKernelChoice;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+static GaussKernelChoice selectGaussKernel();
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	gaussKernelSum
+ * @brief	Sum the Gaussian kernel over a block of training points
+ *			with the fastest implementation available
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSum(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale)
+{
+	static const GaussKernelChoice choice = selectGaussKernel();
+	return choice.function(columns, stride, count, dimension, x, scale);
+}
+
+
+/********************************************************************
+ * @name	gaussKernelSumScalar
+ * @brief	Portable implementation of gaussKernelSum
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumScalar(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale)
+{
+	double sum = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		double distance = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			double diff = columns[f * stride + i] - x[f];
+			distance += diff * diff;
+		}
+		sum += exp(scale * distance);
+	}
+	return sum;
+}
+
+
+/********************************************************************
+ * @name	gaussKernelSumFloat
+ * @brief	Sum the Gaussian kernel over a block of float32 training
+ *			points with the fastest implementation available. Every
+ *			squared distance carries a float32 rounding error, see
+ *			ParzenWindow::setPrecision() for the resulting bound.
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumFloat(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale)
+{
+	static const GaussKernelChoice choice = selectGaussKernel();
+	return choice.floatFunction(columns, stride, count, dimension, x, scale);
+}
+
+
+/********************************************************************
+ * @name	gaussKernelSumFloatScalar
+ * @brief	Portable implementation of gaussKernelSumFloat
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumFloatScalar(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale)
+{
+	double sum = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		float distance = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			float diff = columns[f * stride + i] - x[f];
+			distance += diff * diff;
+		}
+		sum += expf((float)scale * distance);
+	}
+	return sum;
+}
+
+
+/********************************************************************
+ * @name	gaussKernelName
+ * @brief	Name of the implementation used by gaussKernelSum
+ * @param	none
+ * @return	Instruction set name
+ * */
+const char* gaussKernelName()
+{
+	static const GaussKernelChoice choice = selectGaussKernel();
+	return choice.name;
+}
+
+
+/********************************************************************
+ * @name	selectGaussKernel
+ * @brief	Pick the widest implementation the CPU supports
+ * @param	none
+ * @return	The selected implementation
+ * */
+static GaussKernelChoice selectGaussKernel()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+#ifdef PARZEN_HAVE_AVX512
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		return { gaussKernelSumAVX512, gaussKernelSumFloatAVX512, "avx512" };
+	}
+#endif
+#ifdef PARZEN_HAVE_AVX2
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		return { gaussKernelSumAVX2, gaussKernelSumFloatAVX2, "avx2" };
+	}
+#endif
+#endif
+	return { gaussKernelSumScalar, gaussKernelSumFloatScalar, "scalar" };
+}
@@ -0,0 +1,59 @@
+/********************************************************************
+ * @File name:		ParzenKernel.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-14
+ * @Description:	Declare the batched Gaussian kernel sums used by the
+ *					Parzen Window
+ ********************************************************************/
+
+#pragma once
+
+#ifndef PARZENKERNEL_H
+#define PARZENKERNEL_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include <cstddef>
+
+
+//-------------------------------------------------------------------
+// Public function declaration
+//-------------------------------------------------------------------
+
+// The kernels below sum exp(scale * |x - t_i|^2) over count training
+// points t_i stored column-wise: feature f of point i is found at
+// columns[f * stride + i].
+double gaussKernelSum(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale);
+double gaussKernelSumScalar(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale);
+#ifdef PARZEN_HAVE_AVX2
+double gaussKernelSumAVX2(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale);
+#endif
+#ifdef PARZEN_HAVE_AVX512
+double gaussKernelSumAVX512(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale);
+#endif
+
+// The same sum over float32 points and query. Differences, squared
+// distances and exponentials are formed in float32, the sum in
+// float64.
+double gaussKernelSumFloat(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale);
+double gaussKernelSumFloatScalar(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale);
+#ifdef PARZEN_HAVE_AVX2
+double gaussKernelSumFloatAVX2(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale);
+#endif
+#ifdef PARZEN_HAVE_AVX512
+double gaussKernelSumFloatAVX512(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale);
+#endif
+const char* gaussKernelName();
+
+#endif
@@ -0,0 +1,185 @@
+/********************************************************************
+ * @File name:		ParzenKernelAVX2.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-14
+ * @Description:	AVX2 + FMA Gaussian kernel sum, four training points
+ *					per iteration. Only compiled with -mavx2 -mfma.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ParzenKernel.h"
+
+#if defined(PARZEN_HAVE_AVX2) && defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+#include <math.h>
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+static inline __m256d exp256(__m256d x);
+static inline __m256 exp256ps(__m256 x);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	gaussKernelSumAVX2
+ * @brief	AVX2 implementation of gaussKernelSum
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumAVX2(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale)
+{
+	const __m256d vscale = _mm256_set1_pd(scale);
+	__m256d vsum = _mm256_setzero_pd();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d distance = _mm256_setzero_pd();
+		for (int f = 0; f < dimension; f++)
+		{
+			__m256d diff = _mm256_sub_pd(_mm256_loadu_pd(columns + f * stride + i), _mm256_set1_pd(x[f]));
+			distance = _mm256_fmadd_pd(diff, diff, distance);
+		}
+		vsum = _mm256_add_pd(vsum, exp256(_mm256_mul_pd(distance, vscale)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, vsum);
+	double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	// The remaining points
+	if (i < count)
+	{
+		sum += gaussKernelSumScalar(columns + i, stride, count - i, dimension, x, scale);
+	}
+	return sum;
+}
+
+
+/********************************************************************
+ * @name	gaussKernelSumFloatAVX2
+ * @brief	AVX2 implementation of gaussKernelSumFloat, eight training
+ *			points per iteration. The exponentials are taken in
+ *			float32 as well and widened to double for the sum.
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumFloatAVX2(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale)
+{
+	const __m256 vscale = _mm256_set1_ps((float)scale);
+	__m256d vsum = _mm256_setzero_pd();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 distance = _mm256_setzero_ps();
+		for (int f = 0; f < dimension; f++)
+		{
+			__m256 diff = _mm256_sub_ps(_mm256_loadu_ps(columns + f * stride + i), _mm256_set1_ps(x[f]));
+			distance = _mm256_fmadd_ps(diff, diff, distance);
+		}
+		__m256 kernel = exp256ps(_mm256_mul_ps(distance, vscale));
+		vsum = _mm256_add_pd(vsum, _mm256_cvtps_pd(_mm256_castps256_ps128(kernel)));
+		vsum = _mm256_add_pd(vsum, _mm256_cvtps_pd(_mm256_extractf128_ps(kernel, 1)));
+	}
+	double lanes[4];
+	_mm256_storeu_pd(lanes, vsum);
+	double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	// The remaining points
+	if (i < count)
+	{
+		sum += gaussKernelSumFloatScalar(columns + i, stride, count - i, dimension, x, scale);
+	}
+	return sum;
+}
+
+
+/********************************************************************
+ * @name	exp256
+ * @brief	Vectorised exp for x <= 0, following the Cephes rational
+ *			approximation (relative error about 2e-16). Arguments
+ *			below the smallest normal result flush to 0.
+ * @param	x - Four arguments
+ * @return	exp of each argument
+ * */
+static inline __m256d exp256(__m256d x)
+{
+	const __m256d minArgument = _mm256_set1_pd(-708.39641853226408);
+	__m256d underflow = _mm256_cmp_pd(x, minArgument, _CMP_LT_OQ);
+	x = _mm256_max_pd(x, minArgument);
+	// x = n * ln2 + r with |r| <= ln2 / 2
+	__m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634073599)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93145751953125E-1), x);
+	x = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.42860682030941723212E-6), x);
+	// exp(r) = 1 + 2 * r * P(r^2) / (Q(r^2) - r * P(r^2))
+	__m256d xx = _mm256_mul_pd(x, x);
+	__m256d p = _mm256_set1_pd(1.26177193074810590878E-4);
+	p = _mm256_fmadd_pd(p, xx, _mm256_set1_pd(3.02994407707441961300E-2));
+	p = _mm256_fmadd_pd(p, xx, _mm256_set1_pd(9.99999999999999999910E-1));
+	p = _mm256_mul_pd(p, x);
+	__m256d q = _mm256_set1_pd(3.00198505138664455042E-6);
+	q = _mm256_fmadd_pd(q, xx, _mm256_set1_pd(2.52448340349684104192E-3));
+	q = _mm256_fmadd_pd(q, xx, _mm256_set1_pd(2.27265548208155028766E-1));
+	q = _mm256_fmadd_pd(q, xx, _mm256_set1_pd(2.00000000000000000009E0));
+	__m256d r = _mm256_div_pd(p, _mm256_sub_pd(q, p));
+	r = _mm256_fmadd_pd(r, _mm256_set1_pd(2.0), _mm256_set1_pd(1.0));
+	// Multiply by 2^n by building the exponent bits directly
+	__m128i n32 = _mm256_cvtpd_epi32(n);
+	__m256i bits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(n32), _mm256_set1_epi64x(1023)), 52);
+	r = _mm256_mul_pd(r, _mm256_castsi256_pd(bits));
+	return _mm256_andnot_pd(underflow, r);
+}
+
+
+/********************************************************************
+ * @name	exp256ps
+ * @brief	Vectorised float32 exp for x <= 0, following the Cephes
+ *			polynomial (relative error below 2^-23). Arguments below
+ *			the smallest normal result flush to 0.
+ * @param	x - Eight arguments
+ * @return	exp of each argument
+ * */
+static inline __m256 exp256ps(__m256 x)
+{
+	const __m256 minArgument = _mm256_set1_ps(-87.3365402f);
+	__m256 underflow = _mm256_cmp_ps(x, minArgument, _CMP_LT_OQ);
+	x = _mm256_max_ps(x, minArgument);
+	// x = n * ln2 + r with |r| <= ln2 / 2
+	__m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+	// exp(r) = 1 + r + r^2 * P(r)
+	__m256 p = _mm256_set1_ps(1.9875691500E-4f);
+	p = _mm256_fmadd_ps(p, x, _mm256_set1_ps(1.3981999507E-3f));
+	p = _mm256_fmadd_ps(p, x, _mm256_set1_ps(8.3334519073E-3f));
+	p = _mm256_fmadd_ps(p, x, _mm256_set1_ps(4.1665795894E-2f));
+	p = _mm256_fmadd_ps(p, x, _mm256_set1_ps(1.6666665459E-1f));
+	p = _mm256_fmadd_ps(p, x, _mm256_set1_ps(5.0000001201E-1f));
+	__m256 r = _mm256_fmadd_ps(p, _mm256_mul_ps(x, x), x);
+	r = _mm256_add_ps(r, _mm256_set1_ps(1.0f));
+	// Multiply by 2^n by building the exponent bits directly
+	__m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+	r = _mm256_mul_ps(r, _mm256_castsi256_ps(bits));
+	return _mm256_andnot_ps(underflow, r);
+}
+
+#endif
@@ -0,0 +1,179 @@
+/********************************************************************
+ * @File name:		ParzenKernelAVX512.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-14
+ * @Description:	AVX-512 Gaussian kernel sum, eight training points
+ *					per iteration. Only compiled with -mavx512f.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ParzenKernel.h"
+
+#if defined(PARZEN_HAVE_AVX512) && defined(__AVX512F__)
+
+// GCC builds even the unmasked AVX-512 intrinsics on a
+// _mm512_undefined_*() pass-through operand, and -Wall then reports
+// those operands as uninitialised once the intrinsics are inlined.
+// No lane of them is ever read, so the warning is off for this file.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+static inline __m512d exp512(__m512d x);
+static inline __m512 exp512ps(__m512 x);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	gaussKernelSumAVX512
+ * @brief	AVX-512 implementation of gaussKernelSum. The tail is
+ *			handled with a masked load instead of a scalar loop.
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumAVX512(const double* columns, size_t stride, size_t count, int dimension,
+	const double* x, double scale)
+{
+	const __m512d vscale = _mm512_set1_pd(scale);
+	__m512d vsum = _mm512_setzero_pd();
+	for (size_t i = 0; i < count; i += 8)
+	{
+		size_t remaining = count - i;
+		__mmask8 mask = remaining >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << remaining) - 1);
+		__m512d distance = _mm512_setzero_pd();
+		for (int f = 0; f < dimension; f++)
+		{
+			__m512d point = _mm512_maskz_loadu_pd(mask, columns + f * stride + i);
+			__m512d diff = _mm512_sub_pd(point, _mm512_set1_pd(x[f]));
+			distance = _mm512_fmadd_pd(diff, diff, distance);
+		}
+		vsum = _mm512_mask_add_pd(vsum, mask, vsum, exp512(_mm512_mul_pd(distance, vscale)));
+	}
+	return _mm512_reduce_add_pd(vsum);
+}
+
+
+/********************************************************************
+ * @name	gaussKernelSumFloatAVX512
+ * @brief	AVX-512 implementation of gaussKernelSumFloat, sixteen
+ *			training points per iteration. The exponentials are taken
+ *			in float32 as well and widened to double for the sum.
+ * @param	columns - Feature columns of the training points
+ * @param	stride - Distance between two feature columns
+ * @param	count - Number of training points
+ * @param	dimension - Number of features
+ * @param	x - Query point
+ * @param	scale - Exponent factor, -1 / (2 * h^2)
+ * @return	Sum of exp(scale * |x - t_i|^2)
+ * */
+double gaussKernelSumFloatAVX512(const float* columns, size_t stride, size_t count, int dimension,
+	const float* x, double scale)
+{
+	const __m512 vscale = _mm512_set1_ps((float)scale);
+	__m512d vsum = _mm512_setzero_pd();
+	for (size_t i = 0; i < count; i += 16)
+	{
+		size_t remaining = count - i;
+		__mmask16 mask = remaining >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+		__m512 distance = _mm512_setzero_ps();
+		for (int f = 0; f < dimension; f++)
+		{
+			__m512 point = _mm512_maskz_loadu_ps(mask, columns + f * stride + i);
+			__m512 diff = _mm512_sub_ps(point, _mm512_set1_ps(x[f]));
+			distance = _mm512_fmadd_ps(diff, diff, distance);
+		}
+		__m512 kernel = _mm512_maskz_mov_ps(mask, exp512ps(_mm512_mul_ps(distance, vscale)));
+		vsum = _mm512_add_pd(vsum, _mm512_cvtps_pd(_mm512_castps512_ps256(kernel)));
+		vsum = _mm512_add_pd(vsum,
+			_mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(kernel), 1))));
+	}
+	return _mm512_reduce_add_pd(vsum);
+}
+
+
+/********************************************************************
+ * @name	exp512
+ * @brief	Vectorised exp for x <= 0, the eight-lane counterpart of
+ *			exp256 in ParzenKernelAVX2.cpp
+ * @param	x - Eight arguments
+ * @return	exp of each argument
+ * */
+static inline __m512d exp512(__m512d x)
+{
+	const __m512d minArgument = _mm512_set1_pd(-708.39641853226408);
+	__mmask8 valid = _mm512_cmp_pd_mask(x, minArgument, _CMP_GE_OQ);
+	x = _mm512_max_pd(x, minArgument);
+	// x = n * ln2 + r with |r| <= ln2 / 2
+	__m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(1.4426950408889634073599)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm512_fnmadd_pd(n, _mm512_set1_pd(6.93145751953125E-1), x);
+	x = _mm512_fnmadd_pd(n, _mm512_set1_pd(1.42860682030941723212E-6), x);
+	// exp(r) = 1 + 2 * r * P(r^2) / (Q(r^2) - r * P(r^2))
+	__m512d xx = _mm512_mul_pd(x, x);
+	__m512d p = _mm512_set1_pd(1.26177193074810590878E-4);
+	p = _mm512_fmadd_pd(p, xx, _mm512_set1_pd(3.02994407707441961300E-2));
+	p = _mm512_fmadd_pd(p, xx, _mm512_set1_pd(9.99999999999999999910E-1));
+	p = _mm512_mul_pd(p, x);
+	__m512d q = _mm512_set1_pd(3.00198505138664455042E-6);
+	q = _mm512_fmadd_pd(q, xx, _mm512_set1_pd(2.52448340349684104192E-3));
+	q = _mm512_fmadd_pd(q, xx, _mm512_set1_pd(2.27265548208155028766E-1));
+	q = _mm512_fmadd_pd(q, xx, _mm512_set1_pd(2.00000000000000000009E0));
+	__m512d r = _mm512_div_pd(p, _mm512_sub_pd(q, p));
+	r = _mm512_fmadd_pd(r, _mm512_set1_pd(2.0), _mm512_set1_pd(1.0));
+	// Multiply by 2^n
+	r = _mm512_scalef_pd(r, n);
+	return _mm512_maskz_mov_pd(valid, r);
+}
+
+
+/********************************************************************
+ * @name	exp512ps
+ * @brief	Vectorised float32 exp for x <= 0, following the Cephes
+ *			polynomial (relative error below 2^-23). Arguments below
+ *			the smallest normal result flush to 0.
+ * @param	x - Sixteen arguments
+ * @return	exp of each argument
+ * */
+static inline __m512 exp512ps(__m512 x)
+{
+	const __m512 minArgument = _mm512_set1_ps(-87.3365402f);
+	__mmask16 valid = _mm512_cmp_ps_mask(x, minArgument, _CMP_GE_OQ);
+	x = _mm512_max_ps(x, minArgument);
+	// x = n * ln2 + r with |r| <= ln2 / 2
+	__m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), x);
+	// exp(r) = 1 + r + r^2 * P(r)
+	__m512 p = _mm512_set1_ps(1.9875691500E-4f);
+	p = _mm512_fmadd_ps(p, x, _mm512_set1_ps(1.3981999507E-3f));
+	p = _mm512_fmadd_ps(p, x, _mm512_set1_ps(8.3334519073E-3f));
+	p = _mm512_fmadd_ps(p, x, _mm512_set1_ps(4.1665795894E-2f));
+	p = _mm512_fmadd_ps(p, x, _mm512_set1_ps(1.6666665459E-1f));
+	p = _mm512_fmadd_ps(p, x, _mm512_set1_ps(5.0000001201E-1f));
+	__m512 r = _mm512_fmadd_ps(p, _mm512_mul_ps(x, x), x);
+	r = _mm512_add_ps(r, _mm512_set1_ps(1.0f));
+	// Multiply by 2^n
+	r = _mm512_scalef_ps(r, n);
+	return _mm512_maskz_mov_ps(valid, r);
+}
+
+#endif
@@ -10,8 +10,95 @@
 // Includes
 //-------------------------------------------------------------------
 #include "ParzenWindow.h"
+#include "Arena.h"
+#include "ParzenKernel.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
 #include <math.h>
+#include <numeric>
+#include <stdexcept>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Sections of a saved model
+enum
+{
+	PARZEN_SECTION_PARAMETERS = 16,
+	PARZEN_SECTION_COUNTS,
+	PARZEN_SECTION_PRIORS,
+	PARZEN_SECTION_STRIDES,
+	PARZEN_SECTION_COLUMNS,
+	PARZEN_SECTION_SAMPLE_CLASS,
+	PARZEN_SECTION_SAMPLE_POSITION,
+	// First section of the KD-tree or the Gauss transform
+	PARZEN_SECTION_INDEX = 32
+};
+
+/********************************************************************
+ * @name	ParzenParameters
+ * @brief	Scalars of a saved model
+ * */
+typedef struct
+{
+	// PARZEN_EXACT, PARZEN_KDTREE, PARZEN_IFGT or PARZEN_RFF
+	uint32_t backend;
+	// Whether the index, the Gauss transform or the Fourier features
+	// are saved
+	uint32_t indexed;
+	double h;
+	double indexAbsError;
+	double indexRelError;
+	double ifgtAccuracy;
+	// Window and ring buffer state
+	uint64_t window;
+	uint64_t ringSize;
+	uint64_t oldest;
+	uint64_t stored;
+	// Number of ids
+	uint64_t ids;
+}ParzenParameters;
+
+/********************************************************************
+ * @name	NodeBound
+ * @brief	Bounds of the kernel sum of one node of a block tree for
+ *			one query
+ * */
+typedef struct
+{
+	// Class index starting from 0
+	int indexClass;
+	// Node, its first leaf and its number of leaves
+	size_t node;
+	size_t firstLeaf;
+	size_t leaves;
+	// Lower and upper bound of the kernel sum
+	double low;
+	double high;
+	// Width of the bounds of the score, nodes are refined widest first
+	double gap;
+}NodeBound;
+
+// Relative slack of the node bounds, far above the rounding error
+// of the distances and of the exponentials
+const double NODE_SLACK = 1e-9;
+
+// Cost of a query in nanoseconds on a current x86 core, measured: per
+// random Fourier feature, a cosine or a sine, and per sample plus per
+// sample and feature of the exact SIMD sums
+const double FOURIER_FEATURE_COST = 20.0;
+const double EXACT_SAMPLE_COST = 1.0;
+const double EXACT_FEATURE_COST = 0.2;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+static size_t treeLeavesFor(size_t count);
 
 
 //-------------------------------------------------------------------
@@ -23,83 +110,1114 @@
  * @brief	The constructor
  * @param	dataset - Input data set
  * */
-ParzenWindow::ParzenWindow(vector<DataStruct>* dataset) : Algorithm(dataset)
+ParzenWindow::ParzenWindow(Dataset* dataset) : Algorithm(dataset)
 {
+	updateKernelConstants();
+}
+
+
+/********************************************************************
+ * @name	clone
+ * @brief	Create an independent copy for training another fold
+ * @param	none
+ * @return	Pointer of the copy
+ * */
+Algorithm* ParzenWindow::clone() const
+{
+	return new ParzenWindow(*this);
 }
 
 
 /********************************************************************
  * @name	train
- * @brief	Training data set
+ * @brief	Training data set. Starts from an empty model and fits the
+ *			current training section in one batch.
  * @param	none
  * @return	none
  * */
 void ParzenWindow::train()
 {
-	int n_total = datasetSplit[currentTrainDataset].size();
-	for (const DataStruct data : datasetSplit[currentTrainDataset])
+	const Dataset& trainSet = datasetSplit[currentTrainDataset];
+	reset(trainSet.dimension());
+	addClasses(trainSet.classNumber());
+	partialFit(trainSet);
+	printDone("Train");
+}
+
+
+/********************************************************************
+ * @name	partialFit
+ * @brief	Add labelled samples to the model. With a window, every
+ *			sample beyond it expires the oldest one. Once the index
+ *			or the Gauss transform is built, samples are inserted
+ *			into it and expired from it one at a time; the first
+ *			call on an empty model builds it over the whole batch.
+ *			Samples of unknown class are ignored.
+ * @param	samples - New samples, labelled like the training data set
+ * @return	none
+ * */
+void ParzenWindow::partialFit(const Dataset& samples)
+{
+	if (dimension == 0)
+	{
+		reset(samples.dimension());
+	}
+	if (samples.dimension() != dimension)
+	{
+		throw invalid_argument("ParzenWindow::partialFit");
+	}
+	detachModel();
+	int maxLabel = samples.classNumber();
+	for (size_t j = 0; j < samples.size(); j++)
 	{
-		n_k[data.classIndex - 1]++;
+		if (samples.label(j) > maxLabel)
+		{
+			maxLabel = samples.label(j);
+		}
+	}
+	if (maxLabel > classNumber)
+	{
+		// The index counts points per class, new classes need a new one
+		addClasses(maxLabel);
+		indexBuilt = false;
+	}
+	for (size_t j = 0; j < samples.size(); j++)
+	{
+		if (samples.label(j) == CLASS_UNKNOWN)
+		{
+			continue;
+		}
+		if (ringSize > 0 && stored == ringSize)
+		{
+			expireOldest();
+		}
+		addSample(samples.row(j), samples.label(j) - 1);
 	}
 	// Calculate the mean
-	P_wk[0] = n_k[0] / n_total;
-	P_wk[1] = n_k[1] / n_total;
-	P_wk[2] = n_k[2] / n_total;
-	cout << "Done: Train." << endl;
+	for (int i = 0; i < classNumber; i++)
+	{
+		P_wk[i] = stored > 0 ? n_k[i] / stored : 0;
+	}
+	if (earlyExit && !treeBuilt)
+	{
+		buildTrees();
+	}
+	if (!indexBuilt)
+	{
+		buildIndex();
+	}
+	if (precision == PARZEN_FLOAT && floatCenter.empty())
+	{
+		buildFloatColumns();
+	}
+}
+
+
+/********************************************************************
+ * @name	reset
+ * @brief	Discard every sample and apply the window size
+ * @param	dimension - Number of features
+ * @return	none
+ * */
+void ParzenWindow::reset(int dimension)
+{
+	this->dimension = dimension;
+	classNumber = 0;
+	n_k.clear();
+	P_wk.clear();
+	classColumns.clear();
+	classStride.clear();
+	classIds.clear();
+	sampleClass.clear();
+	samplePosition.clear();
+	ringSize = window;
+	oldest = 0;
+	stored = 0;
+	indexBuilt = false;
+	indexFallback = false;
+	classColumnsFloat.clear();
+	floatCenter.clear();
+	treeBuilt = false;
+	treeLeaves.clear();
+	nodeCenter.clear();
+	nodeRadius.clear();
+	nodeSpread.clear();
+	mappedColumns = nullptr;
+	mappedOffset.clear();
+	mappedSampleClass = nullptr;
+	mappedSamplePosition = nullptr;
+	mappedIds = 0;
+	modelFile.reset();
+}
+
+
+/********************************************************************
+ * @name	addClasses
+ * @brief	Grow the per-class storage to a number of classes. New
+ *			classes start without samples.
+ * @param	classNumber - Number of classes wanted
+ * @return	none
+ * */
+void ParzenWindow::addClasses(int classNumber)
+{
+	while (this->classNumber < classNumber)
+	{
+		n_k.push_back(0);
+		P_wk.push_back(0);
+		classColumns.push_back(AlignedVector());
+		if (!floatCenter.empty())
+		{
+			classColumnsFloat.push_back(AlignedFloatVector());
+		}
+		if (treeBuilt)
+		{
+			treeLeaves.push_back(1);
+			nodeCenter.push_back(vector<double>(2 * dimension, 0.0));
+			nodeRadius.push_back(vector<double>(2, 0.0));
+			nodeSpread.push_back(vector<double>(2, 0.0));
+		}
+		classStride.push_back(0);
+		classIds.push_back(vector<size_t>());
+		this->classNumber++;
+	}
+}
+
+
+/********************************************************************
+ * @name	ringId
+ * @brief	Id of a kept sample. With a window the ids are the slots
+ *			of the ring buffer, otherwise the samples are numbered in
+ *			order of arrival.
+ * @param	i - Age rank of the sample, 0 for the oldest
+ * @return	Id of the sample
+ * */
+size_t ParzenWindow::ringId(size_t i) const
+{
+	return ringSize > 0 ? (oldest + i) % ringSize : i;
+}
+
+
+/********************************************************************
+ * @name	addSample
+ * @brief	Append one sample to the columns of its class, doubling
+ *			their capacity when full, and to the index once built
+ * @param	x - Features of the sample
+ * @param	indexClass - Class index starting from 0
+ * @return	none
+ * */
+void ParzenWindow::addSample(const double* x, int indexClass)
+{
+	size_t count = (size_t)n_k[indexClass];
+	size_t stride = classStride[indexClass];
+	if (count == stride)
+	{
+		// Each feature column padded to the alignment
+		const size_t lane = FEATURE_ALIGNMENT / sizeof(double);
+		size_t grown = max(lane, 2 * stride);
+		AlignedVector columns(grown * dimension, 0.0);
+		for (int f = 0; f < dimension; f++)
+		{
+			copy(classColumns[indexClass].begin() + f * stride,
+				classColumns[indexClass].begin() + f * stride + count, columns.begin() + f * grown);
+		}
+		classColumns[indexClass].swap(columns);
+		if (!floatCenter.empty())
+		{
+			AlignedFloatVector floatColumns(grown * dimension, 0.0f);
+			for (int f = 0; f < dimension; f++)
+			{
+				copy(classColumnsFloat[indexClass].begin() + f * stride,
+					classColumnsFloat[indexClass].begin() + f * stride + count, floatColumns.begin() + f * grown);
+			}
+			classColumnsFloat[indexClass].swap(floatColumns);
+		}
+		classStride[indexClass] = stride = grown;
+	}
+	for (int f = 0; f < dimension; f++)
+	{
+		classColumns[indexClass][f * stride + count] = x[f];
+	}
+	if (!floatCenter.empty())
+	{
+		for (int f = 0; f < dimension; f++)
+		{
+			classColumnsFloat[indexClass][f * stride + count] = (float)(x[f] - floatCenter[f]);
+		}
+	}
+	size_t id = ringId(stored);
+	if (id >= sampleClass.size())
+	{
+		sampleClass.resize(id + 1, -1);
+		samplePosition.resize(id + 1, 0);
+	}
+	sampleClass[id] = indexClass;
+	samplePosition[id] = count;
+	classIds[indexClass].push_back(id);
+	n_k[indexClass]++;
+	stored++;
+	if (treeBuilt)
+	{
+		coverPoint(indexClass, count);
+	}
+	if (indexBuilt && backend == PARZEN_KDTREE && !indexFallback)
+	{
+		index.insert(x, indexClass, id);
+	}
+	else if (indexBuilt && backend == PARZEN_IFGT && !indexFallback)
+	{
+		gaussTransform.insert(x, indexClass, id);
+		// A grown cluster radius lost the accuracy, partialFit() rebuilds
+		if (gaussTransform.errorBound() > ifgtAccuracy)
+		{
+			indexBuilt = false;
+		}
+	}
+	else if (indexBuilt && backend == PARZEN_RFF && !indexFallback)
+	{
+		fourierFeatures.insert(x, indexClass);
+	}
+}
+
+
+/********************************************************************
+ * @name	expireOldest
+ * @brief	Remove the oldest sample. The last sample of its class
+ *			takes its position in the class columns.
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::expireOldest()
+{
+	size_t id = ringId(0);
+	int c = sampleClass[id];
+	size_t position = samplePosition[id];
+	size_t last = (size_t)n_k[c] - 1;
+	size_t stride = classStride[c];
+	double* columns = classColumns[c].data();
+	if (indexBuilt && backend == PARZEN_KDTREE && !indexFallback)
+	{
+		index.remove(id);
+	}
+	else if (indexBuilt && !indexFallback && (backend == PARZEN_IFGT || backend == PARZEN_RFF))
+	{
+		vector<double> x(dimension);
+		for (int f = 0; f < dimension; f++)
+		{
+			x[f] = columns[f * stride + position];
+		}
+		if (backend == PARZEN_IFGT)
+		{
+			gaussTransform.remove(x.data(), c, id);
+		}
+		else
+		{
+			fourierFeatures.remove(x.data(), c);
+		}
+	}
+	for (int f = 0; f < dimension; f++)
+	{
+		columns[f * stride + position] = columns[f * stride + last];
+	}
+	if (!floatCenter.empty())
+	{
+		float* floatColumns = classColumnsFloat[c].data();
+		for (int f = 0; f < dimension; f++)
+		{
+			floatColumns[f * stride + position] = floatColumns[f * stride + last];
+		}
+	}
+	if (treeBuilt)
+	{
+		// The nodes holding the last position lose a point, their
+		// centre is no longer the mean
+		for (size_t j = treeLeaves[c] + last / PARZEN_BLOCK_POINTS; j > 0; j /= 2)
+		{
+			nodeSpread[c][j] = -1;
+		}
+		if (position != last)
+		{
+			coverPoint(c, position);
+		}
+	}
+	size_t moved = classIds[c][last];
+	classIds[c][position] = moved;
+	samplePosition[moved] = position;
+	classIds[c].pop_back();
+	sampleClass[id] = -1;
+	n_k[c]--;
+	oldest = (oldest + 1) % ringSize;
+	stored--;
+}
+
+
+/********************************************************************
+ * @name	buildIndex
+ * @brief	Build the spatial index, the Gauss transform or the
+ *			Fourier features over the kept samples, oldest first.
+ *			The KD-tree is then probed with PARZEN_INDEX_PROBES of
+ *			the samples, and dropped when a query would cost more
+ *			than the kernel values of every sample: with many
+ *			features, or a window wide against the spread of the
+ *			data, the boxes are too loose to prune. The Gauss
+ *			transform is dropped alike when build() finds the exact
+ *			sums cheaper or cannot meet the accuracy, and the
+ *			Fourier features when the classes need more of them
+ *			than the exact sums cost.
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::buildIndex()
+{
+	indexFallback = false;
+	indexBuilt = backend == PARZEN_KDTREE || backend == PARZEN_IFGT || backend == PARZEN_RFF;
+	if (!indexBuilt)
+	{
+		return;
+	}
+	vector<double> points(stored * dimension);
+	vector<int> labels(stored);
+	vector<size_t> ids(stored);
+	for (size_t i = 0; i < stored; i++)
+	{
+		ids[i] = ringId(i);
+		labels[i] = sampleClass[ids[i]];
+		const double* columns = classColumns[labels[i]].data();
+		for (int f = 0; f < dimension; f++)
+		{
+			points[i * dimension + f] = columns[f * classStride[labels[i]] + samplePosition[ids[i]]];
+		}
+	}
+	if (backend == PARZEN_KDTREE)
+	{
+		index.build(points.data(), labels.data(), stored, dimension, classNumber, KDTREE_LEAF_SIZE, ids.data());
+		size_t probes = min(stored, (size_t)PARZEN_INDEX_PROBES);
+		size_t work = 0;
+		vector<double> sums(classNumber);
+		for (size_t i = 0; i < probes; i++)
+		{
+			size_t cost;
+			index.kernelSums(points.data() + i * stored / probes * dimension, kernelScale,
+				indexAbsError, indexRelError, sums.data(), &cost);
+			work += cost;
+		}
+		if (work >= probes * stored)
+		{
+			index.build(nullptr, nullptr, 0, dimension, classNumber);
+			indexFallback = true;
+		}
+	}
+	else if (backend == PARZEN_IFGT)
+	{
+		indexFallback = !gaussTransform.build(points.data(), labels.data(), stored, dimension, classNumber,
+			sqrt(2.0) * h, ifgtAccuracy, ids.data());
+	}
+	else
+	{
+		// D grows to what the classes need, and the exact sums are
+		// kept when that many features cost more than they do
+		double features = max((double)rffFeatures, fourierFeaturesNeeded(points.data(), labels.data()));
+		if (features > RFF_MAX_FEATURES
+			|| features * FOURIER_FEATURE_COST >= stored * (EXACT_SAMPLE_COST + EXACT_FEATURE_COST * dimension))
+		{
+			fourierFeatures.build(nullptr, nullptr, 0, dimension, classNumber, h, 2, rffSeed);
+			indexFallback = true;
+		}
+		else
+		{
+			fourierFeatures.build(points.data(), labels.data(), stored, dimension, classNumber,
+				h, (size_t)ceil(features), rffSeed);
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	fourierFeaturesNeeded
+ * @brief	Number of Fourier features the classes need. The score of
+ *			a class is estimated within about P_wk / sqrt(D), so the
+ *			two leading classes of a sample are told apart reliably
+ *			once D reaches 8 * (P_wk / gap)^2. PARZEN_INDEX_PROBES of
+ *			the samples, each left out of its own class, give the
+ *			gap, and D must serve three quarters of them; the
+ *			classes of a small h in many dimensions are often
+ *			closer than millions of features can resolve.
+ * @param	points - Row-major kept samples
+ * @param	labels - Class of each sample, from 0
+ * @return	Number of features, HUGE_VAL when the classes cannot be
+ *			told apart
+ * */
+double ParzenWindow::fourierFeaturesNeeded(const double* points, const int* labels) const
+{
+	size_t probes = min(stored, (size_t)PARZEN_INDEX_PROBES);
+	if (probes == 0)
+	{
+		return 0;
+	}
+	double largestPrior = *max_element(P_wk.begin(), P_wk.end());
+	vector<double> needed(probes);
+	for (size_t i = 0; i < probes; i++)
+	{
+		size_t sample = i * stored / probes;
+		const double* x = points + sample * dimension;
+		double first = 0;
+		double second = 0;
+		for (int c = 0; c < classNumber; c++)
+		{
+			double count = n_k[c] - (labels[sample] == c ? 1 : 0);
+			if (count <= 0)
+			{
+				continue;
+			}
+			double sum = gaussKernelSum(columnsOf(c), classStride[c], (size_t)n_k[c], dimension, x, kernelScale);
+			// The sample itself adds exp(0) to its own class
+			double score = P_wk[c] * ((sum - (labels[sample] == c ? 1 : 0)) / count);
+			if (score > first)
+			{
+				second = first;
+				first = score;
+			}
+			else if (score > second)
+			{
+				second = score;
+			}
+		}
+		double gap = first - second;
+		needed[i] = gap > 0 ? 8 * (largestPrior / gap) * (largestPrior / gap) : HUGE_VAL;
+	}
+	size_t quantile = probes * 3 / 4;
+	nth_element(needed.begin(), needed.begin() + quantile, needed.end());
+	return needed[quantile];
+}
+
+
+/********************************************************************
+ * @name	buildFloatColumns
+ * @brief	Build the float32 copy of the class columns used by
+ *			PARZEN_FLOAT. The samples are centred on their mean first,
+ *			so the rounding error follows their spread rather than
+ *			their distance from the origin.
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::buildFloatColumns()
+{
+	classColumnsFloat.clear();
+	floatCenter.assign(dimension, 0.0);
+	for (int c = 0; c < classNumber; c++)
+	{
+		const double* columns = columnsOf(c);
+		for (int f = 0; f < dimension; f++)
+		{
+			for (size_t i = 0; i < (size_t)n_k[c]; i++)
+			{
+				floatCenter[f] += columns[f * classStride[c] + i];
+			}
+		}
+	}
+	for (int f = 0; f < dimension; f++)
+	{
+		floatCenter[f] = stored > 0 ? floatCenter[f] / stored : 0;
+	}
+	classColumnsFloat.resize(classNumber);
+	for (int c = 0; c < classNumber; c++)
+	{
+		const double* columns = columnsOf(c);
+		classColumnsFloat[c].assign(dimension * classStride[c], 0.0f);
+		for (int f = 0; f < dimension; f++)
+		{
+			for (size_t i = 0; i < (size_t)n_k[c]; i++)
+			{
+				classColumnsFloat[c][f * classStride[c] + i] = (float)(columns[f * classStride[c] + i] - floatCenter[f]);
+			}
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	buildTrees
+ * @brief	Build the block trees of the early exit. The columns of
+ *			a model in memory are first sorted so that every node is
+ *			compact; a mapped model keeps the order it was saved in.
+ *			The trees are then probed with PARZEN_INDEX_PROBES of
+ *			the samples, and left unused unless a query skips a
+ *			quarter of the kernel values of every sample: with
+ *			overlapping classes or small ones, few blocks are skipped
+ *			and the bounds cost more than they save.
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::buildTrees()
+{
+	if (mappedColumns == nullptr)
+	{
+		for (int c = 0; c < classNumber; c++)
+		{
+			sortClass(c);
+		}
+		// The float columns follow the new positions
+		if (!floatCenter.empty())
+		{
+			buildFloatColumns();
+		}
+	}
+	treeLeaves.assign(classNumber, 0);
+	nodeCenter.assign(classNumber, vector<double>());
+	nodeRadius.assign(classNumber, vector<double>());
+	nodeSpread.assign(classNumber, vector<double>());
+	for (int c = 0; c < classNumber; c++)
+	{
+		boundClass(c, treeLeavesFor((size_t)n_k[c]));
+	}
+	treeBuilt = true;
+	treeFallback = false;
+	// Evenly spaced samples, counted through the classes in order
+	size_t probes = min(stored, (size_t)PARZEN_INDEX_PROBES);
+	size_t work = 0;
+	vector<double> x(dimension);
+	for (size_t i = 0; i < probes; i++)
+	{
+		size_t position = i * stored / probes;
+		int c = 0;
+		while (position >= (size_t)n_k[c])
+		{
+			position -= (size_t)n_k[c];
+			c++;
+		}
+		const double* columns = columnsOf(c);
+		for (int f = 0; f < dimension; f++)
+		{
+			x[f] = columns[f * classStride[c] + position];
+		}
+		int decided;
+		decideEarly(x.data(), decided, &work);
+	}
+	// Blocks summed one at a time run slower than the full sums, a
+	// quarter of the work must be saved
+	treeFallback = probes > 0 && work * 4 >= probes * stored * 3;
+}
+
+
+/********************************************************************
+ * @name	sortClass
+ * @brief	Reorder the points of a class along its block tree: the
+ *			points of a node are split along their widest feature at
+ *			the first position of its right child, down to single
+ *			blocks
+ * @param	indexClass - Class index starting from 0
+ * @return	none
+ * */
+void ParzenWindow::sortClass(int indexClass)
+{
+	const size_t B = PARZEN_BLOCK_POINTS;
+	size_t count = (size_t)n_k[indexClass];
+	size_t stride = classStride[indexClass];
+	const double* columns = classColumns[indexClass].data();
+	vector<size_t> order(count);
+	iota(order.begin(), order.end(), 0);
+	// Nodes to split, as their first leaf and number of leaves
+	vector<pair<size_t, size_t>> nodes(1, make_pair((size_t)0, treeLeavesFor(count)));
+	while (!nodes.empty())
+	{
+		size_t firstLeaf = nodes.back().first;
+		size_t leaves = nodes.back().second;
+		nodes.pop_back();
+		size_t first = firstLeaf * B;
+		size_t last = min(count, (firstLeaf + leaves) * B);
+		size_t middle = (firstLeaf + leaves / 2) * B;
+		if (leaves == 1 || first >= last)
+		{
+			continue;
+		}
+		nodes.push_back(make_pair(firstLeaf, leaves / 2));
+		if (middle >= last)
+		{
+			// Every point belongs to the left child
+			continue;
+		}
+		nodes.push_back(make_pair(firstLeaf + leaves / 2, leaves / 2));
+		int widest = 0;
+		double widestSpread = -1;
+		for (int f = 0; f < dimension; f++)
+		{
+			double low = columns[f * stride + order[first]];
+			double high = low;
+			for (size_t i = first + 1; i < last; i++)
+			{
+				low = min(low, columns[f * stride + order[i]]);
+				high = max(high, columns[f * stride + order[i]]);
+			}
+			if (high - low > widestSpread)
+			{
+				widest = f;
+				widestSpread = high - low;
+			}
+		}
+		const double* column = columns + widest * stride;
+		nth_element(order.begin() + first, order.begin() + middle, order.begin() + last,
+			[column](size_t a, size_t b) { return column[a] < column[b]; });
+	}
+	AlignedVector sorted(classColumns[indexClass].size(), 0.0);
+	vector<size_t> ids(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int f = 0; f < dimension; f++)
+		{
+			sorted[f * stride + i] = columns[f * stride + order[i]];
+		}
+		ids[i] = classIds[indexClass][order[i]];
+		samplePosition[ids[i]] = i;
+	}
+	classColumns[indexClass].swap(sorted);
+	classIds[indexClass].swap(ids);
+}
+
+
+/********************************************************************
+ * @name	boundClass
+ * @brief	Compute the centre and the radius of every node of the
+ *			block tree of a class. The root is node 1 and node j has
+ *			the children 2j and 2j + 1, so the l nodes j from l to
+ *			2l - 1 each cover leaves / l leaves, from leaf
+ *			(j - l) * leaves / l.
+ * @param	indexClass - Class index starting from 0
+ * @param	leaves - Number of leaves, a power of two
+ * @return	none
+ * */
+void ParzenWindow::boundClass(int indexClass, size_t leaves)
+{
+	const size_t B = PARZEN_BLOCK_POINTS;
+	const double* columns = columnsOf(indexClass);
+	size_t stride = classStride[indexClass];
+	size_t count = (size_t)n_k[indexClass];
+	treeLeaves[indexClass] = leaves;
+	nodeCenter[indexClass].assign(2 * leaves * dimension, 0.0);
+	nodeRadius[indexClass].assign(2 * leaves, 0.0);
+	nodeSpread[indexClass].assign(2 * leaves, 0.0);
+	for (size_t level = 1; level <= leaves; level *= 2)
+	{
+		size_t span = leaves / level;
+		for (size_t j = level; j < 2 * level; j++)
+		{
+			size_t first = (j - level) * span * B;
+			size_t last = min(count, first + span * B);
+			if (first >= last)
+			{
+				break;
+			}
+			double* center = nodeCenter[indexClass].data() + j * dimension;
+			for (int f = 0; f < dimension; f++)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					center[f] += columns[f * stride + i];
+				}
+				center[f] /= (double)(last - first);
+			}
+			double radius = 0;
+			double spread = 0;
+			for (size_t i = first; i < last; i++)
+			{
+				double distance = 0;
+				for (int f = 0; f < dimension; f++)
+				{
+					double diff = columns[f * stride + i] - center[f];
+					distance += diff * diff;
+				}
+				radius = max(radius, distance);
+				spread += distance;
+			}
+			nodeRadius[indexClass][j] = sqrt(radius);
+			nodeSpread[indexClass][j] = spread / (double)(last - first);
+		}
+	}
 }
 
+
+/********************************************************************
+ * @name	coverPoint
+ * @brief	Keep the block tree of a class valid for the point just
+ *			written to a position. A new point that starts a node
+ *			becomes its centre, otherwise it widens the radius of
+ *			every node holding it. A tree without room for the
+ *			position is replaced by one twice the size.
+ * @param	indexClass - Class index starting from 0
+ * @param	position - Position of the point in the class columns
+ * @return	none
+ * */
+void ParzenWindow::coverPoint(int indexClass, size_t position)
+{
+	const size_t B = PARZEN_BLOCK_POINTS;
+	size_t leaves = treeLeaves[indexClass];
+	if (position >= leaves * B)
+	{
+		boundClass(indexClass, 2 * leaves);
+		return;
+	}
+	const double* columns = classColumns[indexClass].data();
+	size_t stride = classStride[indexClass];
+	bool added = position + 1 == (size_t)n_k[indexClass];
+	size_t span = 1;
+	for (size_t j = leaves + position / B; j > 0; j /= 2, span *= 2)
+	{
+		double* center = nodeCenter[indexClass].data() + j * dimension;
+		if (added && (j * span - leaves) * B == position)
+		{
+			for (int f = 0; f < dimension; f++)
+			{
+				center[f] = columns[f * stride + position];
+			}
+			nodeRadius[indexClass][j] = 0;
+			nodeSpread[indexClass][j] = 0;
+			continue;
+		}
+		double distance = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			double diff = columns[f * stride + position] - center[f];
+			distance += diff * diff;
+		}
+		nodeRadius[indexClass][j] = max(nodeRadius[indexClass][j], sqrt(distance));
+		nodeSpread[indexClass][j] = -1;
+	}
+}
+
+
+/********************************************************************
+ * @name	columnsOf
+ * @brief	Feature columns of a class, inside the mapped model file
+ *			after load()
+ * @param	indexClass - Class index starting from 0
+ * @return	First value of the first column
+ * */
+const double* ParzenWindow::columnsOf(int indexClass) const
+{
+	if (mappedColumns != nullptr)
+	{
+		return mappedColumns + mappedOffset[indexClass];
+	}
+	return classColumns[indexClass].data();
+}
+
+
+/********************************************************************
+ * @name	detachModel
+ * @brief	Copy the samples of a loaded model out of the mapped file,
+ *			so the model can change. The index is rebuilt by the
+ *			next buildIndex().
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::detachModel()
+{
+	if (mappedColumns == nullptr)
+	{
+		return;
+	}
+	for (int c = 0; c < classNumber; c++)
+	{
+		const double* columns = columnsOf(c);
+		classColumns[c].assign(columns, columns + dimension * classStride[c]);
+		classIds[c].assign((size_t)n_k[c], 0);
+	}
+	sampleClass.assign(mappedSampleClass, mappedSampleClass + mappedIds);
+	samplePosition.assign(mappedSamplePosition, mappedSamplePosition + mappedIds);
+	for (size_t id = 0; id < mappedIds; id++)
+	{
+		if (sampleClass[id] >= 0)
+		{
+			classIds[sampleClass[id]][samplePosition[id]] = id;
+		}
+	}
+	mappedColumns = nullptr;
+	mappedOffset.clear();
+	mappedSampleClass = nullptr;
+	mappedSamplePosition = nullptr;
+	mappedIds = 0;
+	indexBuilt = false;
+}
+
+
 /********************************************************************
  * @name	testSingle
  * @brief	Test one data in the data set
- * @param	testData - Data to test
+ * @param	x - Features of the data to test
  * @return	Result of predict
  * */
-int ParzenWindow::testSingle(DataStruct testData)
-{
-	double h_d = pow(h, 4);
-	double sum[3] = { 0 ,0, 0 };
-	// Computational Gaussian window
-	for (const DataStruct trainData : datasetSplit[currentTrainDataset])
-	{
-		double u1 = (testData.data[0] - trainData.data[0]) / h;
-		double u2 = (testData.data[1] - trainData.data[1]) / h;
-		double u3 = (testData.data[2] - trainData.data[2]) / h;
-		double u4 = (testData.data[3] - trainData.data[3]) / h;
-		sum[trainData.classIndex - 1] += (gaussWindow(u1, u2, u3, u4) / h_d);
-	}
-	double result[3] = { 0, 0, 0 };
-	result[0] = P_wk[0] * (sum[0] / n_k[0]);
-	result[1] = P_wk[1] * (sum[1] / n_k[1]);
-	result[2] = P_wk[2] * (sum[2] / n_k[2]);
-	// The maximum value is classified
-	int maxIndex = 0;
+int ParzenWindow::testSingle(const double* x) const
+{
+	int decided;
+	if (backend == PARZEN_EXACT && treeBuilt && !treeFallback && floatCenter.empty() && decideEarly(x, decided))
+	{
+		return decided;
+	}
+	ArenaScope scratch;
+	double* sum = scratch.allocate<double>(classNumber, 0.0);
+	// Computational Gaussian window, the constant factors are applied once per class
+	if (backend == PARZEN_KDTREE && indexBuilt && !indexFallback)
+	{
+		index.kernelSums(x, kernelScale, indexAbsError, indexRelError, sum);
+	}
+	else if (backend == PARZEN_IFGT && indexBuilt && !indexFallback)
+	{
+		gaussTransform.kernelSums(x, sum);
+	}
+	else if (backend == PARZEN_RFF && indexBuilt && !indexFallback)
+	{
+		fourierFeatures.kernelSums(x, sum);
+	}
+	else if (!floatCenter.empty())
+	{
+		float* xFloat = scratch.allocate<float>(dimension);
+		for (int f = 0; f < dimension; f++)
+		{
+			xFloat[f] = (float)(x[f] - floatCenter[f]);
+		}
+		for (int i = 0; i < classNumber; i++)
+		{
+			sum[i] = gaussKernelSumFloat(classColumnsFloat[i].data(), classStride[i], (size_t)n_k[i],
+				dimension, xFloat, kernelScale);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < classNumber; i++)
+		{
+			sum[i] = gaussKernelSum(columnsOf(i), classStride[i], (size_t)n_k[i],
+				dimension, x, kernelScale);
+		}
+	}
+	// The maximum value is classified. The normalisation of the window,
+	// 1 / ((2 * PI)^(d/2) * h^d), is the same for every class and would
+	// underflow for long feature vectors, so it is left out. The
+	// estimates of PARZEN_RFF can be negative, so the first class with
+	// samples starts the search rather than 0.
+	int maxIndex = -1;
 	double maxValue = 0;
-	for (int i = 0; i < 3; i++)
+	for (int i = 0; i < classNumber; i++)
 	{
-		if (result[i] > maxValue)
+		if (n_k[i] <= 0)
+		{
+			continue;
+		}
+		double result = P_wk[i] * (sum[i] / n_k[i]);
+		if (maxIndex < 0 || result > maxValue)
 		{
 			maxIndex = i;
-			maxValue = result[i];
+			maxValue = result;
 		}
 	}
-	return maxIndex + 1;
+	return maxIndex >= 0 ? maxIndex + 1 : 1;
 }
 
 
 /********************************************************************
- * @name	gaussWindow
- * @brief	Implement gaussian window function
- * @param	param1 - The feature vectors
- * @param	param2 - The feature vectors
- * @param	param3 - The feature vectors
- * @param	param4 - The feature vectors
- * @return	Result of gauss window
+ * @name	decideEarly
+ * @brief	Classify one sample from the block trees. The root of
+ *			every class starts bounded by the kernel values at the
+ *			nearest and the farthest distance its radius allows; the
+ *			node with the widest bounds is then replaced by its
+ *			children, or summed exactly when it is a block, until
+ *			the lowest score of one class exceeds the highest score
+ *			of every other class. The scores carry a tolerance for
+ *			the rounding of the bounds and of the summation order,
+ *			so a decision is always the one the full sums give.
+ * @param	x - Features of the data to test
+ * @param	result - Receives the predicted class when decided
+ * @param	work - Incremented by the kernel values computed and
+ *			PARZEN_NODE_COST per node bounded, including the full
+ *			sums that follow an undecided query; nullptr to skip
+ * @return	False when the scores are too close to decide, the full
+ *			sums must then be taken
  * */
-double ParzenWindow::gaussWindow(double param1, double param2, double param3, double param4)
+bool ParzenWindow::decideEarly(const double* x, int& result, size_t* work) const
 {
-	double i = pow(2 * PI, 2);
-	double j = exp(-(pow(param1, 2) + pow(param2, 2) + pow(param3, 2) + pow(param4, 2)) / 2);
-	return j / i;
+	const size_t B = PARZEN_BLOCK_POINTS;
+	ArenaScope scratch;
+	// Sum of the blocks summed so far, bounds of the pending nodes and
+	// their number
+	double* exact = scratch.allocate<double>(classNumber, 0.0);
+	double* pendingLow = scratch.allocate<double>(classNumber, 0.0);
+	double* pendingHigh = scratch.allocate<double>(classNumber, 0.0);
+	size_t* pending = scratch.allocate<size_t>(classNumber, 0);
+	// Largest pending upper bound and number of updates, which bound
+	// the rounding of the pending sums
+	double* peak = scratch.allocate<double>(classNumber, 0.0);
+	size_t* updates = scratch.allocate<size_t>(classNumber, 0);
+	size_t capacity = 0;
+	for (int c = 0; c < classNumber; c++)
+	{
+		capacity += treeLeaves[c];
+	}
+	// Pending nodes, a heap with the widest bounds on top
+	NodeBound* heap = scratch.allocate<NodeBound>(capacity);
+	size_t size = 0;
+	auto narrower = [](const NodeBound& a, const NodeBound& b) { return a.gap < b.gap; };
+	auto push = [&](int c, size_t node, size_t firstLeaf, size_t leaves)
+	{
+		size_t first = firstLeaf * B;
+		size_t count = (size_t)n_k[c];
+		if (first >= count)
+		{
+			return;
+		}
+		count = min(count, first + leaves * B) - first;
+		const double* center = nodeCenter[c].data() + node * dimension;
+		double distance = 0;
+		for (int f = 0; f < dimension; f++)
+		{
+			double diff = x[f] - center[f];
+			distance += diff * diff;
+		}
+		double radius = nodeRadius[c][node];
+		double spread = nodeSpread[c][node];
+		double slack = NODE_SLACK * (sqrt(distance) + radius);
+		double nearest = max(0.0, sqrt(distance) - radius - slack);
+		double farthest = sqrt(distance) + radius + slack;
+		// Exponents at the nearest and the farthest point
+		double a = -kernelScale * nearest * nearest;
+		double b = -kernelScale * farthest * farthest;
+		if (work != nullptr)
+		{
+			*work += PARZEN_NODE_COST;
+		}
+		NodeBound& bound = heap[size++];
+		bound.indexClass = c;
+		bound.node = node;
+		bound.firstLeaf = firstLeaf;
+		bound.leaves = leaves;
+		if (spread >= 0 && b > a)
+		{
+			// The mean exponent is known when the centre is the mean of
+			// the node. exp(-s) is convex: above its value at the mean
+			// and below the chord from a to b.
+			double mean = -kernelScale * (distance + spread);
+			mean = min(b, max(a, mean * (1 - NODE_SLACK)));
+			double chord = exp(-a) + (exp(-b) - exp(-a)) * ((mean - a) / (b - a));
+			mean = min(b, mean * (1 + 2 * NODE_SLACK) + NODE_SLACK);
+			bound.high = count * chord * (1 + NODE_SLACK);
+			bound.low = count * exp(-mean) * (1 - NODE_SLACK);
+		}
+		else
+		{
+			bound.high = count * exp(-a) * (1 + NODE_SLACK);
+			bound.low = count * exp(-b) * (1 - NODE_SLACK);
+		}
+		bound.gap = (bound.high - bound.low) * (P_wk[c] / n_k[c]);
+		pendingLow[c] += bound.low;
+		pendingHigh[c] += bound.high;
+		push_heap(heap, heap + size, narrower);
+		pending[c]++;
+		updates[c]++;
+		peak[c] = max(peak[c], pendingHigh[c]);
+	};
+	for (int c = 0; c < classNumber; c++)
+	{
+		push(c, 1, 0, treeLeaves[c]);
+	}
+	while (true)
+	{
+		// The lowest score of the leading class against the highest
+		// score of every other class
+		int best = -1;
+		double bestLow = 0;
+		for (int c = 0; c < classNumber; c++)
+		{
+			if (n_k[c] == 0)
+			{
+				continue;
+			}
+			double rounding = (n_k[c] + treeLeaves[c] + 16) * DBL_EPSILON * exact[c];
+			double drift = pending[c] > 0 ? (updates[c] + 4) * DBL_EPSILON * peak[c] : 0;
+			double lower = exact[c] - rounding + (pending[c] > 0 ? pendingLow[c] : 0) - drift;
+			double low = P_wk[c] * (lower / n_k[c]) * (1 - NODE_SLACK);
+			if (low > bestLow)
+			{
+				best = c;
+				bestLow = low;
+			}
+		}
+		bool separated = best >= 0;
+		for (int c = 0; c < classNumber && separated; c++)
+		{
+			if (c == best || n_k[c] == 0)
+			{
+				continue;
+			}
+			double rounding = (n_k[c] + treeLeaves[c] + 16) * DBL_EPSILON * exact[c];
+			double drift = pending[c] > 0 ? (updates[c] + 4) * DBL_EPSILON * peak[c] : 0;
+			double upper = exact[c] + rounding + (pending[c] > 0 ? pendingHigh[c] : 0) + drift;
+			separated = P_wk[c] * (upper / n_k[c]) * (1 + NODE_SLACK) < bestLow;
+		}
+		if (separated)
+		{
+			result = best + 1;
+			return true;
+		}
+		if (size == 0)
+		{
+			break;
+		}
+		pop_heap(heap, heap + size, narrower);
+		NodeBound node = heap[--size];
+		int c = node.indexClass;
+		pendingLow[c] -= node.low;
+		pendingHigh[c] -= node.high;
+		pending[c]--;
+		updates[c]++;
+		if (node.leaves == 1)
+		{
+			size_t first = node.firstLeaf * B;
+			size_t count = min(B, (size_t)n_k[c] - first);
+			exact[c] += gaussKernelSum(columnsOf(c) + first, classStride[c], count, dimension, x, kernelScale);
+			if (work != nullptr)
+			{
+				*work += count;
+			}
+		}
+		else
+		{
+			push(c, 2 * node.node, node.firstLeaf, node.leaves / 2);
+			push(c, 2 * node.node + 1, node.firstLeaf + node.leaves / 2, node.leaves / 2);
+		}
+	}
+	// Every block is summed and the scores are still too close, unless
+	// every kernel value is 0; then, as in the full sums, the first
+	// class with samples wins
+	for (int c = 0; c < classNumber; c++)
+	{
+		if (exact[c] > 0)
+		{
+			if (work != nullptr)
+			{
+				*work += stored;
+			}
+			return false;
+		}
+	}
+	result = 1;
+	for (int c = 0; c < classNumber; c++)
+	{
+		if (n_k[c] > 0)
+		{
+			result = c + 1;
+			break;
+		}
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	updateKernelConstants
+ * @brief	Recompute the factors of the Gaussian window that only
+ *			depend on h
+ * @param	none
+ * @return	none
+ * */
+void ParzenWindow::updateKernelConstants()
+{
+	kernelScale = -1 / (2 * h * h);
 }
 
 
@@ -112,4 +1230,400 @@ double ParzenWindow::gaussWindow(double param1, double param2, double param3, do
 void ParzenWindow::setH(double h)
 {
 	this->h = h;
+	updateKernelConstants();
+	// The Gauss transform depends on the bandwidth
+	indexBuilt = false;
+}
+
+
+
+/********************************************************************
+ * @name	setBackend
+ * @brief	Select how the kernel sums are computed. Takes effect at
+ *			the next train() or partialFit(). PARZEN_KDTREE keeps the
+ *			exact sums when the tree would not prune enough to pay
+ *			for itself, and PARZEN_IFGT when its expansions cost more
+ *			than the exact sums or cannot meet the accuracy, see
+ *			buildIndex().
+ * @param	backend - PARZEN_EXACT, PARZEN_KDTREE, PARZEN_IFGT or PARZEN_RFF
+ * @return	none
+ * */
+void ParzenWindow::setBackend(int backend)
+{
+	this->backend = backend;
+	indexBuilt = false;
+}
+
+
+/********************************************************************
+ * @name	setIndexError
+ * @brief	Error bounds of the KD-tree backend. Subtrees are skipped
+ *			once their contribution is known well enough, so the
+ *			kernel sum of class k stays within
+ *			max(absError * n_k, relError * sum_k) of the exact value.
+ * @param	absError - Allowed error of the mean kernel value of a class
+ * @param	relError - Allowed relative error of the kernel sum
+ * @return	none
+ * */
+void ParzenWindow::setIndexError(double absError, double relError)
+{
+	this->indexAbsError = absError;
+	this->indexRelError = relError;
+}
+
+
+/********************************************************************
+ * @name	setIFGTAccuracy
+ * @brief	Target accuracy of the IFGT backend. The kernel sum of
+ *			class k stays within epsilon * n_k of the exact value. A
+ *			smaller epsilon raises the order of the expansions, and
+ *			past the limits of FastGaussTransform, or when the
+ *			expansions cost more than the exact SIMD sums, the exact
+ *			sums are used instead. The transform pays off only for
+ *			few features and many samples: measured with two
+ *			features and h near the spread of the classes, from
+ *			about 10000 samples at 1e-3 and 40000 at 1e-6, where a
+ *			query takes a third of the exact time. With four
+ *			features the exact sums stayed cheaper at 40000 samples
+ *			even at 1e-3, as the terms grow like C(p - 1 + d, d).
+ * @param	epsilon - Allowed error of the mean kernel value of a class
+ * @return	none
+ * */
+void ParzenWindow::setIFGTAccuracy(double epsilon)
+{
+	this->ifgtAccuracy = epsilon;
+	indexBuilt = false;
+}
+
+
+/********************************************************************
+ * @name	setRFFFeatures
+ * @brief	Size of the embedding of the PARZEN_RFF backend. A query
+ *			costs O(D * d) and the estimated mean kernel value of a
+ *			class deviates from the exact one by about 1 / sqrt(D).
+ *			The cosines and sines make a feature cost about twenty
+ *			exact kernel values, and the mean kernel values shrink
+ *			like (h^2 / (h^2 + s^2))^(d/2) for classes of spread s,
+ *			so a small h in many dimensions needs D far beyond the
+ *			number of samples. Training grows D until the classes
+ *			are told apart, and keeps the exact sums when those
+ *			features would cost more.
+ *			The same seed draws the same frequencies, so a model is
+ *			reproducible from its samples. Takes effect at the next
+ *			train() or partialFit().
+ * @param	features - Number of random Fourier features D, rounded up
+ *			to an even number
+ * @param	seed - Seed of the random frequencies
+ * @return	none
+ * */
+void ParzenWindow::setRFFFeatures(size_t features, uint64_t seed)
+{
+	if (features == 0)
+	{
+		throw invalid_argument("ParzenWindow::setRFFFeatures");
+	}
+	this->rffFeatures = features;
+	this->rffSeed = seed;
+	indexBuilt = false;
+}
+
+
+/********************************************************************
+ * @name	setWindow
+ * @brief	Keep only the most recent samples. Takes effect at the
+ *			next train().
+ * @param	window - Number of samples kept, 0 to keep every sample
+ * @return	none
+ * */
+void ParzenWindow::setWindow(size_t window)
+{
+	this->window = window;
+}
+
+
+/********************************************************************
+ * @name	setPrecision
+ * @brief	Select the precision of the exact backend. PARZEN_FLOAT
+ *			scores against a float32 copy of the class columns,
+ *			centred on the mean of the samples, with sixteen points
+ *			per AVX-512 register instead of eight and half the bytes
+ *			read per query; the exponentials are float32 too, and
+ *			only the sums stay in float64. With u = 2^-24, d features
+ *			and M the largest |feature - mean| of the samples and the
+ *			query, every squared distance is within u * (4 * M *
+ *			sqrt(d * D) + (d + 3) * D) of the float64 one. Rounding
+ *			the exponent adds 2 * u / e and the float32 exponential,
+ *			within 2 * u of exp, another 2 * u, so every kernel
+ *			value, and the mean kernel value of every class, is
+ *			within u * ((d + 5) / e + 2 + 2 * M * sqrt(d) /
+ *			(h * sqrt(e))) of the PARZEN_DOUBLE result. Predictions can only differ
+ *			where two classes score closer than that. Applies
+ *			immediately, also to a loaded model, and is not saved
+ *			with it. The KD-tree, IFGT and RFF backends ignore it.
+ * @param	precision - PARZEN_DOUBLE or PARZEN_FLOAT
+ * @return	none
+ * */
+void ParzenWindow::setPrecision(int precision)
+{
+	this->precision = precision;
+	classColumnsFloat.clear();
+	floatCenter.clear();
+	if (precision == PARZEN_FLOAT && dimension > 0)
+	{
+		buildFloatColumns();
+	}
+}
+
+
+/********************************************************************
+ * @name	setEarlyExit
+ * @brief	Let the exact backend stop summing once the class is
+ *			decided, see decideEarly(). Predictions are the same as
+ *			without it. Applies immediately; the columns of a model
+ *			in memory are sorted into blocks, a loaded model is
+ *			bounded in the order it was saved in. PARZEN_FLOAT
+ *			always takes the full sums, and so does a model whose
+ *			bounds would not skip enough blocks, see buildTrees().
+ * @param	earlyExit - Whether to stop early
+ * @return	none
+ * */
+void ParzenWindow::setEarlyExit(bool earlyExit)
+{
+	this->earlyExit = earlyExit;
+	treeBuilt = false;
+	treeLeaves.clear();
+	nodeCenter.clear();
+	nodeRadius.clear();
+	nodeSpread.clear();
+	if (earlyExit && dimension > 0)
+	{
+		buildTrees();
+	}
+}
+
+
+/********************************************************************
+ * @name	usesIndex
+ * @brief	Whether queries go through the KD-tree, the Gauss transform
+ *			or the Fourier features of the backend. False for
+ *			PARZEN_EXACT, before train(), after a setting that drops
+ *			the index, and when training found the exact sums cheaper.
+ * @param	none
+ * @return	True when the index of the backend answers the queries
+ * */
+bool ParzenWindow::usesIndex() const
+{
+	return indexBuilt && !indexFallback;
+}
+
+
+/********************************************************************
+ * @name	saveModel
+ * @brief	Add the model to a model file: the parameters, the class
+ *			counts and priors, the class columns padded to the
+ *			alignment, the ids of the window and the index
+ * @param	writer - Model file being written
+ * @return	False before the model is trained
+ * */
+bool ParzenWindow::saveModel(ModelWriter& writer) const
+{
+	if (dimension == 0)
+	{
+		return false;
+	}
+	const size_t lane = FEATURE_ALIGNMENT / sizeof(double);
+	writer.setModel(MODEL_PARZEN, dimension, classNumber);
+	ParzenParameters parameters;
+	memset(&parameters, 0, sizeof(parameters));
+	parameters.backend = backend;
+	parameters.indexed = indexBuilt && !indexFallback;
+	parameters.h = h;
+	parameters.indexAbsError = indexAbsError;
+	parameters.indexRelError = indexRelError;
+	parameters.ifgtAccuracy = ifgtAccuracy;
+	parameters.window = window;
+	parameters.ringSize = ringSize;
+	parameters.oldest = oldest;
+	parameters.stored = stored;
+	parameters.ids = mappedColumns != nullptr ? mappedIds : sampleClass.size();
+	writer.add(PARZEN_SECTION_PARAMETERS, &parameters, sizeof(parameters));
+
+	vector<size_t> counts(classNumber);
+	vector<size_t> strides(classNumber);
+	vector<double> columns;
+	for (int c = 0; c < classNumber; c++)
+	{
+		counts[c] = (size_t)n_k[c];
+		strides[c] = (counts[c] + lane - 1) / lane * lane;
+		const double* source = columnsOf(c);
+		for (int f = 0; f < dimension; f++)
+		{
+			columns.insert(columns.end(), source + f * classStride[c], source + f * classStride[c] + counts[c]);
+			columns.resize(columns.size() + strides[c] - counts[c], 0.0);
+		}
+	}
+	writer.add(PARZEN_SECTION_COUNTS, counts);
+	writer.add(PARZEN_SECTION_PRIORS, P_wk);
+	writer.add(PARZEN_SECTION_STRIDES, strides);
+	writer.add(PARZEN_SECTION_COLUMNS, columns);
+	writer.add(PARZEN_SECTION_SAMPLE_CLASS, mappedColumns != nullptr ? mappedSampleClass : sampleClass.data(),
+		parameters.ids * sizeof(int));
+	writer.add(PARZEN_SECTION_SAMPLE_POSITION,
+		mappedColumns != nullptr ? mappedSamplePosition : samplePosition.data(), parameters.ids * sizeof(size_t));
+	if (parameters.indexed && backend == PARZEN_KDTREE)
+	{
+		index.save(writer, PARZEN_SECTION_INDEX);
+	}
+	else if (parameters.indexed && backend == PARZEN_IFGT)
+	{
+		gaussTransform.save(writer, PARZEN_SECTION_INDEX);
+	}
+	else if (parameters.indexed && backend == PARZEN_RFF)
+	{
+		fourierFeatures.save(writer, PARZEN_SECTION_INDEX);
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	load
+ * @brief	Serve a saved model from a mapped model file. The class
+ *			columns, the ids and the index stay in the file; only the
+ *			per-class counts, priors and strides are copied. The
+ *			file is checked so that no query or later partialFit()
+ *			reads outside the mapping.
+ * @param	file - Mapped model file of type MODEL_PARZEN
+ * @return	Whether the model is valid
+ * */
+bool ParzenWindow::load(const shared_ptr<ModelFile>& file)
+{
+	const size_t lane = FEATURE_ALIGNMENT / sizeof(double);
+	int d = file->dimension();
+	int K = file->classNumber();
+	const ParzenParameters* parameters = file->array<ParzenParameters>(PARZEN_SECTION_PARAMETERS, 1);
+	if (file->type() != MODEL_PARZEN || d <= 0 || K < 0 || parameters == nullptr
+		|| parameters->backend > PARZEN_RFF || !(parameters->h > 0)
+		|| (parameters->ringSize > 0 && (parameters->oldest >= parameters->ringSize
+			|| parameters->stored > parameters->ringSize || parameters->ids > parameters->ringSize)))
+	{
+		return false;
+	}
+	const size_t* counts = file->array<size_t>(PARZEN_SECTION_COUNTS, K);
+	const double* priors = file->array<double>(PARZEN_SECTION_PRIORS, K);
+	const size_t* strides = file->array<size_t>(PARZEN_SECTION_STRIDES, K);
+	size_t ids = parameters->ids;
+	const int* classes = file->array<int>(PARZEN_SECTION_SAMPLE_CLASS, ids);
+	const size_t* positions = file->array<size_t>(PARZEN_SECTION_SAMPLE_POSITION, ids);
+	if (counts == nullptr || priors == nullptr || strides == nullptr || classes == nullptr || positions == nullptr)
+	{
+		return false;
+	}
+	size_t total = 0;
+	size_t values = 0;
+	vector<size_t> offsets(K);
+	for (int c = 0; c < K; c++)
+	{
+		if (counts[c] > strides[c] || strides[c] % lane != 0 || strides[c] > (SIZE_MAX - values) / d)
+		{
+			return false;
+		}
+		offsets[c] = values;
+		values += strides[c] * d;
+		total += counts[c];
+	}
+	const double* columns = file->array<double>(PARZEN_SECTION_COLUMNS, values);
+	if (columns == nullptr || total != parameters->stored)
+	{
+		return false;
+	}
+	for (size_t id = 0; id < ids; id++)
+	{
+		if (classes[id] < -1 || classes[id] >= K || (classes[id] >= 0 && positions[id] >= counts[classes[id]]))
+		{
+			return false;
+		}
+	}
+
+	reset(d);
+	addClasses(K);
+	window = parameters->window;
+	ringSize = parameters->ringSize;
+	oldest = parameters->oldest;
+	stored = parameters->stored;
+	// Every kept sample must have a class, expireOldest() relies on it
+	for (size_t i = 0; i < stored; i++)
+	{
+		size_t id = ringId(i);
+		if (id >= ids || classes[id] < 0)
+		{
+			reset(0);
+			return false;
+		}
+	}
+	for (int c = 0; c < K; c++)
+	{
+		n_k[c] = (double)counts[c];
+		P_wk[c] = priors[c];
+		classStride[c] = strides[c];
+	}
+	h = parameters->h;
+	updateKernelConstants();
+	backend = parameters->backend;
+	indexAbsError = parameters->indexAbsError;
+	indexRelError = parameters->indexRelError;
+	ifgtAccuracy = parameters->ifgtAccuracy;
+	indexBuilt = false;
+	if (parameters->indexed && backend == PARZEN_KDTREE)
+	{
+		indexBuilt = index.load(*file, PARZEN_SECTION_INDEX, d, K);
+	}
+	else if (parameters->indexed && backend == PARZEN_IFGT)
+	{
+		indexBuilt = gaussTransform.load(*file, PARZEN_SECTION_INDEX, d, K);
+	}
+	else if (parameters->indexed && backend == PARZEN_RFF)
+	{
+		indexBuilt = fourierFeatures.load(*file, PARZEN_SECTION_INDEX, d, K);
+		// A rebuild after partialFit() draws the same frequencies
+		rffFeatures = fourierFeatures.featureNumber();
+		rffSeed = fourierFeatures.featureSeed();
+	}
+	if (parameters->indexed && !indexBuilt)
+	{
+		reset(0);
+		return false;
+	}
+	mappedColumns = columns;
+	mappedOffset = offsets;
+	mappedSampleClass = classes;
+	mappedSamplePosition = positions;
+	mappedIds = ids;
+	modelFile = file;
+	if (earlyExit)
+	{
+		buildTrees();
+	}
+	if (precision == PARZEN_FLOAT)
+	{
+		buildFloatColumns();
+	}
+	return true;
+}
+
+
+/********************************************************************
+ * @name	treeLeavesFor
+ * @brief	Number of leaves of the block tree of a class
+ * @param	count - Number of points of the class
+ * @return	Smallest power of two of blocks holding every point
+ * */
+static size_t treeLeavesFor(size_t count)
+{
+	size_t leaves = 1;
+	while (leaves * PARZEN_BLOCK_POINTS < count)
+	{
+		leaves *= 2;
+	}
+	return leaves;
 }
@@ -16,6 +16,39 @@
 // Includes
 //-------------------------------------------------------------------
 #include "Algorithm.h"
+#include "AlignedAllocator.h"
+#include "FastGaussTransform.h"
+#include "KDTree.h"
+#include "RandomFourierFeatures.h"
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Exact kernel sums over every training point
+#define PARZEN_EXACT 0
+// Bounded-error kernel sums over a KD-tree
+#define PARZEN_KDTREE 1
+// Improved Fast Gauss Transform
+#define PARZEN_IFGT 2
+// Random Fourier feature embeddings of the classes
+#define PARZEN_RFF 3
+
+// Distances of the exact backend in float64
+#define PARZEN_DOUBLE 0
+// Distances and kernel values of the exact backend in float32, sums in float64
+#define PARZEN_FLOAT 1
+
+// Training points the KD-tree is probed with before it is used
+#define PARZEN_INDEX_PROBES 64
+
+// Training points per block of the early exit bounds, a multiple of
+// every SIMD width
+#define PARZEN_BLOCK_POINTS 512
+
+// Cost of bounding one node of the early exit trees, in kernel values
+#define PARZEN_NODE_COST 64
 
 
 //-------------------------------------------------------------------
@@ -24,7 +57,38 @@
 
 /********************************************************************
  * @name	ParzenWindow
- * @brief	Implement ParzenWindow algorithm
+ * @brief	Implement ParzenWindow algorithm. train() lays the training
+ *			set out as aligned feature columns grouped by class, so
+ *			the kernel sums run through the SIMD kernels of
+ *			ParzenKernel.h.
+ *
+ *			The model can also learn online: partialFit() appends
+ *			samples to the class columns and the index. With
+ *			setWindow(W) only the last W samples are kept in a ring
+ *			buffer and the oldest one expires as a new one arrives;
+ *			the priors and the index follow both without a rebuild.
+ *
+ *			A saved model is served from the mapped model file: the
+ *			class columns and the index are read in place. The first
+ *			partialFit() copies them into the model and rebuilds the
+ *			index once.
+ *
+ *			With setEarlyExit() the exact backend sorts each class
+ *			into a binary tree of spatially compact blocks and bounds
+ *			the kernel sum of every node from its centre and radius.
+ *			A query refines the most uncertain node first and sums
+ *			blocks only until the bounds separate the winning class
+ *			from all others. When the classes overlap too much for
+ *			the bounds to skip blocks, the full sums are taken.
+ *
+ *			PARZEN_RFF trades accuracy for queries whose cost does
+ *			not grow with the training set: each class is reduced
+ *			to the sum of the random Fourier features of its
+ *			samples, see RandomFourierFeatures.h. It suits large
+ *			training sets, tens of thousands of samples for the
+ *			default D = 1024, with h near the spread of the classes;
+ *			outside that regime buildIndex() grows D or keeps the
+ *			exact sums.
  * */
 class ParzenWindow : public Algorithm 
 {
@@ -32,24 +96,134 @@ class ParzenWindow : public Algorithm
 // Member Variables
 //-------------------------------------------------------------------
 private:
+	// Number of features
+	int dimension = 0;
+	// Number of classes
+	int classNumber = 0;
 	// The number of each type in the test set
-	double n_k[3] = { 0 };
+	vector<double> n_k;
 	// Conditional probabilities for each of these categories
-	double P_wk[3] = { 0 };
+	vector<double> P_wk;
 	// Hyperparameter
 	double h = 1;
+	// Exponent factor of the Gaussian window, -1 / (2 * h^2)
+	double kernelScale = -0.5;
+	// Training points of each class, one aligned column per feature
+	vector<AlignedVector> classColumns;
+	// Distance between two feature columns of each class, the number
+	// of points the columns can hold
+	vector<size_t> classStride;
+	// Id of the point in each position of the class columns
+	vector<vector<size_t>> classIds;
+	// Class and position in the class columns of each id
+	vector<int> sampleClass;
+	vector<size_t> samplePosition;
+	// Number of samples kept, 0 to keep every sample
+	size_t window = 0;
+	// Capacity of the ring buffer of ids, the window at the last reset
+	size_t ringSize = 0;
+	// Ring position of the oldest sample
+	size_t oldest = 0;
+	// Number of samples kept
+	size_t stored = 0;
+	// Whether the index, the Gauss transform or the Fourier features
+	// hold the samples
+	bool indexBuilt = false;
+	// How the kernel sums are computed
+	int backend = PARZEN_EXACT;
+	// Allowed error of the mean kernel value of a class
+	double indexAbsError = 0;
+	// Allowed error relative to the kernel sum of a class
+	double indexRelError = 0;
+	// Spatial index over the training set
+	KDTree index;
+	// Whether buildIndex() found the KD-tree or the Gauss transform
+	// slower than the exact sums; it is then left empty and the
+	// queries scan the class columns
+	bool indexFallback = false;
+	// Target error of the mean kernel value of a class for the IFGT
+	double ifgtAccuracy = 1e-6;
+	// Fast Gauss Transform of the training set
+	FastGaussTransform gaussTransform;
+	// Number of random Fourier features D and the seed they are drawn
+	// with
+	size_t rffFeatures = 1024;
+	uint64_t rffSeed = 1;
+	// Random Fourier feature embedding of the training set
+	RandomFourierFeatures fourierFeatures;
+	// PARZEN_DOUBLE or PARZEN_FLOAT
+	int precision = PARZEN_DOUBLE;
+	// Float32 copy of the class columns for PARZEN_FLOAT, with the
+	// strides of classColumns, relative to floatCenter. Empty while
+	// not in use.
+	vector<AlignedFloatVector> classColumnsFloat;
+	// Mean of the samples when the float columns were built
+	vector<double> floatCenter;
+	// Whether testSingle() stops once the bounds decide the class
+	bool earlyExit = false;
+	// Whether the block trees below describe the class columns
+	bool treeBuilt = false;
+	// Whether buildTrees() found the early exit slower than the full
+	// sums, which the queries then take
+	bool treeFallback = false;
+	// Number of leaves of the tree of each class, a power of two. Leaf
+	// i holds the PARZEN_BLOCK_POINTS positions of block i.
+	vector<size_t> treeLeaves;
+	// Centre of every node of the tree of each class, node by node,
+	// the largest distance from it to a point of the node and the mean
+	// squared distance, -1 once points changed and the centre is no
+	// longer the mean
+	vector<vector<double>> nodeCenter;
+	vector<vector<double>> nodeRadius;
+	vector<vector<double>> nodeSpread;
+	// Class columns inside the mapped model file, used instead of
+	// classColumns after load(), and where each class starts
+	const double* mappedColumns = nullptr;
+	vector<size_t> mappedOffset;
+	// Class and position of each id inside the mapped model file
+	const int* mappedSampleClass = nullptr;
+	const size_t* mappedSamplePosition = nullptr;
+	// Number of ids
+	size_t mappedIds = 0;
 
 //-------------------------------------------------------------------
 // Member Function
 //-------------------------------------------------------------------
 private:
-	double gaussWindow(double param1, double param2, double param3, double param4);
-	int testSingle(DataStruct testData);
+	void updateKernelConstants();
+	void reset(int dimension);
+	void addClasses(int classNumber);
+	size_t ringId(size_t i) const;
+	void addSample(const double* x, int indexClass);
+	void expireOldest();
+	void buildIndex();
+	double fourierFeaturesNeeded(const double* points, const int* labels) const;
+	void buildFloatColumns();
+	void buildTrees();
+	void sortClass(int indexClass);
+	void boundClass(int indexClass, size_t leaves);
+	void coverPoint(int indexClass, size_t position);
+	bool decideEarly(const double* x, int& result, size_t* work = nullptr) const;
+	const double* columnsOf(int indexClass) const;
+	void detachModel();
+	int testSingle(const double* x) const;
+	bool saveModel(ModelWriter& writer) const;
 
 public:
 	void setH(double h);
-	ParzenWindow(vector<DataStruct>* dataset);
+	void setBackend(int backend);
+	void setIndexError(double absError, double relError);
+	void setIFGTAccuracy(double epsilon);
+	void setRFFFeatures(size_t features, uint64_t seed = 1);
+	void setWindow(size_t window);
+	void setPrecision(int precision);
+	void setEarlyExit(bool earlyExit);
+	bool usesIndex() const;
+	ParzenWindow(Dataset* dataset);
+	Algorithm* clone() const;
 	void train();
+	void partialFit(const Dataset& samples);
+	bool load(const shared_ptr<ModelFile>& file);
 };
 
 #endif
\ No newline at end of file
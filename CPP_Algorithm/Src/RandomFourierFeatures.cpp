@@ -0,0 +1,345 @@
+/********************************************************************
+ * @File name:		RandomFourierFeatures.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-10
+ * @Description:	Random Fourier feature embedding
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "RandomFourierFeatures.h"
+#include "Arena.h"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdexcept>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// 2 * pi, the period of the uniform angle of the Box-Muller transform
+const double RFF_TWO_PI = 6.28318530717958647692;
+
+// Sections of a saved embedding, after the first section id
+enum
+{
+	RFF_SECTION_PARAMETERS,
+	RFF_SECTION_OMEGA,
+	RFF_SECTION_EMBEDDINGS,
+	RFF_SECTION_CLASS_COUNT
+};
+
+/********************************************************************
+ * @name	FourierParameters
+ * @brief	Scalars of a saved embedding
+ * */
+typedef struct
+{
+	// Number of frequencies, D / 2
+	uint64_t frequencies;
+	uint64_t seed;
+	double bandwidth;
+}FourierParameters;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+static double standardNormal(mt19937_64& generator);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	RandomFourierFeatures
+ * @brief	The constructor. Creates an empty embedding.
+ * */
+RandomFourierFeatures::RandomFourierFeatures()
+{
+}
+
+
+/********************************************************************
+ * @name	build
+ * @brief	Draw the frequencies and sum the features of the sources
+ *			of every class
+ * @param	points - Row-major number x dimension sources
+ * @param	labels - Class of each source, from 0 to classes - 1
+ * @param	number - Number of sources
+ * @param	dimension - Number of features of the points
+ * @param	classes - Number of classes
+ * @param	bandwidth - Bandwidth h of exp(-|y - x|^2 / (2 * h^2))
+ * @param	features - Number of features D, rounded up to an even
+ *			number
+ * @param	seed - Seed of the frequencies
+ * @return	none
+ * */
+void RandomFourierFeatures::build(const double* points, const int* labels, size_t number,
+	int dimension, int classes, double bandwidth, size_t features, uint64_t seed)
+{
+	this->dimension = dimension;
+	this->classes = classes;
+	this->bandwidth = bandwidth;
+	this->seed = seed;
+	frequencies = (min(max(features, (size_t)2), RFF_MAX_FEATURES) + 1) / 2;
+	isMapped = false;
+
+	// Frequency by frequency, so that a larger D keeps the first ones
+	mt19937_64 generator(seed);
+	omega.assign(frequencies * dimension, 0.0);
+	for (size_t j = 0; j < frequencies; j++)
+	{
+		for (int f = 0; f < dimension; f++)
+		{
+			omega[f * frequencies + j] = standardNormal(generator) / bandwidth;
+		}
+	}
+	embeddings.assign((size_t)classes * 2 * frequencies, 0.0);
+	classCount.assign(classes, 0);
+	for (size_t i = 0; i < number; i++)
+	{
+		classCount[labels[i]]++;
+		accumulate(points + i * dimension, labels[i], 1);
+	}
+}
+
+
+/********************************************************************
+ * @name	insert
+ * @brief	Add the features of one source to the sum of its class
+ * @param	x - Features of the source
+ * @param	label - Class of the source, from 0 to classes - 1
+ * @return	none
+ * */
+void RandomFourierFeatures::insert(const double* x, int label)
+{
+	if (isMapped)
+	{
+		throw logic_error("RandomFourierFeatures::insert");
+	}
+	classCount[label]++;
+	accumulate(x, label, 1);
+}
+
+
+/********************************************************************
+ * @name	remove
+ * @brief	Subtract the features of one source from the sum of its
+ *			class. The sum of a class left empty is cleared.
+ * @param	x - Features of the source, as inserted
+ * @param	label - Class of the source
+ * @return	none
+ * */
+void RandomFourierFeatures::remove(const double* x, int label)
+{
+	if (isMapped)
+	{
+		throw logic_error("RandomFourierFeatures::remove");
+	}
+	if (classCount[label] == 0)
+	{
+		return;
+	}
+	if (--classCount[label] == 0)
+	{
+		fill(embeddings.begin() + (size_t)label * 2 * frequencies,
+			embeddings.begin() + (size_t)(label + 1) * 2 * frequencies, 0.0);
+		return;
+	}
+	accumulate(x, label, -1);
+}
+
+
+/********************************************************************
+ * @name	accumulate
+ * @brief	Add the unscaled features of one source to the sum of its
+ *			class
+ * @param	x - Features of the source
+ * @param	label - Class of the source
+ * @param	sign - 1 to add the source, -1 to remove it
+ * @return	none
+ * */
+void RandomFourierFeatures::accumulate(const double* x, int label, double sign)
+{
+	ArenaScope scratch;
+	double* features = scratch.allocate<double>(2 * frequencies);
+	project(x, features);
+	double* embedding = embeddings.data() + (size_t)label * 2 * frequencies;
+	for (size_t j = 0; j < 2 * frequencies; j++)
+	{
+		embedding[j] += sign * features[j];
+	}
+}
+
+
+/********************************************************************
+ * @name	project
+ * @brief	Unscaled features of a point, cos(w_j . x) for every
+ *			frequency followed by sin(w_j . x)
+ * @param	x - Point
+ * @param	features - Output, 2 * frequencies values
+ * @return	none
+ * */
+void RandomFourierFeatures::project(const double* x, double* features) const
+{
+	const double* omegaData = isMapped ? mappedOmega : omega.data();
+	double* angle = features + frequencies;
+	fill(angle, angle + frequencies, 0.0);
+	// Feature by feature, so the inner loop runs over contiguous
+	// frequencies
+	for (int f = 0; f < dimension; f++)
+	{
+		const double* row = omegaData + f * frequencies;
+		double value = x[f];
+		for (size_t j = 0; j < frequencies; j++)
+		{
+			angle[j] += value * row[j];
+		}
+	}
+	for (size_t j = 0; j < frequencies; j++)
+	{
+		double a = angle[j];
+		features[j] = cos(a);
+		angle[j] = sin(a);
+	}
+}
+
+
+/********************************************************************
+ * @name	kernelSums
+ * @brief	Estimated Gaussian kernel sum of each class at a query
+ *			point. An estimate can be slightly negative.
+ * @param	y - Query point
+ * @param	sums - Output, one kernel sum per class
+ * @return	none
+ * */
+void RandomFourierFeatures::kernelSums(const double* y, double* sums) const
+{
+	ArenaScope scratch;
+	double* features = scratch.allocate<double>(2 * frequencies);
+	project(y, features);
+	const double* embeddingData = isMapped ? mappedEmbeddings : embeddings.data();
+	for (int c = 0; c < classes; c++)
+	{
+		const double* embedding = embeddingData + (size_t)c * 2 * frequencies;
+		double sum = 0;
+		for (size_t j = 0; j < 2 * frequencies; j++)
+		{
+			sum += features[j] * embedding[j];
+		}
+		// The scale 2 / D of the dot product of two feature vectors
+		sums[c] = sum / (double)frequencies;
+	}
+}
+
+
+/********************************************************************
+ * @name	featureNumber
+ * @brief	Number of features D
+ * @param	none
+ * @return	Number of features
+ * */
+size_t RandomFourierFeatures::featureNumber() const
+{
+	return 2 * frequencies;
+}
+
+
+/********************************************************************
+ * @name	featureSeed
+ * @brief	Seed the frequencies were drawn with
+ * @param	none
+ * @return	The seed
+ * */
+uint64_t RandomFourierFeatures::featureSeed() const
+{
+	return seed;
+}
+
+
+/********************************************************************
+ * @name	save
+ * @brief	Add the frequencies and the class sums to a model file
+ * @param	writer - Model file being written
+ * @param	firstSection - Id of the first of the embedding's sections
+ * @return	none
+ * */
+void RandomFourierFeatures::save(ModelWriter& writer, uint32_t firstSection) const
+{
+	FourierParameters parameters = { frequencies, seed, bandwidth };
+	writer.add(firstSection + RFF_SECTION_PARAMETERS, &parameters, sizeof(parameters));
+	writer.add(firstSection + RFF_SECTION_OMEGA, isMapped ? mappedOmega : omega.data(),
+		frequencies * dimension * sizeof(double));
+	writer.add(firstSection + RFF_SECTION_EMBEDDINGS, isMapped ? mappedEmbeddings : embeddings.data(),
+		(size_t)classes * 2 * frequencies * sizeof(double));
+	writer.add(firstSection + RFF_SECTION_CLASS_COUNT, isMapped ? mappedCount : classCount.data(),
+		classes * sizeof(size_t));
+}
+
+
+/********************************************************************
+ * @name	load
+ * @brief	Serve queries from an embedding inside a mapped model file
+ * @param	file - Mapped model file, kept open by the caller
+ * @param	firstSection - Id of the first of the embedding's sections
+ * @param	dimension - Number of features of the points
+ * @param	classes - Number of classes
+ * @return	Whether the embedding is valid, it is empty otherwise
+ * */
+bool RandomFourierFeatures::load(const ModelFile& file, uint32_t firstSection, int dimension, int classes)
+{
+	this->dimension = dimension;
+	this->classes = classes;
+	frequencies = 0;
+	isMapped = false;
+	omega.clear();
+	embeddings.clear();
+	classCount.clear();
+	const FourierParameters* parameters =
+		file.array<FourierParameters>(firstSection + RFF_SECTION_PARAMETERS, 1);
+	if (parameters == nullptr || parameters->frequencies == 0
+		|| parameters->frequencies > RFF_MAX_FEATURES / 2 || !(parameters->bandwidth > 0))
+	{
+		return false;
+	}
+	size_t count = parameters->frequencies;
+	const double* omegaData = file.array<double>(firstSection + RFF_SECTION_OMEGA, count * dimension);
+	const double* embeddingData = file.array<double>(firstSection + RFF_SECTION_EMBEDDINGS,
+		(size_t)classes * 2 * count);
+	const size_t* countData = file.array<size_t>(firstSection + RFF_SECTION_CLASS_COUNT, classes);
+	if (omegaData == nullptr || embeddingData == nullptr || countData == nullptr)
+	{
+		return false;
+	}
+	frequencies = count;
+	seed = parameters->seed;
+	bandwidth = parameters->bandwidth;
+	mappedOmega = omegaData;
+	mappedEmbeddings = embeddingData;
+	mappedCount = countData;
+	isMapped = true;
+	return true;
+}
+
+
+/********************************************************************
+ * @name	standardNormal
+ * @brief	Draw from N(0, 1) with the Box-Muller transform, from 53
+ *			random bits per uniform
+ * @param	generator - Random generator
+ * @return	The sample
+ * */
+static double standardNormal(mt19937_64& generator)
+{
+	// u1 in (0, 1] keeps the logarithm finite
+	double u1 = ((generator() >> 11) + 1) * (1.0 / 9007199254740992.0);
+	double u2 = (generator() >> 11) * (1.0 / 9007199254740992.0);
+	return sqrt(-2 * log(u1)) * cos(RFF_TWO_PI * u2);
+}
@@ -0,0 +1,128 @@
+/********************************************************************
+ * @File name:		RandomFourierFeatures.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-10
+ * @Description:	Declare the random Fourier feature embedding used as
+ *					a Parzen Window backend
+ ********************************************************************/
+
+#pragma once
+
+#ifndef RANDOMFOURIERFEATURES_H
+#define RANDOMFOURIERFEATURES_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ModelFile.h"
+
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Upper limit of the number of features D
+#define RFF_MAX_FEATURES ((size_t)1 << 20)
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	RandomFourierFeatures
+ * @brief	Random Fourier features (Rahimi and Recht) of the kernel
+ *			exp(-|y - x|^2 / (2 * h^2)). D / 2 frequencies w_j are
+ *			drawn from N(0, I / h^2) by a seeded generator, and a
+ *			point x maps to the D features cos(w_j . x) and
+ *			sin(w_j . x), scaled by sqrt(2 / D), whose dot products
+ *			are unbiased estimates of the kernel. The features of
+ *			the sources of a class are summed once, so the kernel
+ *			sum of a class at a query is one dot product with the
+ *			features of the query, and a query costs O(D * d)
+ *			whatever the number of sources.
+ *
+ *			The estimate of the mean kernel value of a class has a
+ *			standard deviation below 1 / sqrt(D), for every number
+ *			of sources: D = 1024 keeps it within about 0.03. Classes
+ *			whose mean kernel values are closer than that, as with a
+ *			small h in many dimensions, are told apart less reliably
+ *			than by the exact sums. A feature costs a cosine or a
+ *			sine, so the embedding only beats the exact sums over
+ *			tens of thousands of sources.
+ *
+ *			Sources can be inserted and removed after the build, as
+ *			their features are added to or subtracted from the sum of
+ *			their class. The sum of a class left without sources is
+ *			cleared, so no rounding error stays behind.
+ *
+ *			The frequencies come from a 64-bit Mersenne Twister and
+ *			the Box-Muller transform rather than the standard
+ *			distributions, whose output depends on the library, so
+ *			one seed gives the same features everywhere. save()
+ *			stores the frequencies and the sums, and load() serves
+ *			queries from them inside the mapped file. A loaded
+ *			embedding is read-only until the next build().
+ * */
+class RandomFourierFeatures
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Number of features of the points
+	int dimension = 0;
+	// Number of classes
+	int classes = 0;
+	// Number of frequencies, D / 2
+	size_t frequencies = 0;
+	// Bandwidth h
+	double bandwidth = 1;
+	// Seed of the frequencies
+	uint64_t seed = 0;
+	// Frequencies, feature by feature: coordinate f of frequency j is
+	// at f * frequencies + j
+	vector<double> omega;
+	// Per class, the sums of cos(w_j . x) then of sin(w_j . x) over
+	// the sources, 2 * frequencies values
+	vector<double> embeddings;
+	// Number of sources in each class
+	vector<size_t> classCount;
+	// Frequencies, sums and counts inside a mapped model file, used
+	// instead of the members above after load()
+	const double* mappedOmega = nullptr;
+	const double* mappedEmbeddings = nullptr;
+	const size_t* mappedCount = nullptr;
+	bool isMapped = false;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void project(const double* x, double* features) const;
+	void accumulate(const double* x, int label, double sign);
+
+public:
+	RandomFourierFeatures();
+	void build(const double* points, const int* labels, size_t number, int dimension,
+		int classes, double bandwidth, size_t features, uint64_t seed);
+	void insert(const double* x, int label);
+	void remove(const double* x, int label);
+	void kernelSums(const double* y, double* sums) const;
+	size_t featureNumber() const;
+	uint64_t featureSeed() const;
+	void save(ModelWriter& writer, uint32_t firstSection) const;
+	bool load(const ModelFile& file, uint32_t firstSection, int dimension, int classes);
+};
+
+#endif
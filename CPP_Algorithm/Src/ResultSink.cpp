@@ -0,0 +1,480 @@
+/********************************************************************
+ * @File name:		ResultSink.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-2
+ * @Description:	Batched result sinks with a background writer thread
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ResultSink.h"
+#include "SqlResultSink.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Longest text of one double from to_chars, with the separator
+const size_t RESULT_NUMBER_CHARS = 32;
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+bool littleEndianHost();
+bool endsWith(const string& text, const string& suffix);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	ResultSink
+ * @brief	The constructor. The writer thread starts with the first
+ *			batch, once the backend is fully constructed.
+ * @param	dimension - Number of features of every row
+ * @param	batchRows - Rows collected before a batch is written
+ * */
+ResultSink::ResultSink(int dimension, size_t batchRows) :
+	batchRows(batchRows > 0 ? batchRows : 1), dimension(dimension)
+{
+}
+
+
+/********************************************************************
+ * @name	~ResultSink
+ * @brief	The destructor. Stops the writer if the backend did not
+ *			close the sink; queued batches are then lost.
+ * */
+ResultSink::~ResultSink()
+{
+	if (writer.joinable())
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+			queue.clear();
+		}
+		batchReady.notify_all();
+		writer.join();
+	}
+}
+
+
+/********************************************************************
+ * @name	push
+ * @brief	Add test results. The rows are copied, so the results and
+ *			the data set they point into may change afterwards.
+ * @param	results - Test results
+ * @param	count - Number of results
+ * @return	none
+ * */
+void ResultSink::push(const TestResult* results, size_t count)
+{
+	unique_lock<mutex> guard(lock);
+	for (size_t i = 0; i < count; i++)
+	{
+		pending.features.insert(pending.features.end(), results[i].data, results[i].data + dimension);
+		pending.predicted.push_back(results[i].predictIndex);
+		pending.actual.push_back(results[i].actualIndex);
+		if (pending.predicted.size() >= batchRows)
+		{
+			submit(guard);
+		}
+	}
+}
+
+
+/********************************************************************
+ * @name	push
+ * @brief	Add one row
+ * @param	features - Features of the sample, dimension values
+ * @param	predicted - Predicted class
+ * @param	actual - Actual class, CLASS_UNKNOWN when not known
+ * @return	none
+ * */
+void ResultSink::push(const double* features, int predicted, int actual)
+{
+	unique_lock<mutex> guard(lock);
+	pending.features.insert(pending.features.end(), features, features + dimension);
+	pending.predicted.push_back(predicted);
+	pending.actual.push_back(actual);
+	if (pending.predicted.size() >= batchRows)
+	{
+		submit(guard);
+	}
+}
+
+
+/********************************************************************
+ * @name	submit
+ * @brief	Hand the pending rows to the writer. Waits only when the
+ *			writer is RESULT_QUEUE_BATCHES batches behind.
+ * @param	guard - Held lock of the sink
+ * @return	none
+ * */
+void ResultSink::submit(unique_lock<mutex>& guard)
+{
+	if (!writer.joinable())
+	{
+		writer = thread(&ResultSink::writerLoop, this);
+	}
+	batchDone.wait(guard, [this]() { return queue.size() < RESULT_QUEUE_BATCHES; });
+	queue.push_back(move(pending));
+	pending = ResultBatch();
+	pending.features.reserve(batchRows * dimension);
+	batchReady.notify_one();
+}
+
+
+/********************************************************************
+ * @name	writerLoop
+ * @brief	Body of the writer thread. Writes the queued batches in
+ *			order until the sink stops.
+ * @param	none
+ * @return	none
+ * */
+void ResultSink::writerLoop()
+{
+	unique_lock<mutex> guard(lock);
+	while (true)
+	{
+		batchReady.wait(guard, [this]() { return stopping || !queue.empty(); });
+		if (queue.empty())
+		{
+			return;
+		}
+		ResultBatch batch = move(queue.front());
+		queue.pop_front();
+		writing = true;
+		bool skip = failed;
+		batchDone.notify_all();
+		guard.unlock();
+		bool written = skip || writeBatch(batch);
+		guard.lock();
+		writing = false;
+		if (!written)
+		{
+			failed = true;
+		}
+		batchDone.notify_all();
+	}
+}
+
+
+/********************************************************************
+ * @name	flush
+ * @brief	Hand the pending rows to the writer and wait until every
+ *			row is written
+ * @param	none
+ * @return	none
+ * */
+void ResultSink::flush()
+{
+	unique_lock<mutex> guard(lock);
+	if (!pending.predicted.empty())
+	{
+		submit(guard);
+	}
+	batchDone.wait(guard, [this]() { return queue.empty() && !writing; });
+}
+
+
+/********************************************************************
+ * @name	close
+ * @brief	Write the remaining rows, stop the writer and let the
+ *			backend finish its output. Later calls do nothing.
+ * @param	none
+ * @return	Whether every row was stored
+ * */
+bool ResultSink::close()
+{
+	if (closed)
+	{
+		return good();
+	}
+	flush();
+	if (writer.joinable())
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		batchReady.notify_all();
+		writer.join();
+	}
+	closed = true;
+	if (!finish())
+	{
+		fail();
+	}
+	if (!good())
+	{
+		cout << "Unable to store the test results!" << endl;
+	}
+	return good();
+}
+
+
+/********************************************************************
+ * @name	good
+ * @brief	Whether every write so far succeeded
+ * @param	none
+ * @return	False after a failure
+ * */
+bool ResultSink::good() const
+{
+	lock_guard<mutex> guard(lock);
+	return !failed;
+}
+
+
+/********************************************************************
+ * @name	fail
+ * @brief	Mark the sink as failed, e.g. when the backend cannot open
+ *			its output. Later batches are dropped.
+ * @param	none
+ * @return	none
+ * */
+void ResultSink::fail()
+{
+	lock_guard<mutex> guard(lock);
+	failed = true;
+}
+
+
+/********************************************************************
+ * @name	finish
+ * @brief	Complete the output after the last batch, called by close()
+ *			once the writer has stopped
+ * @param	none
+ * @return	Whether the output is complete
+ * */
+bool ResultSink::finish()
+{
+	return true;
+}
+
+
+/********************************************************************
+ * @name	CsvResultSink
+ * @brief	The constructor. Creates the file and writes the header.
+ * @param	filename - Output file, replaced if it exists
+ * @param	dimension - Number of features of every row
+ * @param	batchRows - Rows collected before a batch is written
+ * */
+CsvResultSink::CsvResultSink(const string& filename, int dimension, size_t batchRows) :
+	ResultSink(dimension, batchRows), out(filename, ios::out | ios::binary | ios::trunc)
+{
+	if (!out.is_open())
+	{
+		cout << "File opening failure!\n";
+		fail();
+		return;
+	}
+	string header;
+	for (int f = 1; f <= dimension; f++)
+	{
+		header += "val" + to_string(f) + ",";
+	}
+	header += "predict,actual\n";
+	out.write(header.data(), header.size());
+}
+
+
+/********************************************************************
+ * @name	~CsvResultSink
+ * @brief	The destructor. Closes the sink.
+ * */
+CsvResultSink::~CsvResultSink()
+{
+	close();
+}
+
+
+/********************************************************************
+ * @name	writeBatch
+ * @brief	Format the batch into one buffer with to_chars, which
+ *			writes the shortest text that reads back exactly, and
+ *			write it in one call
+ * @param	batch - Rows to write
+ * @return	Whether the write succeeded
+ * */
+bool CsvResultSink::writeBatch(const ResultBatch& batch)
+{
+	size_t rows = batch.predicted.size();
+	string text((dimension + 2) * RESULT_NUMBER_CHARS * rows, '\0');
+	char* cursor = &text[0];
+	char* end = cursor + text.size();
+	for (size_t i = 0; i < rows; i++)
+	{
+		const double* x = batch.features.data() + i * dimension;
+		for (int f = 0; f < dimension; f++)
+		{
+			cursor = to_chars(cursor, end, x[f]).ptr;
+			*cursor++ = ',';
+		}
+		cursor = to_chars(cursor, end, batch.predicted[i]).ptr;
+		*cursor++ = ',';
+		cursor = to_chars(cursor, end, batch.actual[i]).ptr;
+		*cursor++ = '\n';
+	}
+	out.write(text.data(), cursor - text.data());
+	return !out.fail();
+}
+
+
+/********************************************************************
+ * @name	finish
+ * @brief	Close the file
+ * @param	none
+ * @return	Whether every byte reached the file
+ * */
+bool CsvResultSink::finish()
+{
+	if (!out.is_open())
+	{
+		return false;
+	}
+	out.close();
+	return !out.fail();
+}
+
+
+/********************************************************************
+ * @name	BinaryResultSink
+ * @brief	The constructor. Creates the file and writes the header;
+ *			the number of records is filled in by close().
+ * @param	filename - Output file, replaced if it exists
+ * @param	dimension - Number of features of every row
+ * @param	batchRows - Rows collected before a batch is written
+ * */
+BinaryResultSink::BinaryResultSink(const string& filename, int dimension, size_t batchRows) :
+	ResultSink(dimension, batchRows)
+{
+	if (!littleEndianHost())
+	{
+		cout << "Result files can only be written on little-endian hosts!\n";
+		fail();
+		return;
+	}
+	out.open(filename, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open())
+	{
+		cout << "File opening failure!\n";
+		fail();
+		return;
+	}
+	ResultFileHeader head;
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, RESULT_FILE_MAGIC, 8);
+	head.version = RESULT_FILE_VERSION;
+	head.dimension = dimension;
+	out.write((const char*)&head, sizeof(head));
+}
+
+
+/********************************************************************
+ * @name	~BinaryResultSink
+ * @brief	The destructor. Closes the sink.
+ * */
+BinaryResultSink::~BinaryResultSink()
+{
+	close();
+}
+
+
+/********************************************************************
+ * @name	writeBatch
+ * @brief	Lay the batch out as records in one buffer and write it in
+ *			one call
+ * @param	batch - Rows to write
+ * @return	Whether the write succeeded
+ * */
+bool BinaryResultSink::writeBatch(const ResultBatch& batch)
+{
+	size_t rows = batch.predicted.size();
+	size_t featureBytes = dimension * sizeof(double);
+	size_t recordBytes = featureBytes + 2 * sizeof(int32_t);
+	vector<char> records(rows * recordBytes);
+	for (size_t i = 0; i < rows; i++)
+	{
+		char* record = records.data() + i * recordBytes;
+		int32_t classes[2] = { batch.predicted[i], batch.actual[i] };
+		memcpy(record, batch.features.data() + i * dimension, featureBytes);
+		memcpy(record + featureBytes, classes, sizeof(classes));
+	}
+	out.write(records.data(), records.size());
+	number += rows;
+	return !out.fail();
+}
+
+
+/********************************************************************
+ * @name	finish
+ * @brief	Write the number of records into the header and close the
+ *			file
+ * @param	none
+ * @return	Whether the file is complete
+ * */
+bool BinaryResultSink::finish()
+{
+	if (!out.is_open())
+	{
+		return false;
+	}
+	out.seekp(offsetof(ResultFileHeader, number));
+	out.write((const char*)&number, sizeof(number));
+	out.close();
+	return !out.fail();
+}
+
+
+/********************************************************************
+ * @name	createResultSink
+ * @brief	Create the sink for an output file, chosen by its extension:
+ *			.csv for CSV, .db, .sqlite or .sqlite3 for SQLite (table
+ *			RESULT_TABLE) and binary records otherwise
+ * @param	filename - Output file
+ * @param	dimension - Number of features of every row
+ * @return	The sink, nullptr when the backend is not built in
+ * */
+ResultSink* createResultSink(const string& filename, int dimension)
+{
+	if (endsWith(filename, ".csv"))
+	{
+		return new CsvResultSink(filename, dimension);
+	}
+	if (endsWith(filename, ".db") || endsWith(filename, ".sqlite") || endsWith(filename, ".sqlite3"))
+	{
+#ifdef USE_SQLITE
+		return new SqliteResultSink(filename, RESULT_TABLE, dimension);
+#else
+		cout << "SQLite support is not built in!" << endl;
+		return nullptr;
+#endif
+	}
+	return new BinaryResultSink(filename, dimension);
+}
+
+
+/********************************************************************
+ * @name	endsWith
+ * @brief	Whether a text ends with a suffix
+ * @param	text - Text
+ * @param	suffix - Suffix
+ * @return	True when text ends with suffix
+ * */
+bool endsWith(const string& text, const string& suffix)
+{
+	return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
@@ -0,0 +1,205 @@
+/********************************************************************
+ * @File name:		ResultSink.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-2
+ * @Description:	Declare the result sinks that store test results in
+ *					batches from a background writer thread
+ ********************************************************************/
+
+#pragma once
+
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "Algorithm.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Rows collected before a batch is handed to the writer thread
+#define RESULT_BATCH_ROWS 4096
+// Batches waiting for the writer before push() has to wait
+#define RESULT_QUEUE_BATCHES 64
+// First bytes of every binary result file
+#define RESULT_FILE_MAGIC "PZRSLT\r\n"
+// Current layout version of the binary result file
+#define RESULT_FILE_VERSION 1
+
+/********************************************************************
+ * @name	ResultFileHeader
+ * @brief	First 32 bytes of a binary result file. All values are
+ *			little endian. The file continues with number records of
+ *			dimension float64 features, the int32 predicted class and
+ *			the int32 actual class (0 for an unknown class).
+ * */
+typedef struct
+{
+	// RESULT_FILE_MAGIC
+	char magic[8];
+	// RESULT_FILE_VERSION
+	uint32_t version;
+	// Number of features D
+	uint32_t dimension;
+	// Number of records, written when the sink is closed
+	uint64_t number;
+	// Reserved, 0
+	uint64_t reserved;
+}ResultFileHeader;
+
+/********************************************************************
+ * @name	ResultBatch
+ * @brief	Rows handed to the writer thread in one piece
+ * */
+typedef struct
+{
+	// Row-major features, dimension values per row
+	vector<double> features;
+	// Predicted class of each row
+	vector<int> predicted;
+	// Actual class of each row
+	vector<int> actual;
+}ResultBatch;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	ResultSink
+ * @brief	Abstract class. Stores test results without blocking the
+ *			classification: push() only copies the rows into the
+ *			current batch, and full batches are written by a
+ *			background thread through writeBatch(). Backends write a
+ *			batch as one transaction or one multi-row statement.
+ *			Backends call close() in their destructor, before their
+ *			own members are destroyed.
+ * */
+class ResultSink
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Background writer, started with the first batch
+	thread writer;
+	// Protects every member below
+	mutable mutex lock;
+	// Signalled when a batch is queued or the sink stops
+	condition_variable batchReady;
+	// Signalled when the writer takes or finishes a batch
+	condition_variable batchDone;
+	// Rows not handed to the writer yet
+	ResultBatch pending;
+	// Full batches waiting for the writer
+	deque<ResultBatch> queue;
+	// Rows per batch
+	size_t batchRows;
+	// Whether the writer is busy with a batch
+	bool writing = false;
+	// Set by close()
+	bool stopping = false;
+	// Whether close() has run
+	bool closed = false;
+	// Whether a write failed, later batches are dropped
+	bool failed = false;
+
+protected:
+	// Number of features of every row
+	int dimension;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void writerLoop();
+	void submit(unique_lock<mutex>& guard);
+
+protected:
+	void fail();
+	virtual bool writeBatch(const ResultBatch& batch) = 0;
+	virtual bool finish();
+
+public:
+	ResultSink(int dimension, size_t batchRows = RESULT_BATCH_ROWS);
+	virtual ~ResultSink();
+	ResultSink(const ResultSink&) = delete;
+	ResultSink& operator=(const ResultSink&) = delete;
+	void push(const TestResult* results, size_t count);
+	void push(const double* features, int predicted, int actual);
+	void flush();
+	bool close();
+	bool good() const;
+};
+
+/********************************************************************
+ * @name	CsvResultSink
+ * @brief	Writes the results as CSV, a header line and one line per
+ *			row: the features, the predicted and the actual class
+ * */
+class CsvResultSink : public ResultSink
+{
+private:
+	// Output file
+	ofstream out;
+
+protected:
+	bool writeBatch(const ResultBatch& batch);
+	bool finish();
+
+public:
+	CsvResultSink(const string& filename, int dimension, size_t batchRows = RESULT_BATCH_ROWS);
+	~CsvResultSink();
+};
+
+/********************************************************************
+ * @name	BinaryResultSink
+ * @brief	Writes the results as fixed-size binary records after a
+ *			ResultFileHeader
+ * */
+class BinaryResultSink : public ResultSink
+{
+private:
+	// Output file
+	ofstream out;
+	// Number of records written
+	uint64_t number = 0;
+
+protected:
+	bool writeBatch(const ResultBatch& batch);
+	bool finish();
+
+public:
+	BinaryResultSink(const string& filename, int dimension, size_t batchRows = RESULT_BATCH_ROWS);
+	~BinaryResultSink();
+};
+
+
+//-------------------------------------------------------------------
+// Global Function
+//-------------------------------------------------------------------
+ResultSink* createResultSink(const string& filename, int dimension);
+
+#endif
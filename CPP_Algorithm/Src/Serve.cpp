@@ -0,0 +1,107 @@
+/********************************************************************
+ * @File name:		Serve.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-6
+ * @Description:	Classification daemon. Maps a saved model and
+ *					answers requests over a Unix domain socket or
+ *					loopback TCP until it is interrupted.
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "InferenceServer.h"
+#include "ModelFile.h"
+
+#include <iostream>
+#include <string>
+
+#include <signal.h>
+#include <stdlib.h>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	main
+ * @brief	Daemon entry. Usage:
+ *			serve model address [batch] [latency] [threads]
+ *			where model is a file saved by Algorithm::save(), address
+ *			is unix:path or tcp:port (bound to 127.0.0.1), batch the
+ *			rows of a full batch and latency the longest wait of a
+ *			request for its batch, in microseconds. Runs until
+ *			SIGINT or SIGTERM.
+ * @param	argc - Number of arguments
+ * @param	argv - Arguments
+ * @return	Exit code
+ * */
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cerr << "Usage: serve model unix:path|tcp:port [batch] [latency] [threads]" << endl;
+		return 1;
+	}
+	string address = argv[2];
+	long batchRows = argc > 3 ? atol(argv[3]) : SERVE_BATCH_ROWS;
+	int latency = argc > 4 ? atoi(argv[4]) : SERVE_MAX_LATENCY_US;
+	int threads = argc > 5 ? atoi(argv[5]) : 1;
+
+	Dataset classes;
+	Algorithm* model = loadModel(argv[1], &classes);
+	if (model == nullptr)
+	{
+		cerr << "Unable to load model: " << argv[1] << endl;
+		return 1;
+	}
+	model->setTestThreads(threads);
+
+	// The signals are taken by sigwait() below, every thread started
+	// from here on inherits the mask. Writes to closed connections
+	// fail instead of ending the process.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	InferenceServer server(model, classes.dimension(), classes.classNumber(),
+		batchRows > 0 ? batchRows : SERVE_BATCH_ROWS, latency);
+	bool listening;
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		listening = server.listenUnix(address.substr(5));
+	}
+	else if (address.compare(0, 4, "tcp:") == 0)
+	{
+		listening = server.listenTcp(atoi(address.c_str() + 4));
+	}
+	else
+	{
+		cerr << "Address must be unix:path or tcp:port" << endl;
+		listening = false;
+	}
+	if (!listening)
+	{
+		delete model;
+		return 1;
+	}
+	server.start();
+	cerr << "Serving " << argv[1] << " on " << address << endl;
+	int received;
+	sigwait(&signals, &received);
+	server.stop();
+	cerr << "Stopped" << endl;
+	delete model;
+	return 0;
+}
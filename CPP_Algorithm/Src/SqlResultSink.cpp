@@ -0,0 +1,242 @@
+/********************************************************************
+ * @File name:		SqlResultSink.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-2
+ * @Description:	Result sinks storing test results in SQLite and
+ *					MySQL databases
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "SqlResultSink.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdio.h>
+
+
+//-------------------------------------------------------------------
+// Private function declaration
+//-------------------------------------------------------------------
+string columnList(int dimension);
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	columnList
+ * @brief	Column names of a result table
+ * @param	dimension - Number of features
+ * @return	"val1, ..., valD, predict, actual"
+ * */
+string columnList(int dimension)
+{
+	string columns;
+	for (int f = 1; f <= dimension; f++)
+	{
+		columns += "val" + to_string(f) + ", ";
+	}
+	return columns + "predict, actual";
+}
+
+
+#ifdef USE_SQLITE
+/********************************************************************
+ * @name	SqliteResultSink
+ * @brief	The constructor. Opens the database, creates the table if
+ *			needed and prepares the INSERT statement.
+ * @param	filename - Database file, created if it does not exist
+ * @param	table - Table name
+ * @param	dimension - Number of features of every row
+ * @param	batchRows - Rows per transaction
+ * */
+SqliteResultSink::SqliteResultSink(const string& filename, const string& table, int dimension,
+	size_t batchRows) : ResultSink(dimension, batchRows)
+{
+	if (sqlite3_open(filename.c_str(), &database) != SQLITE_OK)
+	{
+		cout << "SQLite connection error!" << endl;
+		fail();
+		return;
+	}
+	string create = "CREATE TABLE IF NOT EXISTS " + table + " (";
+	for (int f = 1; f <= dimension; f++)
+	{
+		create += "val" + to_string(f) + " REAL, ";
+	}
+	create += "predict INTEGER, actual INTEGER)";
+	string values = "?";
+	for (int f = 0; f < dimension + 1; f++)
+	{
+		values += ", ?";
+	}
+	string statement = "INSERT INTO " + table + " (" + columnList(dimension) + ") VALUES (" + values + ")";
+	if (sqlite3_exec(database, create.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK ||
+		sqlite3_prepare_v2(database, statement.c_str(), -1, &insert, nullptr) != SQLITE_OK)
+	{
+		cout << "SQLite error: " << sqlite3_errmsg(database) << endl;
+		fail();
+	}
+}
+
+
+/********************************************************************
+ * @name	~SqliteResultSink
+ * @brief	The destructor. Closes the sink and the database.
+ * */
+SqliteResultSink::~SqliteResultSink()
+{
+	close();
+	sqlite3_finalize(insert);
+	sqlite3_close(database);
+}
+
+
+/********************************************************************
+ * @name	writeBatch
+ * @brief	Insert the batch in one transaction, reusing the prepared
+ *			statement for every row
+ * @param	batch - Rows to write
+ * @return	Whether the transaction was committed
+ * */
+bool SqliteResultSink::writeBatch(const ResultBatch& batch)
+{
+	if (sqlite3_exec(database, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < batch.predicted.size(); i++)
+	{
+		const double* x = batch.features.data() + i * dimension;
+		for (int f = 0; f < dimension; f++)
+		{
+			sqlite3_bind_double(insert, f + 1, x[f]);
+		}
+		sqlite3_bind_int(insert, dimension + 1, batch.predicted[i]);
+		sqlite3_bind_int(insert, dimension + 2, batch.actual[i]);
+		int status = sqlite3_step(insert);
+		sqlite3_reset(insert);
+		if (status != SQLITE_DONE)
+		{
+			sqlite3_exec(database, "ROLLBACK", nullptr, nullptr, nullptr);
+			return false;
+		}
+	}
+	return sqlite3_exec(database, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+
+/********************************************************************
+ * @name	finish
+ * @brief	Nothing left to do, every batch was committed
+ * @param	none
+ * @return	Whether the database is open
+ * */
+bool SqliteResultSink::finish()
+{
+	return insert != nullptr;
+}
+#endif
+
+
+#ifdef USE_MYSQL
+/********************************************************************
+ * @name	MySqlResultSink
+ * @brief	The constructor. Connects the database.
+ * @param	serveIp - The database IP
+ * @param	uid - The database user ID
+ * @param	pwd - The database user password
+ * @param	databaseName - Database name
+ * @param	table - Table with columns val1 to valD, predict and actual
+ * @param	dimension - Number of features of every row
+ * @param	batchRows - Rows per transaction
+ * */
+MySqlResultSink::MySqlResultSink(const char* serveIp, const char* uid, const char* pwd,
+	const char* databaseName, const string& table, int dimension, size_t batchRows) :
+	ResultSink(dimension, batchRows), table(table)
+{
+	mysql = mysql_init(NULL);
+	// Connecting to the database
+	if (!mysql_real_connect(mysql, serveIp, uid, pwd, databaseName, 0, NULL, 0))
+	{
+		cout << "Mysql connection error!" << endl;
+		fail();
+		return;
+	}
+	char value = 1;
+	mysql_options(mysql, MYSQL_OPT_RECONNECT, &value);
+	mysql_query(mysql, "SET NAMES GB2312");
+	cout << "Mysql connection successful!" << endl;
+}
+
+
+/********************************************************************
+ * @name	~MySqlResultSink
+ * @brief	The destructor. Closes the sink and the connection.
+ * */
+MySqlResultSink::~MySqlResultSink()
+{
+	close();
+	mysql_close(mysql);
+}
+
+
+/********************************************************************
+ * @name	writeBatch
+ * @brief	Insert the batch in one transaction of multi-row INSERT
+ *			statements, RESULT_ROWS_PER_INSERT rows each. Values are
+ *			printed with 17 significant digits, so they read back
+ *			exactly.
+ * @param	batch - Rows to write
+ * @return	Whether the transaction was committed
+ * */
+bool MySqlResultSink::writeBatch(const ResultBatch& batch)
+{
+	if (mysql_query(mysql, "START TRANSACTION") != 0)
+	{
+		return false;
+	}
+	const string head = "INSERT INTO " + table + " (" + columnList(dimension) + ") VALUES ";
+	size_t rows = batch.predicted.size();
+	char number[32];
+	for (size_t first = 0; first < rows; first += RESULT_ROWS_PER_INSERT)
+	{
+		size_t last = min(rows, first + RESULT_ROWS_PER_INSERT);
+		string insert = head;
+		for (size_t i = first; i < last; i++)
+		{
+			insert += i > first ? ", (" : "(";
+			const double* x = batch.features.data() + i * dimension;
+			for (int f = 0; f < dimension; f++)
+			{
+				snprintf(number, sizeof(number), "%.17g, ", x[f]);
+				insert += number;
+			}
+			snprintf(number, sizeof(number), "%d, %d)", batch.predicted[i], batch.actual[i]);
+			insert += number;
+		}
+		if (mysql_query(mysql, insert.c_str()) != 0)
+		{
+			mysql_query(mysql, "ROLLBACK");
+			return false;
+		}
+	}
+	return mysql_query(mysql, "COMMIT") == 0;
+}
+
+
+/********************************************************************
+ * @name	finish
+ * @brief	Nothing left to do, every batch was committed
+ * @param	none
+ * @return	Whether the connection was made
+ * */
+bool MySqlResultSink::finish()
+{
+	return mysql != nullptr;
+}
+#endif
@@ -0,0 +1,107 @@
+/********************************************************************
+ * @File name:		SqlResultSink.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-6-2
+ * @Description:	Declare the result sinks that store test results in
+ *					SQLite and MySQL databases
+ ********************************************************************/
+
+#pragma once
+
+#ifndef SQLRESULTSINK_H
+#define SQLRESULTSINK_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ResultSink.h"
+
+#include <string>
+
+#ifdef USE_SQLITE
+#include <sqlite3.h>
+#endif
+#ifdef USE_MYSQL
+#ifdef _WIN32
+#include <winsock.h>
+#endif
+#include <mysql.h>
+#endif
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Table used when none is given
+#define RESULT_TABLE "result"
+// Rows of one INSERT statement, keeps the statement below the
+// default server packet limit
+#define RESULT_ROWS_PER_INSERT 512
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+#ifdef USE_SQLITE
+/********************************************************************
+ * @name	SqliteResultSink
+ * @brief	Stores the results in a SQLite table with columns val1 to
+ *			valD, predict and actual. Each batch is one transaction
+ *			through a prepared INSERT.
+ * */
+class SqliteResultSink : public ResultSink
+{
+private:
+	// Database connection
+	sqlite3* database = nullptr;
+	// Prepared INSERT of one row
+	sqlite3_stmt* insert = nullptr;
+
+protected:
+	bool writeBatch(const ResultBatch& batch);
+	bool finish();
+
+public:
+	SqliteResultSink(const string& filename, const string& table, int dimension,
+		size_t batchRows = RESULT_BATCH_ROWS);
+	~SqliteResultSink();
+};
+#endif
+
+#ifdef USE_MYSQL
+/********************************************************************
+ * @name	MySqlResultSink
+ * @brief	Stores the results in a MySQL table with columns val1 to
+ *			valD, predict and actual. Each batch is one transaction
+ *			of multi-row INSERT statements.
+ * */
+class MySqlResultSink : public ResultSink
+{
+private:
+	// Database connection
+	MYSQL* mysql = nullptr;
+	// Table name
+	string table;
+
+protected:
+	bool writeBatch(const ResultBatch& batch);
+	bool finish();
+
+public:
+	MySqlResultSink(const char* serveIp, const char* uid, const char* pwd, const char* databaseName,
+		const string& table, int dimension, size_t batchRows = RESULT_BATCH_ROWS);
+	~MySqlResultSink();
+};
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+/********************************************************************
+ * @File name:		ThreadPool.cpp
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-20
+ * @Description:	Fixed-size thread pool
+ ********************************************************************/
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include "ThreadPool.h"
+
+
+//-------------------------------------------------------------------
+// Function implementation
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	ThreadPool
+ * @brief	The constructor. Starts the worker threads.
+ * @param	threads - Number of workers, 0 for one per hardware thread
+ * */
+ThreadPool::ThreadPool(int threads)
+{
+	if (threads <= 0)
+	{
+		threads = defaultThreads();
+	}
+	for (int i = 0; i < threads; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+
+/********************************************************************
+ * @name	~ThreadPool
+ * @brief	The destructor. Finishes the queued tasks and joins the
+ *			workers.
+ * */
+ThreadPool::~ThreadPool()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+
+/********************************************************************
+ * @name	size
+ * @brief	Number of worker threads
+ * @param	none
+ * @return	Number of workers
+ * */
+int ThreadPool::size() const
+{
+	return (int)workers.size();
+}
+
+
+/********************************************************************
+ * @name	submit
+ * @brief	Queue a task
+ * @param	task - Function to run on a worker
+ * @return	none
+ * */
+void ThreadPool::submit(function<void()> task)
+{
+	{
+		unique_lock<mutex> guard(lock);
+		tasks.emplace_back(move(task), nullptr);
+		pending++;
+	}
+	taskReady.notify_one();
+}
+
+
+/********************************************************************
+ * @name	submit
+ * @brief	Queue a task of a group
+ * @param	task - Function to run on a worker
+ * @param	group - Group of the task, alive until wait(group) returns
+ * @return	none
+ * */
+void ThreadPool::submit(function<void()> task, TaskGroup& group)
+{
+	{
+		unique_lock<mutex> guard(lock);
+		tasks.emplace_back(move(task), &group);
+		pending++;
+		group.pending++;
+	}
+	taskReady.notify_one();
+}
+
+
+/********************************************************************
+ * @name	wait
+ * @brief	Block until every submitted task has finished
+ * @param	none
+ * @return	none
+ * */
+void ThreadPool::wait()
+{
+	unique_lock<mutex> guard(lock);
+	allDone.wait(guard, [this] { return pending == 0; });
+	if (failure)
+	{
+		exception_ptr error = failure;
+		failure = nullptr;
+		rethrow_exception(error);
+	}
+}
+
+
+/********************************************************************
+ * @name	wait
+ * @brief	Block until every task of a group has finished
+ * @param	group - Group whose tasks are waited for
+ * @return	none
+ * */
+void ThreadPool::wait(TaskGroup& group)
+{
+	unique_lock<mutex> guard(lock);
+	allDone.wait(guard, [&group] { return group.pending == 0; });
+	if (group.failure)
+	{
+		exception_ptr error = group.failure;
+		group.failure = nullptr;
+		rethrow_exception(error);
+	}
+}
+
+
+/********************************************************************
+ * @name	defaultThreads
+ * @brief	One worker per hardware thread
+ * @param	none
+ * @return	Number of hardware threads, at least 1
+ * */
+int ThreadPool::defaultThreads()
+{
+	unsigned int threads = thread::hardware_concurrency();
+	return threads == 0 ? 1 : (int)threads;
+}
+
+
+/********************************************************************
+ * @name	workerLoop
+ * @brief	Run tasks until the pool stops
+ * @param	none
+ * @return	none
+ * */
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		function<void()> task;
+		TaskGroup* group;
+		{
+			unique_lock<mutex> guard(lock);
+			taskReady.wait(guard, [this] { return stopping || nextTask < tasks.size(); });
+			if (nextTask == tasks.size())
+			{
+				return;
+			}
+			task = move(tasks[nextTask].first);
+			group = tasks[nextTask++].second;
+			if (nextTask == tasks.size())
+			{
+				tasks.clear();
+				nextTask = 0;
+			}
+			else if (nextTask >= THREADPOOL_COMPACT_TASKS && nextTask * 2 >= tasks.size())
+			{
+				// A backlog that never drains must not grow forever
+				tasks.erase(tasks.begin(), tasks.begin() + nextTask);
+				nextTask = 0;
+			}
+		}
+		exception_ptr error;
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			error = current_exception();
+		}
+		unique_lock<mutex> guard(lock);
+		bool finished = --pending == 0;
+		if (group != nullptr)
+		{
+			// The group is not touched once its waiter can return
+			if (error && !group->failure)
+			{
+				group->failure = error;
+			}
+			finished = --group->pending == 0 || finished;
+		}
+		else if (error && !failure)
+		{
+			failure = error;
+		}
+		if (finished)
+		{
+			allDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,117 @@
+/********************************************************************
+ * @File name:		ThreadPool.h
+ * @Author:			Yichen Luo
+ * @Version:		1.0
+ * @Date:			2022-5-20
+ * @Description:	Declare a fixed-size thread pool
+ ********************************************************************/
+
+#pragma once
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+
+//-------------------------------------------------------------------
+// Includes
+//-------------------------------------------------------------------
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+//-------------------------------------------------------------------
+// Namespace
+//-------------------------------------------------------------------
+using namespace std;
+
+
+//-------------------------------------------------------------------
+// Constants and Typedefine
+//-------------------------------------------------------------------
+
+// Started tasks at the front of the queue that trigger a compaction
+const size_t THREADPOOL_COMPACT_TASKS = 64;
+
+
+//-------------------------------------------------------------------
+// Class Declaration
+//-------------------------------------------------------------------
+
+/********************************************************************
+ * @name	TaskGroup
+ * @brief	Tasks one caller submits to a shared pool. Waiting on the
+ *			group blocks only until its own tasks have finished and
+ *			rethrows only their exceptions, whatever other callers
+ *			run on the pool meanwhile.
+ * */
+class TaskGroup
+{
+	friend class ThreadPool;
+
+private:
+	// Tasks of the group queued or running, guarded by the pool
+	size_t pending = 0;
+	// First exception raised by a task of the group
+	exception_ptr failure;
+};
+
+/********************************************************************
+ * @name	ThreadPool
+ * @brief	Runs submitted tasks on a fixed set of worker threads.
+ *			wait() blocks until every task has finished and rethrows
+ *			the first exception a task raised; wait(group) does the
+ *			same for the tasks of one TaskGroup.
+ * */
+class ThreadPool
+{
+//-------------------------------------------------------------------
+// Member Variables
+//-------------------------------------------------------------------
+private:
+	// Worker threads
+	vector<thread> workers;
+	// Tasks, those from nextTask on are not started yet. A vector whose
+	// capacity is kept, so submitting does not allocate once the pool
+	// has seen its largest backlog.
+	vector<pair<function<void()>, TaskGroup*>> tasks;
+	// First task not started yet
+	size_t nextTask = 0;
+	// Protects every member below
+	mutex lock;
+	// Signalled when a task is queued or the pool stops
+	condition_variable taskReady;
+	// Signalled when the last running task of the pool or of a group
+	// finishes
+	condition_variable allDone;
+	// Tasks queued or running
+	size_t pending = 0;
+	// Set by the destructor
+	bool stopping = false;
+	// First exception raised by a task
+	exception_ptr failure;
+
+//-------------------------------------------------------------------
+// Member Function
+//-------------------------------------------------------------------
+private:
+	void workerLoop();
+
+public:
+	ThreadPool(int threads = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	int size() const;
+	void submit(function<void()> task);
+	void submit(function<void()> task, TaskGroup& group);
+	void wait();
+	void wait(TaskGroup& group);
+	static int defaultThreads();
+};
+
+#endif